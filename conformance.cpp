@@ -0,0 +1,275 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "conformance.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include "cpu/cpu.h"
+#include "debug/tracefile.h"
+#include "headless.h"
+#include "system/system.h"
+
+using namespace std;
+
+namespace {
+
+// one instruction of the reference
+struct ReferenceRecord {
+    uint64_t count;     // 0 if the reference doesn't say
+    uint16_t pc;
+    uint16_t regs[8];
+    size_t regCount;
+};
+
+class ReferenceTrace {
+public:
+    virtual ~ReferenceTrace() {}
+
+    // false at the end
+    virtual bool Next(ReferenceRecord &r) = 0;
+
+    // where the last record came from, for messages
+    virtual string Where() const = 0;
+};
+
+class BinaryReference : public ReferenceTrace {
+public:
+    int Open(const string &file) { return mReader.Open(file); }
+
+    virtual bool Next(ReferenceRecord &r) override {
+        TraceEvent e;
+        while (mReader.Next(e)) {
+            if (e.type != TraceEvent::INSN)
+                continue;
+
+            r.count = e.count;
+            r.pc = e.address;
+            memcpy(r.regs, e.regs, sizeof(r.regs));
+            r.regCount = 8;
+            mOffset = mReader.GetOffset();
+            return true;
+        }
+        return false;
+    }
+
+    virtual string Where() const override { return "offset " + to_string(mOffset); }
+
+private:
+    TraceReader mReader;
+    size_t mOffset = 0;
+};
+
+class TextReference : public ReferenceTrace {
+public:
+    virtual ~TextReference() override {
+        if (mFp)
+            fclose(mFp);
+    }
+
+    int Open(const string &file) {
+        mFile = file;
+        mFp = fopen(file.c_str(), "r");
+        if (!mFp) {
+            cerr << "error opening reference trace " << file << endl;
+            return -1;
+        }
+        return 0;
+    }
+
+    virtual bool Next(ReferenceRecord &r) override {
+        char line[256];
+        while (fgets(line, sizeof(line), mFp)) {
+            mLine++;
+
+            char *p = line;
+            while (*p == ' ' || *p == '\t')
+                p++;
+            if (*p == '#' || *p == '\n' || *p == 0)
+                continue;
+
+            r.count = 0;
+            r.pc = strtoul(p, &p, 16);
+            for (r.regCount = 0; r.regCount < 8; r.regCount++) {
+                char *end;
+                unsigned long val = strtoul(p, &end, 16);
+                if (end == p)
+                    break;
+                r.regs[r.regCount] = val;
+                p = end;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    virtual string Where() const override { return mFile + " line " + to_string(mLine); }
+
+private:
+    string mFile;
+    FILE *mFp = nullptr;
+    uint64_t mLine = 0;
+};
+
+unique_ptr<ReferenceTrace> OpenReference(const string &file) {
+    // binary traces start with their magic, anything else is text
+    char magic[8] = {};
+    FILE *fp = fopen(file.c_str(), "rb");
+    if (!fp) {
+        cerr << "error opening reference trace " << file << endl;
+        return nullptr;
+    }
+    size_t len = fread(magic, 1, sizeof(magic), fp);
+    fclose(fp);
+
+    if (len == sizeof(magic) && memcmp(magic, "EMUTRACE", sizeof(magic)) == 0) {
+        auto *binary = new BinaryReference();
+        unique_ptr<ReferenceTrace> ref(binary);
+        if (binary->Open(file) < 0)
+            return nullptr;
+        return ref;
+    }
+
+    auto *text = new TextReference();
+    unique_ptr<ReferenceTrace> ref(text);
+    if (text->Open(file) < 0)
+        return nullptr;
+    return ref;
+}
+
+bool Matches(const FlightRecord &f, uint64_t count, const ReferenceRecord &r) {
+    if (r.count && r.count != count)
+        return false;
+    if (f.pc != r.pc)
+        return false;
+    return memcmp(f.regs, r.regs, r.regCount * sizeof(r.regs[0])) == 0;
+}
+
+void PrintMismatch(Cpu *cpu, const FlightRecorder &fr, size_t index, uint64_t count,
+                   const ReferenceRecord &r, const ReferenceTrace &ref) {
+    static const size_t kContext = 8;
+    char line[256];
+
+    printf("conformance: mismatch at instruction %llu, reference %s\n", (unsigned long long)count, ref.Where().c_str());
+    for (size_t i = (index > kContext) ? index - kContext : 0; i < index; i++) {
+        cpu->FormatFlightRecord(fr.Get(i), line, sizeof(line));
+        printf("  ok       %s\n", line);
+    }
+
+    const FlightRecord &actual = fr.Get(index);
+    cpu->FormatFlightRecord(actual, line, sizeof(line));
+    printf("  actual   %s\n", line);
+
+    // the reference in the same layout, registers it doesn't give are left as ours
+    FlightRecord expected = actual;
+    expected.count = r.count ? r.count : count;
+    expected.pc = r.pc;
+    memcpy(expected.regs, r.regs, r.regCount * sizeof(r.regs[0]));
+    cpu->FormatFlightRecord(expected, line, sizeof(line));
+    printf("  expected %s\n", line);
+
+    cpu->DumpFlightRecorder("conformance mismatch");
+}
+
+} // namespace
+
+int RunConformance(const ConformanceConfig &config) {
+    unique_ptr<ReferenceTrace> ref = OpenReference(config.reference);
+    if (!ref)
+        return 1;
+
+    HeadlessConsole console;
+    if (config.input != "" && console.SetInput(config.input) < 0)
+        return 1;
+    if (config.output != "" && console.SetOutput(config.output) < 0)
+        return 1;
+
+    auto sys = System::Factory(config.system, console);
+    if (!sys) {
+        cerr << "unknown system " << config.system << endl;
+        return 1;
+    }
+    if (config.cpu != "")
+        sys->SetCpu(config.cpu);
+    if (config.rom != "")
+        sys->SetRom(config.rom);
+    if (sys->Init() < 0) {
+        cerr << "error initializing system" << endl;
+        return 1;
+    }
+    if (config.loadState != "" && sys->LoadSnapshot(config.loadState) < 0)
+        return 1;
+
+    Cpu *cpu = sys->GetCpu();
+    const FlightRecorder &fr = cpu->GetFlightRecorder();
+    uint64_t count = cpu->GetInstructionCount();
+    uint64_t start = count;
+    uint64_t limit = config.maxInstructions ? config.maxInstructions : UINT64_MAX;
+
+    auto begin = chrono::steady_clock::now();
+    bool stopped = false;
+    bool refEnded = false;
+    while (count < limit && !stopped && !refEnded) {
+        // a slice no longer than the flight recorder, so every instruction is still in it
+        uint64_t target = min<uint64_t>(limit, count + FlightRecorder::kEntries);
+        cpu->SetInstructionLimit(target);
+        if (cpu->Run() < 0 || cpu->GetInstructionCount() < target)
+            stopped = true;
+
+        uint64_t n = cpu->GetInstructionCount() - count;
+        for (uint64_t i = 0; i < n; i++) {
+            ReferenceRecord r;
+            if (!ref->Next(r)) {
+                refEnded = true;
+                n = i;
+                break;
+            }
+
+            size_t index = fr.Size() - n + i;
+            if (!Matches(fr.Get(index), count + i + 1, r)) {
+                PrintMismatch(cpu, fr, index, count + i + 1, r, *ref);
+                return 1;
+            }
+        }
+        count += n;
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    // the cpu giving up while the reference carries on is a mismatch too
+    ReferenceRecord r;
+    if (stopped && !refEnded && ref->Next(r)) {
+        printf("conformance: cpu stopped at instruction %llu, reference %s continues\n",
+               (unsigned long long)count, ref->Where().c_str());
+        return 1;
+    }
+
+    printf("conformance: %llu instructions match the reference%s (%.0f instructions/sec)\n",
+           (unsigned long long)(count - start), refEnded ? " to its end" : "", (count - start) / secs);
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Conformance run against a reference execution log.
+//
+// The machine runs on the fast engine a flight recorder's worth of
+// instructions at a time, and the pc and registers recorded before each
+// instruction are checked against the next record of the reference, which is
+// read as it goes so traces of any length work. The reference is either a
+// binary trace from --trace-file, matched on instruction count too, or text
+// with one instruction per line:
+//
+//   pc reg0 reg1 ...
+//
+// all in hex, registers in the order of the cpu's flight records (see
+// FormatRegs) and only as many as the line gives are compared. Blank lines
+// and lines starting with # are skipped.
+struct ConformanceConfig {
+    std::string system = "6809";
+    std::string cpu;
+    std::string rom;
+    std::string input;
+    std::string output;
+    std::string loadState;
+    std::string reference;
+    uint64_t maxInstructions = 0;   // 0 runs until the reference or the cpu stops
+};
+
+// 0 if the run matched the reference the whole way, 1 on a mismatch or error
+int RunConformance(const ConformanceConfig &config);
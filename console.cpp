@@ -24,67 +24,31 @@
 #include "console.h"
 
 #include <cstdio>
-#include <iostream>
-#include <unistd.h>
-#include <fcntl.h>
-#include <termios.h>
 
-static struct termios oldstdin;
-static struct termios oldstdout;
-
-static void resetconsole() {
-    tcsetattr(0, TCSANOW, &oldstdin);
-    tcsetattr(1, TCSANOW, &oldstdout);
-}
-
-static void setconsole() {
-    struct termios t;
-
-    tcgetattr(0, &oldstdin);
-    tcgetattr(1, &oldstdout);
-
-    atexit(&resetconsole);
-
-    t = oldstdin;
-
-    t.c_lflag &= ~(ICANON | ECHO | ISIG); // no input processing
-    // Don't interpret various control characters, pass them through instead
-    t.c_cc[VINTR] = t.c_cc[VQUIT] = t.c_cc[VSUSP] = '\0';
-    t.c_cc[VMIN]  = 1;
-    t.c_cc[VTIME] = 0;
-    tcsetattr(0, TCSANOW, &t);
-
-    //tcgetattr(1, &t);
-    //t.c_lflag &= ~(ICANON | ECHO); // no input processing
-    //tcsetattr(1, TCSANOW, &t);
-}
+#include "debug/hostprofile.h"
+#include "debug/probes.h"
+#include "debug/stats.h"
+#include "debug/timeline.h"
+#include "inputlog.h"
 
 Console::Console() {
-    setconsole();
 }
 
 Console::~Console() {
-    resetconsole();
 }
 
-int Console::Run() {
-    for (;;) {
-        int c = getchar();
+void Console::Putchar(char c) {
+    HostProfileScope prof(HostProfile::CONSOLE);
 
-        if (c == 0x4) {
-            printf("ctrl-d on console, exiting\n");
-            return -1;
-        } else if (c == EOF) {
-            printf("EOF on console, exiting\n");
-            return -1;
-        } else {
-            std::lock_guard<std::mutex> lck(mLock);
-            mInBuffer.push(c);
-        }
-    }
-}
+    if (IsMuted())
+        return;
+
+    if (mStats)
+        StatsAdd(mStats->consoleOut, 1);
+    EMU_PROBE1(console_output, (unsigned char)c);
+    if (Timeline::IsEnabled())
+        Timeline::Instant("output", "console", "char", (unsigned char)c);
 
-void Console::Putchar(char c) {
 #if 1
     putchar(c);
     fflush(stdout);
@@ -95,14 +59,32 @@ void Console::Putchar(char c) {
 }
 
 int Console::GetNextChar() {
-    std::lock_guard<std::mutex> lck(mLock);
+    HostProfileScope prof(HostProfile::CONSOLE);
+
+    if (IsMuted())
+        return -1;
+
+    int c;
+    if (mInputLog && mInputLog->IsReplaying()) {
+        c = mInputLog->Next();
+    } else {
+        c = ReadChar();
+        if (c >= 0 && mInputLog)
+            mInputLog->Record(c);
+    }
 
-    int nc = -1;
-    if (!mInBuffer.empty()) {
-        nc = mInBuffer.front();
-        mInBuffer.pop();
+    if (c >= 0) {
+        EMU_PROBE1(console_dequeue, c);
+        if (mStats)
+            StatsAdd(mStats->consoleIn, 1);
+        if (Timeline::IsEnabled())
+            Timeline::Instant("input delivered", "console", "char", c);
     }
 
-    return nc;
+    return c;
+}
+
+int Console::ReadChar() {
+    return -1;
 }
 
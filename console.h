@@ -23,10 +23,17 @@
  */
 #pragma once
 
+#include <atomic>
 #include <queue>
 #include <mutex>
+#include <string>
 
-/* encapsulates the console the emulator is started on */
+class InputLog;
+struct StatsSlot;
+
+/* where the guest's console io goes, with no terminal behind it. Input
+ * comes from whatever subclass overrides ReadChar(), TerminalConsole for the
+ * terminal the emulator was started on, HeadlessConsole for batch runs. */
 
 class Console {
 public:
@@ -37,14 +44,34 @@ public:
     Console(const Console &) = delete;
     Console &operator=(const Console &) = delete;
 
-    int Run();
+    virtual void Putchar(char c);
 
-    void Putchar(char c);
+    // next byte of input for the guest, -1 if there isn't one
     int GetNextChar();
 
+    // record every byte handed to the guest, or hand out the bytes of a
+    // recorded log instead of host input. Not owned.
+    void SetInputLog(InputLog *log) { mInputLog = log; }
+
+    // drop output and hold back input, while the guest re-executes a stretch
+    // it has already run once
+    void SetMuted(bool muted) { mMuted = muted; }
+    bool IsMuted() const { return mMuted.load(std::memory_order_relaxed); }
+
+    // count bytes in and out in a system's live stats, not owned
+    void SetStats(StatsSlot *slot) { mStats = slot; }
+
+protected:
+    // host input, whatever has arrived so far
+    virtual int ReadChar();
+
+    StatsSlot *mStats = nullptr;
+
 private:
+    std::atomic<bool> mMuted { false };
+    InputLog *mInputLog = nullptr;
+
     std::queue<char> mOutBuffer;
-    std::queue<char> mInBuffer;
     std::mutex mLock;
 };
 
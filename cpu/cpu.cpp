@@ -23,3 +23,198 @@
  */
 #include "cpu.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "debug/heatmap.h"
+#include "debug/hostprofile.h"
+#include "debug/probes.h"
+#include "debug/rewind.h"
+#include "debug/stats.h"
+#include "debug/timeline.h"
+#include "debug/tracelog.h"
+#include "system/snapshot.h"
+#include "system/system.h"
+
+void Cpu::SetTrace(bool enable) {
+    mTraceEnabled = enable;
+
+    // kick the run loop so it switches to the right variant
+    mSys.RequestBreak();
+}
+
+void Cpu::SetEngine(Engine e) {
+    mEngine = e;
+
+    // kick the run loop so it switches to the right variant
+    mSys.RequestBreak();
+}
+
+void Cpu::SaveState(SnapshotWriter &w) const {
+    w.AddSection("cpu.count", &mInstructionCount, sizeof(mInstructionCount));
+    SaveRegs(w);
+}
+
+int Cpu::LoadState(SnapshotReader &r) {
+    if (strcmp(r.GetCpu(), GetName()) != 0) {
+        fprintf(stderr, "snapshot is for a %s cpu, not %s\n", r.GetCpu(), GetName());
+        return -EINVAL;
+    }
+
+    int err = r.Read("cpu.count", &mInstructionCount, sizeof(mInstructionCount));
+    if (err < 0)
+        return err;
+
+    return LoadRegs(r);
+}
+
+void Cpu::RequestStop() {
+    mStopRequested = true;
+    mSys.RequestBreak();
+}
+
+void Cpu::RequestFlightDump() {
+    mFlightDumpRequested = true;
+    mSys.RequestBreak();
+}
+
+void Cpu::RequestReport() {
+    Stats::RequestReport();
+    HostProfile::RequestReport();
+    if (mHeatmap)
+        mHeatmap->RequestReport();
+    mSys.RequestBreak();
+}
+
+void Cpu::UpdateNextEvent() {
+    mNextEvent = mInstructionLimit;
+    if (mRewind)
+        mNextEvent = std::min(mNextEvent, mRewind->NextCapture());
+    if (mStats)
+        mNextEvent = std::min(mNextEvent, mInstructionCount + kStatsInterval);
+}
+
+bool Cpu::HandleBreak() {
+    if (!Timeline::IsEnabled())
+        return ServiceBreak();
+
+    // the stretch of running that just ended, then the time spent in here
+    uint64_t start = Timeline::Now();
+    Timeline::Span("run", "cpu", mStintStart, mStintInstructions);
+
+    bool stop = ServiceBreak();
+    Timeline::Span("break", "cpu", start, mInstructionCount);
+
+    mStintStart = Timeline::Now();
+    mStintInstructions = mInstructionCount;
+
+    return stop;
+}
+
+bool Cpu::ServiceBreak() {
+    if (mFlightDumpRequested.exchange(false))
+        DumpFlightRecorder("requested");
+
+    if (mStats)
+        Stats::UpdateInstructions(mStats, mInstructionCount);
+
+    if (Stats::TakeReportRequest())
+        Stats::Report(stderr);
+
+    if (HostProfile::TakeReportRequest())
+        HostProfile::Report(stderr);
+
+    if (mHeatmap && mHeatmap->TakeReportRequest())
+        mHeatmap->Report(stderr);
+
+    if (mRewind)
+        mRewind->Service();
+    if (mRewind || mStats)
+        UpdateNextEvent();
+
+    if (mSys.isShutdown()) {
+        printf("cpu: exiting due to shutdown\n");
+        return true;
+    }
+
+    if (mStopRequested.exchange(false))
+        return true;
+
+    return InstructionLimitReached();
+}
+
+void Cpu::BeginSlice() {
+    EMU_PROBE1(slice_begin, mInstructionCount);
+
+    if (!Timeline::IsEnabled())
+        return;
+
+    Timeline::SetThreadCpu(this);
+    mSliceStart = mStintStart = Timeline::Now();
+    mSliceInstructions = mStintInstructions = mInstructionCount;
+}
+
+int Cpu::EndSlice(int err) {
+    EMU_PROBE2(slice_end, mInstructionCount, err);
+
+    if (mStats) {
+        Stats::UpdateInstructions(mStats, mInstructionCount);
+        StatsAdd(mStats->slices, 1);
+    }
+
+    if (Timeline::IsEnabled()) {
+        // dropped out of the run loop without a break to close off the last stretch
+        if (mInstructionCount != mStintInstructions)
+            Timeline::Span("run", "cpu", mStintStart, mStintInstructions);
+        Timeline::Span("slice", "cpu", mSliceStart, mSliceInstructions, "result", err);
+        Timeline::SetThreadCpu(nullptr);
+    }
+
+    // have the trace out before whatever gets printed about why we stopped
+    TraceLog::Flush();
+
+    return err;
+}
+
+void Cpu::FormatFlightRecord(const FlightRecord &r, char *buf, size_t buflen) {
+    char dis[64];
+    char regs[128];
+    DisassembleAt(r.pc, dis, sizeof(dis));
+    FormatFlightRegs(r, regs, sizeof(regs));
+
+    // the disassembly comes from memory as it is now, flag code that has changed since
+    bool modified = mSys.MemPeek8(r.pc) != r.opcode;
+
+    snprintf(buf, buflen, "%10u %04x: %-32s %s%s", r.count, r.pc, dis, regs, modified ? " (modified)" : "");
+}
+
+int Cpu::DumpFlightRecorder(const char *reason, const char *file) {
+    if (!file)
+        file = mFlightFile.c_str();
+    if (!*file)
+        return 0;
+
+    FILE *fp = fopen(file, "w");
+    if (!fp) {
+        fprintf(stderr, "error opening flight recorder file %s\n", file);
+        return -errno;
+    }
+
+    fprintf(fp, "# last %zu instructions before: %s\n", mFlight.Size(), reason);
+    fprintf(fp, "# instruction count %llu\n", (unsigned long long)mInstructionCount);
+
+    for (size_t i = 0; i < mFlight.Size(); i++) {
+        char line[256];
+        FormatFlightRecord(mFlight.Get(i), line, sizeof(line));
+        fprintf(fp, "%s\n", line);
+    }
+
+    fclose(fp);
+
+    fprintf(stderr, "flight recorder written to %s (%s)\n", file, reason);
+
+    return 0;
+}
+
@@ -23,7 +23,40 @@
  */
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "debug/flightrecorder.h"
+
 class System;
+class Profiler;
+class CallGraph;
+class Coverage;
+class Heatmap;
+class Rewind;
+class TraceWriter;
+class SnapshotReader;
+class SnapshotWriter;
+struct StatsSlot;
+
+// which instructions get printed when tracing is on. count is the instruction
+// count including this one, so the first instruction is 1, the same numbering
+// as the flight recorder, the trace file and emu-trace. The range is start up
+// to but not including end.
+struct TraceFilter {
+    uint32_t pcLow = 0;
+    uint32_t pcHigh = 0xffffffff;
+    int opcode = -1; // first opcode byte, -1 for any
+    uint64_t countStart = 0;
+    uint64_t countEnd = UINT64_MAX;
+
+    bool Match(uint32_t pc, uint8_t op, uint64_t count) const {
+        return pc >= pcLow && pc <= pcHigh &&
+               (opcode < 0 || opcode == op) &&
+               count >= countStart && count < countEnd;
+    }
+};
 
 class Cpu {
 public:
@@ -33,9 +66,132 @@ public:
     virtual void Reset() = 0;
     virtual int Run() = 0;
 
-    // debugging
+    // short name of the cpu type, as used on the command line
+    virtual const char *GetName() const = 0;
+
+    // address of the next instruction to execute
+    virtual uint32_t GetPC() const = 0;
+
+    // registers, into the trace log
     virtual void Dump() = 0;
 
+    // disassemble the instruction at pc into buf, returns its length in bytes
+    virtual size_t DisassembleAt(uint32_t pc, char *buf, size_t buflen) = 0;
+
+    uint64_t GetInstructionCount() const { return mInstructionCount; }
+
+    // stop the run loop once this many instructions have executed
+    void SetInstructionLimit(uint64_t limit) { mInstructionLimit = limit; UpdateNextEvent(); }
+    bool InstructionLimitReached() const { return mInstructionCount >= mInstructionLimit; }
+
+    // save state, registers and the instruction count, only while not running
+    void SaveState(SnapshotWriter &w) const;
+    int LoadState(SnapshotReader &r);
+
+    // make Run() return at the next instruction boundary, calling it again picks up
+    // where it left off. Safe to call from other threads and signal handlers.
+    void RequestStop();
+
+    // which run loop executes instructions. The reference engine is the
+    // instrumented interpreter, fast is the one that normally runs.
+    enum class Engine {
+        FAST,
+        REFERENCE,
+    };
+    void SetEngine(Engine e);
+
+    // instrumentation, not owned by the cpu
+    void SetProfiler(Profiler *p) { mProfiler = p; }
+    void SetCallGraph(CallGraph *c) { mCallGraph = c; }
+    void SetCoverage(Coverage *c) { mCoverage = c; }
+    void SetHeatmap(Heatmap *h) { mHeatmap = h; }
+    void SetTraceWriter(TraceWriter *t) { mTraceWriter = t; }
+
+    // periodic state capture for stepping backwards, serviced between instructions
+    void SetRewind(Rewind *r) { mRewind = r; UpdateNextEvent(); }
+
+    // live stats, the instruction count is published every kStatsInterval
+    // instructions and at the end of each Run(). Not owned.
+    static const uint64_t kStatsInterval = 1000000;
+    void SetStats(StatsSlot *s) { mStats = s; UpdateNextEvent(); }
+
+    // instruction tracing, safe to flip from a signal handler while running
+    void SetTrace(bool enable);
+    void ToggleTrace() { SetTrace(!mTraceEnabled); }
+    void SetTraceFilter(const TraceFilter &f) { mTraceFilter = f; }
+
+    // write out the recent instruction history, disassembled. Off until a file
+    // is set, an empty name turns the dumps off again. A file passed to the dump
+    // itself overrides the setting.
+    void SetFlightRecorderFile(const std::string &file) { mFlightFile = file; }
+    int DumpFlightRecorder(const char *reason, const char *file = nullptr);
+
+    // recent history, and one record of it as a line of the dump
+    const FlightRecorder &GetFlightRecorder() const { return mFlight; }
+    void FormatFlightRecord(const FlightRecord &r, char *buf, size_t buflen);
+
+    // ask the run loop to dump the history at the next instruction boundary,
+    // safe to call from a signal handler
+    void RequestFlightDump();
+
+    // have the run loop print the live stats summary, and the host profile and
+    // memory heatmap if they're on, at the next instruction boundary. Safe to
+    // call from a signal handler.
+    void RequestReport();
+
 protected:
+    // the run loops come in two flavors, this picks the slow one
+    bool NeedsInstrumentation() const {
+        return mEngine == Engine::REFERENCE || mTraceEnabled || mProfiler || mCallGraph || mCoverage || mHeatmap ||
+               mTraceWriter;
+    }
+
+    // called by Run() each time the run loop drops out on a break request or
+    // reaching mNextEvent, returns true if the cpu should stop running
+    bool HandleBreak();
+    bool ServiceBreak();
+
+    // Run() calls these on the way in, and passes its return value through
+    // EndSlice on the way out
+    void BeginSlice();
+    int EndSlice(int err);
+
+    // the run loops drop out once the instruction count gets to mNextEvent, the
+    // earlier of the instruction limit and the next rewind capture
+    void UpdateNextEvent();
+
+    // cpu specific part of the save state
+    virtual void SaveRegs(SnapshotWriter &w) const = 0;
+    virtual int LoadRegs(SnapshotReader &r) = 0;
+
+    // cpu specific formatting of the register snapshot in a flight record
+    virtual void FormatFlightRegs(const FlightRecord &r, char *buf, size_t buflen) = 0;
+
     System &mSys;
+    uint64_t mInstructionCount = 0;
+    uint64_t mInstructionLimit = UINT64_MAX;
+    uint64_t mNextEvent = UINT64_MAX;
+    Engine mEngine = Engine::FAST;
+
+    Profiler *mProfiler = nullptr;
+    CallGraph *mCallGraph = nullptr;
+    Coverage *mCoverage = nullptr;
+    Heatmap *mHeatmap = nullptr;
+    TraceWriter *mTraceWriter = nullptr;
+    Rewind *mRewind = nullptr;
+    StatsSlot *mStats = nullptr;
+
+    // timeline spans in progress, the whole Run() and the stretch since the last break
+    uint64_t mSliceStart = 0;
+    uint64_t mSliceInstructions = 0;
+    uint64_t mStintStart = 0;
+    uint64_t mStintInstructions = 0;
+
+    std::atomic<bool> mTraceEnabled { false };
+    TraceFilter mTraceFilter;
+
+    FlightRecorder mFlight;
+    std::string mFlightFile;
+    std::atomic<bool> mFlightDumpRequested { false };
+    std::atomic<bool> mStopRequested { false };
 };
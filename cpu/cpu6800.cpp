@@ -28,11 +28,20 @@
 #include <iostream>
 
 #include "system/system.h"
+#include "debug/callgraph.h"
+#include "debug/coverage.h"
+#include "debug/heatmap.h"
+#include "debug/hostprofile.h"
+#include "debug/probes.h"
+#include "debug/profiler.h"
+#include "debug/timeline.h"
+#include "debug/tracefile.h"
+#include "debug/tracelog.h"
+#include "system/snapshot.h"
 #include "bits.h"
 
-#define TRACE 0
-
-#define TRACEF(str, x...) do { if (TRACE) printf(str, ## x); } while (0)
+// per instruction tracing, only live in the instrumented run loop
+#define TRACEF(str, x...) do { if (Instrumented && trace) TraceLog::Printf(str, ## x); } while (0)
 
 using namespace std;
 
@@ -486,23 +495,57 @@ bool Cpu6800::TestBranchCond(unsigned int cond) {
     PutReg(regnum::REG_SP, __sp); \
 } while (0)
 
-int Cpu6800::Run() {
+inline const FlightRecord &Cpu6800::RecordFlight(uint16_t pc, uint8_t opcode) {
+    FlightRecord &r = mFlight.Next();
+    r.count = mInstructionCount;
+    r.pc = pc;
+    r.opcode = opcode;
+    r.regs[0] = (mA << 8) | mB;
+    r.regs[1] = mIX;
+    r.regs[2] = mSP;
+    r.regs[3] = mCC;
+
+    return r;
+}
 
+template <bool Instrumented>
+int Cpu6800::RunLoop() {
     bool done = false;
     while (!done) {
         uint8_t opcode;
+        bool trace = false;
 
         if (mException) {
             if (mException & EXC_RESET) {
                 // reset, branch to the reset vector
                 mPC = mSys.MemRead16(0xfffe, Endian::BIG);
                 mException = 0; // clear the rest of the pending irqs
+                if (Timeline::IsEnabled())
+                    Timeline::Instant("reset", "interrupt", "vector", mPC);
             }
             assert(!mException);
         }
 
+        if (Instrumented) {
+            if (mProfiler)
+                mProfiler->Tick(mPC);
+            if (mCallGraph)
+                mCallGraph->Tick();
+            if (mCoverage)
+                mCoverage->Execute(mPC);
+            if (mHeatmap)
+                mHeatmap->Fetch();
+        }
+
         // fetch the first byte of the opcode
         opcode = mSys.MemRead8(mPC++);
+        mInstructionCount++;
+        const FlightRecord &rec = RecordFlight(mPC - 1, opcode);
+        if (Instrumented && mTraceWriter)
+            mTraceWriter->Instruction(mInstructionCount, rec);
+
+        if (Instrumented)
+            trace = mTraceEnabled && mTraceFilter.Match(mPC - 1, opcode, mInstructionCount);
 
         const opdecode *op = &ops[opcode];
         uint8_t temp8;
@@ -1002,6 +1045,8 @@ shared_memwrite:
                 TRACEF(" arg %d", arg);
 
                 bool takebranch = TestBranchCond(op->cond);
+                if (Instrumented && mCoverage && op->cond != COND_A && op->cond != COND_N)
+                    mCoverage->Branch(rec.pc, takebranch);
 
                 if (takebranch) {
                     if (arg == -2) {
@@ -1032,6 +1077,9 @@ shared_memwrite:
 
                 PUSH16(mPC);
 
+                if (Instrumented && mCallGraph)
+                    mCallGraph->Call(arg, mPC);
+
                 mPC = arg;
                 break;
             }
@@ -1040,6 +1088,9 @@ shared_memwrite:
 
                 PUSH16(mPC);
 
+                if (Instrumented && mCallGraph)
+                    mCallGraph->Call((mPC + arg) & 0xffff, mPC);
+
                 mPC += arg;
                 TRACEF(" target %#04x", mPC);
                 break;
@@ -1048,6 +1099,9 @@ shared_memwrite:
                 PULL16(temp16);
                 TRACEF(" from stack %#04x", temp16);
 
+                if (Instrumented && mCallGraph)
+                    mCallGraph->Return(temp16);
+
                 mPC = temp16;
                 break;
             }
@@ -1063,37 +1117,153 @@ badop:
                 fflush(stdout);
                 fprintf(stderr, "unhandled opcode %#02x at %#04x\n", opcode, mPC - 1);
                 fflush(stderr);
+                EMU_PROBE3(unhandled_opcode, mPC - 1, opcode, mInstructionCount);
+                DumpFlightRecorder("unhandled opcode");
                 done = true;
         }
 
         TRACEF("\n");
 
-        if (TRACE) {
+        if (Instrumented && trace)
             Dump();
-            fflush(stdout);
+
+        // see if we've been asked to stop or switch run loops
+        if (!done && (mSys.BreakRequested() || mInstructionCount >= mNextEvent))
+            return 1;
+    }
+
+    return 0;
+}
+
+int Cpu6800::Run() {
+    HostProfileRun prof;
+    BeginSlice();
+
+    for (;;) {
+        int err = NeedsInstrumentation() ? RunLoop<true>() : RunLoop<false>();
+        if (err <= 0) {
+            printf("cpu: exiting\n");
+            return EndSlice(err);
         }
 
-        // see if the system has requested a shutdown
-        if (mSys.isShutdown()) {
-            printf("cpu: exiting due to shutdown\n");
-            done = true;
+        mSys.ClearBreak();
+        if (HandleBreak()) {
+            // not at the end of a slice, only when the cpu is done for good
+            if (mSys.isShutdown())
+                printf("cpu: exiting\n");
+            return EndSlice(0);
         }
     }
+}
 
-    printf("cpu: exiting\n");
+namespace {
+struct Cpu6800Regs {
+    uint8_t a, b;
+    uint16_t ix, pc, sp;
+    uint8_t cc;
+    uint8_t pad[3];     // saved raw, no compiler padding
+    uint32_t exception;
+};
+}
+
+void Cpu6800::SaveRegs(SnapshotWriter &w) const {
+    Cpu6800Regs r = { mA, mB, mIX, mPC, mSP, mCC, {}, mException };
+    w.AddSection("cpu", &r, sizeof(r));
+}
 
+int Cpu6800::LoadRegs(SnapshotReader &rd) {
+    Cpu6800Regs r;
+    int err = rd.Read("cpu", &r, sizeof(r));
+    if (err < 0)
+        return err;
+
+    mA = r.a;
+    mB = r.b;
+    mIX = r.ix;
+    mPC = r.pc;
+    mSP = r.sp;
+    mCC = r.cc;
+    mException = r.exception;
     return 0;
 }
 
+void Cpu6800::FormatFlightRegs(const FlightRecord &r, char *buf, size_t buflen) {
+    FormatRegs(r.regs, buf, buflen);
+}
+
+void Cpu6800::FormatRegs(const uint16_t *regs, char *buf, size_t buflen) {
+    snprintf(buf, buflen, "A 0x%02x B 0x%02x X 0x%04x S 0x%04x CC 0x%02x",
+             regs[0] >> 8, regs[0] & 0xff, regs[1], regs[2], regs[3]);
+}
+
+size_t Cpu6800::DisassembleAt(uint32_t pc, char *buf, size_t buflen) {
+    uint8_t bytes[kMaxInstructionBytes];
+    for (size_t i = 0; i < sizeof(bytes); i++)
+        bytes[i] = mSys.MemPeek8((pc + i) & 0xffff);
+
+    return Disassemble(pc, bytes, buf, buflen);
+}
+
+size_t Cpu6800::Disassemble(uint32_t pc, const uint8_t *bytes, char *buf, size_t buflen) {
+    const opdecode *op = &ops[bytes[0]];
+    if (op->op == BADOP) {
+        snprintf(buf, buflen, "??? %02x", bytes[0]);
+        return 1;
+    }
+
+    size_t len = 1;
+    char operand[16] = "";
+    switch (op->mode) {
+        default:
+        case IMPLIED:
+            break;
+        case IMMEDIATE:
+            if (op->width == 1) {
+                snprintf(operand, sizeof(operand), "#$%02x", bytes[1]);
+            } else {
+                snprintf(operand, sizeof(operand), "#$%02x%02x", bytes[1], bytes[2]);
+            }
+            len += op->width;
+            break;
+        case DIRECT:
+            snprintf(operand, sizeof(operand), "<$%02x", bytes[1]);
+            len += 1;
+            break;
+        case EXTENDED:
+            snprintf(operand, sizeof(operand), "$%02x%02x", bytes[1], bytes[2]);
+            len += 2;
+            break;
+        case BRANCH: {
+            int off = (op->width == 1) ? SignExtend(bytes[1]) : SignExtend((uint16_t)((bytes[1] << 8) | bytes[2]));
+            len += op->width;
+            snprintf(operand, sizeof(operand), "$%04x", (unsigned)((pc + len + off) & 0xffff));
+            break;
+        }
+        case INDEXED:
+            snprintf(operand, sizeof(operand), "$%02x,x", bytes[1]);
+            len += 1;
+            break;
+    }
+
+    // raw bytes, then the mnemonic
+    char raw[3 * kMaxInstructionBytes + 1] = "";
+    for (size_t i = 0; i < len; i++)
+        snprintf(raw + i * 3, sizeof(raw) - i * 3, "%02x ", bytes[i]);
+
+    snprintf(buf, buflen, "%-9s %s %s", raw, op->name, operand);
+
+    return len;
+}
+
 void Cpu6800::Dump() {
-    printf("A 0x%02x B 0x%02x X 0x%04x S 0x%04x CC 0x%02x (%c%c%c%c%c) PC 0x%04x\n",
-             mA, mB, mIX, mSP, mCC,
-             (mCC & CC_H) ? 'h' : ' ',
-             (mCC & CC_N) ? 'n' : ' ',
-             (mCC & CC_Z) ? 'z' : ' ',
-             (mCC & CC_V) ? 'v' : ' ',
-             (mCC & CC_C) ? 'c' : ' ',
-             mPC);
+    TraceLog::Printf("A 0x%02x B 0x%02x X 0x%04x S 0x%04x CC 0x%02x (%c%c%c%c%c) PC 0x%04x\n",
+                     mA, mB, mIX, mSP, mCC,
+                     (mCC & CC_H) ? 'h' : ' ',
+                     (mCC & CC_N) ? 'n' : ' ',
+                     (mCC & CC_Z) ? 'z' : ' ',
+                     (mCC & CC_V) ? 'v' : ' ',
+                     (mCC & CC_C) ? 'c' : ' ',
+                     mPC);
 }
 
 uint16_t Cpu6800::GetReg(regnum r) {
@@ -36,7 +36,19 @@ public:
     virtual void Reset() override;
     virtual int Run() override;
 
+    virtual const char *GetName() const override { return "6800"; }
+    virtual uint32_t GetPC() const override { return mPC; }
+
     virtual void Dump() override;
+    virtual size_t DisassembleAt(uint32_t pc, char *buf, size_t buflen) override;
+
+    static const size_t kMaxInstructionBytes = 3;
+
+    // disassemble from a buffer of kMaxInstructionBytes, returns the instruction length
+    static size_t Disassemble(uint32_t pc, const uint8_t *bytes, char *buf, size_t buflen);
+
+    // format a register snapshot as taken for the flight recorder
+    static void FormatRegs(const uint16_t *regs, char *buf, size_t buflen);
 
     // registers
     enum class regnum {
@@ -48,7 +60,18 @@ public:
         REG_CC,
     };
 
+protected:
+    virtual void SaveRegs(SnapshotWriter &w) const override;
+    virtual int LoadRegs(SnapshotReader &r) override;
+
+    virtual void FormatFlightRegs(const FlightRecord &r, char *buf, size_t buflen) override;
+
 private:
+    template <bool Instrumented>
+    int RunLoop();
+
+    const FlightRecord &RecordFlight(uint16_t pc, uint8_t opcode);
+
     uint16_t GetReg(regnum r);
     uint16_t PutReg(regnum r, uint16_t val); // returns old value
 
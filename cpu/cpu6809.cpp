@@ -28,11 +28,20 @@
 #include <iostream>
 
 #include "system/system.h"
+#include "debug/callgraph.h"
+#include "debug/coverage.h"
+#include "debug/heatmap.h"
+#include "debug/hostprofile.h"
+#include "debug/probes.h"
+#include "debug/profiler.h"
+#include "debug/timeline.h"
+#include "debug/tracefile.h"
+#include "debug/tracelog.h"
+#include "system/snapshot.h"
 #include "bits.h"
 
-#define TRACE 0
-
-#define TRACEF(str, x...) do { if (TRACE) printf(str, ## x); } while (0)
+// per instruction tracing, only live in the instrumented run loop
+#define TRACEF(str, x...) do { if (Instrumented && trace) TraceLog::Printf(str, ## x); } while (0)
 
 using namespace std;
 
@@ -567,23 +576,59 @@ bool Cpu6809::TestBranchCond(unsigned int cond) {
     PutReg(stack, __sp); \
 } while (0)
 
-int Cpu6809::Run() {
+inline const FlightRecord &Cpu6809::RecordFlight(uint16_t pc, uint8_t opcode) {
+    FlightRecord &r = mFlight.Next();
+    r.count = mInstructionCount;
+    r.pc = pc;
+    r.opcode = opcode;
+    r.regs[0] = mD;
+    r.regs[1] = mX;
+    r.regs[2] = mY;
+    r.regs[3] = mU;
+    r.regs[4] = mS;
+    r.regs[5] = (mDP << 8) | mCC;
+
+    return r;
+}
 
+template <bool Instrumented>
+int Cpu6809::RunLoop() {
     bool done = false;
     while (!done) {
         uint8_t opcode;
+        bool trace = false;
 
         if (mException) {
             if (mException & EXC_RESET) {
                 // reset, branch to the reset vector
                 mPC = mSys.MemRead16(0xfffe, Endian::BIG);
                 mException = 0; // clear the rest of the pending irqs
+                if (Timeline::IsEnabled())
+                    Timeline::Instant("reset", "interrupt", "vector", mPC);
             }
             assert(!mException);
         }
 
+        if (Instrumented) {
+            if (mProfiler)
+                mProfiler->Tick(mPC);
+            if (mCallGraph)
+                mCallGraph->Tick();
+            if (mCoverage)
+                mCoverage->Execute(mPC);
+            if (mHeatmap)
+                mHeatmap->Fetch();
+        }
+
         // fetch the first byte of the opcode
         opcode = mSys.MemRead8(mPC++);
+        mInstructionCount++;
+        const FlightRecord &rec = RecordFlight(mPC - 1, opcode);
+        if (Instrumented && mTraceWriter)
+            mTraceWriter->Instruction(mInstructionCount, rec);
+
+        if (Instrumented)
+            trace = mTraceEnabled && mTraceFilter.Match(mPC - 1, opcode, mInstructionCount);
 
         TRACEF("opcode");
 
@@ -611,6 +656,8 @@ int Cpu6809::Run() {
         if (op->op == BADOP) {
             TRACEF("\n");
             fprintf(stdout, "unhandled opcode %#02x at %#04x\n", opcode, mPC - 1);
+            EMU_PROBE3(unhandled_opcode, mPC - 1, opcode, mInstructionCount);
+            DumpFlightRecorder("unhandled opcode");
             return -1;
         }
 
@@ -1284,6 +1331,10 @@ shared_memwrite:
                 if (BIT(arg, 7)) {
                     TRACEF(" PC");
                     PULL16(op->targetreg, mPC);
+
+                    // puls pc is the usual way out of a routine that saved registers
+                    if (Instrumented && mCallGraph && op->targetreg == REG_S)
+                        mCallGraph->Return(mPC);
                 }
                 break;
             }
@@ -1291,6 +1342,8 @@ shared_memwrite:
                 TRACEF(" arg %d", arg);
 
                 bool takebranch = TestBranchCond(op->cond);
+                if (Instrumented && mCoverage && op->cond != COND_A && op->cond != COND_N)
+                    mCoverage->Branch(rec.pc, takebranch);
 
                 if (takebranch) {
                     if (arg == -2) {
@@ -1309,6 +1362,9 @@ shared_memwrite:
 
                 PUSH16(REG_S, mPC);
 
+                if (Instrumented && mCallGraph)
+                    mCallGraph->Call((mPC + arg) & 0xffff, mPC);
+
                 mPC += arg;
                 TRACEF(" target %#04x", mPC);
                 break;
@@ -1330,6 +1386,9 @@ shared_memwrite:
 
                 PUSH16(REG_S, mPC);
 
+                if (Instrumented && mCallGraph)
+                    mCallGraph->Call(arg, mPC);
+
                 mPC = arg;
                 break;
             }
@@ -1337,6 +1396,9 @@ shared_memwrite:
                 PULL16(REG_S, temp16);
                 TRACEF(" from stack %#04x", temp16);
 
+                if (Instrumented && mCallGraph)
+                    mCallGraph->Return(temp16);
+
                 mPC = temp16;
                 break;
             }
@@ -1367,39 +1429,213 @@ shared_memwrite:
                 fflush(stdout);
                 fprintf(stderr, "unhandled opcode %#02x\n", op->op);
                 fflush(stderr);
+                EMU_PROBE3(unhandled_opcode, rec.pc, op->op, mInstructionCount);
+                DumpFlightRecorder("unhandled opcode");
                 done = true;
         }
 
         TRACEF("\n");
 
-        if (TRACE) {
+        if (Instrumented && trace)
             Dump();
-            fflush(stdout);
-        }
 
-        // see if the system has requested a shutdown
-        if (mSys.isShutdown()) {
-            printf("cpu: exiting due to shutdown\n");
-            done = true;
-        }
+        // see if we've been asked to stop or switch run loops
+        if (!done && (mSys.BreakRequested() || mInstructionCount >= mNextEvent))
+            return 1;
     }
 
     return 0;
 }
 
+int Cpu6809::Run() {
+    HostProfileRun prof;
+    BeginSlice();
+
+    for (;;) {
+        int err = NeedsInstrumentation() ? RunLoop<true>() : RunLoop<false>();
+        if (err <= 0)
+            return EndSlice(err);
+
+        mSys.ClearBreak();
+        if (HandleBreak())
+            return EndSlice(0);
+    }
+}
+
 void Cpu6809::Dump() {
-    char str[256];
-
-    snprintf(str, sizeof(str), "A 0x%02x B 0x%02x D 0x%04x X 0x%04x Y 0x%04x U 0x%04x S 0x%04x DP 0x%02x CC 0x%02x (%c%c%c%c%c) PC 0x%04x",
-             mA, mB, mD, mX, mY, mU, mS, mDP, mCC,
-             (mCC & CC_H) ? 'h' : ' ',
-             (mCC & CC_N) ? 'n' : ' ',
-             (mCC & CC_Z) ? 'z' : ' ',
-             (mCC & CC_V) ? 'v' : ' ',
-             (mCC & CC_C) ? 'c' : ' ',
-             mPC);
-
-    printf("%s\n", str);
+    TraceLog::Printf("A 0x%02x B 0x%02x D 0x%04x X 0x%04x Y 0x%04x U 0x%04x S 0x%04x DP 0x%02x CC 0x%02x (%c%c%c%c%c) PC 0x%04x\n",
+                     mA, mB, mD, mX, mY, mU, mS, mDP, mCC,
+                     (mCC & CC_H) ? 'h' : ' ',
+                     (mCC & CC_N) ? 'n' : ' ',
+                     (mCC & CC_Z) ? 'z' : ' ',
+                     (mCC & CC_V) ? 'v' : ' ',
+                     (mCC & CC_C) ? 'c' : ' ',
+                     mPC);
+}
+
+namespace {
+struct Cpu6809Regs {
+    uint16_t d, x, y, u, s, pc;
+    uint8_t dp, cc;
+    uint8_t pad[2];     // saved raw, no compiler padding
+    uint32_t exception;
+};
+}
+
+void Cpu6809::SaveRegs(SnapshotWriter &w) const {
+    Cpu6809Regs r = { mD, mX, mY, mU, mS, mPC, mDP, mCC, {}, mException };
+    w.AddSection("cpu", &r, sizeof(r));
+}
+
+int Cpu6809::LoadRegs(SnapshotReader &rd) {
+    Cpu6809Regs r;
+    int err = rd.Read("cpu", &r, sizeof(r));
+    if (err < 0)
+        return err;
+
+    mD = r.d;
+    mX = r.x;
+    mY = r.y;
+    mU = r.u;
+    mS = r.s;
+    mPC = r.pc;
+    mDP = r.dp;
+    mCC = r.cc;
+    mException = r.exception;
+    return 0;
+}
+
+void Cpu6809::FormatFlightRegs(const FlightRecord &r, char *buf, size_t buflen) {
+    FormatRegs(r.regs, buf, buflen);
+}
+
+void Cpu6809::FormatRegs(const uint16_t *regs, char *buf, size_t buflen) {
+    snprintf(buf, buflen, "D 0x%04x X 0x%04x Y 0x%04x U 0x%04x S 0x%04x DP 0x%02x CC 0x%02x",
+             regs[0], regs[1], regs[2], regs[3], regs[4], regs[5] >> 8, regs[5] & 0xff);
+}
+
+size_t Cpu6809::DisassembleAt(uint32_t pc, char *buf, size_t buflen) {
+    uint8_t bytes[kMaxInstructionBytes];
+    for (size_t i = 0; i < sizeof(bytes); i++)
+        bytes[i] = mSys.MemPeek8((pc + i) & 0xffff);
+
+    return Disassemble(pc, bytes, buf, buflen);
+}
+
+size_t Cpu6809::Disassemble(uint32_t pc, const uint8_t *bytes, char *buf, size_t buflen) {
+    static const char *const idxreg[] = { "x", "y", "u", "s" };
+
+    size_t len = 1;
+    const opdecode *op = &ops[bytes[0]];
+    if (bytes[0] == 0x10 || bytes[0] == 0x11) {
+        op = &ops[bytes[1] + ((bytes[0] == 0x10) ? 0x100 : 0x200)];
+        len++;
+    }
+
+    if (op->op == BADOP) {
+        snprintf(buf, buflen, "??? %02x", bytes[0]);
+        return 1;
+    }
+
+    // operand bytes start after the opcode
+    const uint8_t *operands = bytes + len;
+    auto byte = [&](size_t i) -> uint8_t { return operands[i]; };
+    auto word = [&](size_t i) -> uint16_t { return (operands[i] << 8) | operands[i + 1]; };
+
+    char operand[32] = "";
+    switch (op->mode) {
+        default:
+        case IMPLIED:
+            // exg/tfr carry a register postbyte
+            if (op->op == EXG || op->op == TFR) {
+                snprintf(operand, sizeof(operand), "$%02x", byte(0));
+                len += 1;
+            }
+            break;
+        case IMMEDIATE:
+            if (op->width == 1) {
+                snprintf(operand, sizeof(operand), "#$%02x", byte(0));
+            } else {
+                snprintf(operand, sizeof(operand), "#$%04x", word(0));
+            }
+            len += op->width;
+            break;
+        case DIRECT:
+            snprintf(operand, sizeof(operand), "<$%02x", byte(0));
+            len += 1;
+            break;
+        case EXTENDED:
+            snprintf(operand, sizeof(operand), "$%04x", word(0));
+            len += 2;
+            break;
+        case BRANCH: {
+            int off = (op->width == 1) ? SignExtend(byte(0)) : SignExtend(word(0));
+            len += op->width;
+            snprintf(operand, sizeof(operand), "$%04x", (unsigned)((pc + len + off) & 0xffff));
+            break;
+        }
+        case INDEXED: {
+            uint8_t pb = byte(0);
+            const char *r = idxreg[BITS_SHIFT(pb, 6, 5)];
+            len += 1;
+
+            if (BIT(pb, 7) == 0) {
+                snprintf(operand, sizeof(operand), "%d,%s", SignExtend(BITS(pb, 4, 0), 4), r);
+                break;
+            }
+
+            char inner[24];
+            switch (BITS(pb, 3, 0)) {
+                case 0x0: snprintf(inner, sizeof(inner), ",%s+", r); break;
+                case 0x1: snprintf(inner, sizeof(inner), ",%s++", r); break;
+                case 0x2: snprintf(inner, sizeof(inner), ",-%s", r); break;
+                case 0x3: snprintf(inner, sizeof(inner), ",--%s", r); break;
+                case 0x4: snprintf(inner, sizeof(inner), ",%s", r); break;
+                case 0x5: snprintf(inner, sizeof(inner), "b,%s", r); break;
+                case 0x6: snprintf(inner, sizeof(inner), "a,%s", r); break;
+                case 0x8:
+                    snprintf(inner, sizeof(inner), "%d,%s", SignExtend(byte(1)), r);
+                    len += 1;
+                    break;
+                case 0x9:
+                    snprintf(inner, sizeof(inner), "%d,%s", SignExtend(word(1)), r);
+                    len += 2;
+                    break;
+                case 0xb: snprintf(inner, sizeof(inner), "d,%s", r); break;
+                case 0xc:
+                    snprintf(inner, sizeof(inner), "%d,pc", SignExtend(byte(1)));
+                    len += 1;
+                    break;
+                case 0xd:
+                    snprintf(inner, sizeof(inner), "%d,pc", SignExtend(word(1)));
+                    len += 2;
+                    break;
+                case 0xf:
+                    snprintf(inner, sizeof(inner), "$%04x", word(1));
+                    len += 2;
+                    break;
+                default:
+                    snprintf(inner, sizeof(inner), "???");
+                    break;
+            }
+
+            if (BIT(pb, 4)) {
+                snprintf(operand, sizeof(operand), "[%s]", inner);
+            } else {
+                snprintf(operand, sizeof(operand), "%s", inner);
+            }
+            break;
+        }
+    }
+
+    // raw bytes, then the mnemonic
+    char raw[3 * kMaxInstructionBytes + 1] = "";
+    for (size_t i = 0; i < len; i++)
+        snprintf(raw + i * 3, sizeof(raw) - i * 3, "%02x ", bytes[i]);
+
+    snprintf(buf, buflen, "%-15s %s %s", raw, op->name, operand);
+
+    return len;
 }
 
 uint16_t Cpu6809::GetReg(regnum r) {
@@ -28,11 +28,22 @@
 #include <iostream>
 
 #include "system/system.h"
+#include "debug/callgraph.h"
+#include "debug/coverage.h"
+#include "debug/heatmap.h"
+#include "debug/hostprofile.h"
+#include "debug/probes.h"
+#include "debug/profiler.h"
+#include "debug/tracefile.h"
+#include "system/snapshot.h"
 #include "bits.h"
 #include "trace.h"
 
 #define LOCAL_TRACE 0
 
+// per instruction tracing, only live in the instrumented run loop
+#define TPRINTF(x...) do { if (Instrumented && trace) { TraceLog::Printf(x); } } while (0)
+
 // TODO: double check that z80 is little endian in all uses of MemReadWrite16
 using Endian = System::Endian;
 
@@ -319,7 +330,31 @@ void CpuZ80::set_flags(uint8_t val) {
     set_flag(FLAG_C, 0);
 }
 
-int CpuZ80::Run() {
+inline const FlightRecord &CpuZ80::RecordFlight(uint16_t pc, uint8_t opcode) {
+    FlightRecord &r = mFlight.Next();
+    r.count = mInstructionCount;
+    r.pc = pc;
+    r.opcode = opcode;
+    r.regs[0] = READ_AF();
+    r.regs[1] = READ_BC();
+    r.regs[2] = READ_DE();
+    r.regs[3] = READ_HL();
+    r.regs[4] = mRegs.sp;
+    r.regs[5] = mRegs.ix;
+    r.regs[6] = mRegs.iy;
+
+    return r;
+}
+
+template <bool Instrumented>
+inline bool CpuZ80::branch(uint16_t pc, bool taken) {
+    if (Instrumented && mCoverage)
+        mCoverage->Branch(pc, taken);
+    return taken;
+}
+
+template <bool Instrumented>
+int CpuZ80::RunLoop() {
     LTRACEF("Run\n");
 
     int dd;
@@ -327,15 +362,34 @@ int CpuZ80::Run() {
     for (;;) {
         uint8_t temp8;
         uint16_t temp16;
+        bool trace = false;
+
+        if (Instrumented) {
+            if (mProfiler)
+                mProfiler->Tick(mRegs.pc);
+            if (mCallGraph)
+                mCallGraph->Tick();
+            if (mCoverage)
+                mCoverage->Execute(mRegs.pc);
+            if (mHeatmap)
+                mHeatmap->Fetch();
+        }
 
         uint8_t op = mSys.MemRead8(mRegs.pc++);
+        mInstructionCount++;
+        const FlightRecord &rec = RecordFlight(mRegs.pc - 1, op);
+        if (Instrumented && mTraceWriter)
+            mTraceWriter->Instruction(mInstructionCount, rec);
+
+        if (Instrumented)
+            trace = mTraceEnabled && mTraceFilter.Match(mRegs.pc - 1, op, mInstructionCount);
 
         // look for certain prefixes
         if (op == 0xed) {
             // ed prefix is a whole new space
             op = mSys.MemRead8(mRegs.pc++);
 
-            LPRINTF("PC 0x%04hx: op ed%02hhx - ", (uint16_t)(mRegs.pc - 2), op);
+            TPRINTF("PC 0x%04hx: op ed%02hhx - ", (uint16_t)(mRegs.pc - 2), op);
             switch (op) {
                 case 0b01000001:
                 case 0b01001001:
@@ -345,7 +399,7 @@ int CpuZ80::Run() {
                 case 0b01101001:
 //              case 0b01110001: /* doesn't officially exist */
                 case 0b01111001: // OUT (C), r
-                    LPRINTF("OUT (C), r\n");
+                    TPRINTF("OUT (C), r\n");
                     if (BITS_SHIFT(op, 5, 3) == 0b110) { // OUT (c), 0
                         temp8 = 0;
                     } else {
@@ -354,12 +408,12 @@ int CpuZ80::Run() {
                     out(mRegs.c, temp8);
                     break;
                 case 0b10110000: // LDIR
-                    LPRINTF("LDIR\n");
+                    TPRINTF("LDIR\n");
 
                     temp8 = mSys.MemRead8(READ_HL());
                     mSys.MemWrite8(READ_DE(), temp8);
 
-                    LPRINTF("copying from 0x%x to 0x%x value 0x%hhx\n", READ_HL(), READ_DE(), temp8);
+                    TPRINTF("copying from 0x%x to 0x%x value 0x%hhx\n", READ_HL(), READ_DE(), temp8);
 
                     WRITE_HL(READ_HL() + 1);
                     WRITE_DE(READ_DE() + 1);
@@ -375,7 +429,7 @@ int CpuZ80::Run() {
                 case 0b01010011:
                 case 0b01100011:
                 case 0b01110011: // LD (nn), dd
-                    LPRINTF("LD (nn), dd\n");
+                    TPRINTF("LD (nn), dd\n");
 
                     temp16 = read_dd_reg(BITS_SHIFT(op, 5, 4));
                     mSys.MemWrite16(read_nn(), temp16, Endian::LITTLE);
@@ -384,24 +438,26 @@ int CpuZ80::Run() {
                 case 0b01011011:
                 case 0b01101011:
                 case 0b01111011: // LD dd, (nn)
-                    LPRINTF("LD dd, (nn)\n");
+                    TPRINTF("LD dd, (nn)\n");
 
                     temp16 = mSys.MemRead16(read_nn(), Endian::LITTLE);
                     write_dd_reg(BITS_SHIFT(op, 5, 4), temp16);
                     break;
                 default:
                     fprintf(stderr, "unhandled ED prefixed-opcode 0x%hhx\n", op);
+                    EMU_PROBE3(unhandled_opcode, rec.pc, 0xed00 | op, mInstructionCount);
+                    DumpFlightRecorder("unhandled opcode");
                     return -1;
             }
         } else if (op == 0xcb) {
             // cb prefix are for bit instructions
             op = mSys.MemRead8(mRegs.pc++);
 
-            LPRINTF("PC 0x%04hx: op cb%02hhx - ", (uint16_t)(mRegs.pc - 2), op);
+            TPRINTF("PC 0x%04hx: op cb%02hhx - ", (uint16_t)(mRegs.pc - 2), op);
             switch (op) {
                 case 0x40 ... 0x7f: { // BIT
                     uint8_t bit = BITS_SHIFT(op, 6, 3);
-                    LPRINTF("RES %u, r\n", bit);
+                    TPRINTF("RES %u, r\n", bit);
 
                     temp8 = read_r_reg_or_hl(BITS(op, 2, 0)) & (1<<bit);
                     set_flag(FLAG_Z, temp8);
@@ -409,30 +465,32 @@ int CpuZ80::Run() {
                 }
                 case 0x80 ... 0xbf: { // RES
                     uint8_t bit = BITS_SHIFT(op, 6, 3);
-                    LPRINTF("RES %u, r\n", bit);
+                    TPRINTF("RES %u, r\n", bit);
 
                     write_r_reg_or_hl(BITS(op, 2, 0), read_r_reg_or_hl(BITS(op, 2, 0)) & ~(1<<bit));
                     break;
                 }
                 case 0xc0 ... 0xff: { // SET
                     uint8_t bit = BITS_SHIFT(op, 6, 3);
-                    LPRINTF("SET %u, r\n", bit);
+                    TPRINTF("SET %u, r\n", bit);
 
                     write_r_reg_or_hl(BITS(op, 2, 0), read_r_reg_or_hl(BITS(op, 2, 0)) | (1<<bit));
                     break;
                 }
                 default:
                     fprintf(stderr, "unhandled CB prefixed-opcode 0x%hhx\n", op);
+                    EMU_PROBE3(unhandled_opcode, rec.pc, 0xcb00 | op, mInstructionCount);
+                    DumpFlightRecorder("unhandled opcode");
                     return -1;
             }
         } else {
-            LPRINTF("PC 0x%04hx: op %02hhx - ", (uint16_t)(mRegs.pc - 1), op);
+            TPRINTF("PC 0x%04hx: op %02hhx - ", (uint16_t)(mRegs.pc - 1), op);
             switch (op) {
                 case 0x00: // NOP
-                    LPRINTF("NOP\n");
+                    TPRINTF("NOP\n");
                     break;
                 case 0b11000011: // JP nn
-                    LPRINTF("JP nn\n");
+                    TPRINTF("JP nn\n");
                     mRegs.pc = read_nn();
                     break;
                 case 0b11000010:
@@ -443,18 +501,20 @@ int CpuZ80::Run() {
                 case 0b11101010:
                 case 0b11110010:
                 case 0b11111010: { // JP cc, nn
-                    LPRINTF("JP cc, nn\n");
+                    TPRINTF("JP cc, nn\n");
                     int cond = BITS_SHIFT(op, 5, 3);
                     temp16 = read_nn();
 
-                    if (test_cond(cond))
+                    if (branch<Instrumented>(rec.pc, test_cond(cond)))
                         mRegs.pc = temp16;
                     break;
                 }
                 case 0b11001101: // CALL nn
-                    LPRINTF("CALL nn\n");
+                    TPRINTF("CALL nn\n");
                     temp16 = read_nn();
                     push_pc();
+                    if (Instrumented && mCallGraph)
+                        mCallGraph->Call(temp16, mRegs.pc);
                     mRegs.pc = temp16;
                     break;
                 case 0b11000100:
@@ -465,20 +525,39 @@ int CpuZ80::Run() {
                 case 0b11101100:
                 case 0b11110100:
                 case 0b11111100: { // CALL cc, nn
-                    LPRINTF("CALL cc, nn\n");
+                    TPRINTF("CALL cc, nn\n");
                     int cond = BITS_SHIFT(op, 5, 3);
                     temp16 = read_nn();
 
-                    if (test_cond(cond)) {
+                    if (branch<Instrumented>(rec.pc, test_cond(cond))) {
                         push_pc();
+                        if (Instrumented && mCallGraph)
+                            mCallGraph->Call(temp16, mRegs.pc);
                         mRegs.pc = temp16;
                     }
                     break;
                 }
 
+                case 0b11000111:
+                case 0b11001111:
+                case 0b11010111:
+                case 0b11011111:
+                case 0b11100111:
+                case 0b11101111:
+                case 0b11110111:
+                case 0b11111111: // RST p
+                    TPRINTF("RST p\n");
+                    push_pc();
+                    if (Instrumented && mCallGraph)
+                        mCallGraph->Call(BITS(op, 5, 3), mRegs.pc);
+                    mRegs.pc = BITS(op, 5, 3);
+                    break;
+
                 case 0b11001001: // RET
-                    LPRINTF("RET\n");
+                    TPRINTF("RET\n");
                     mRegs.pc = pop16();
+                    if (Instrumented && mCallGraph)
+                        mCallGraph->Return(mRegs.pc);
                     break;
 
                 case 0b11000000:
@@ -489,85 +568,88 @@ int CpuZ80::Run() {
                 case 0b11101000:
                 case 0b11110000:
                 case 0b11111000: { // RET cc
-                    LPRINTF("RET cc\n");
+                    TPRINTF("RET cc\n");
                     int cond = BITS_SHIFT(op, 5, 3);
 
-                    if (test_cond(cond)) {
+                    if (branch<Instrumented>(rec.pc, test_cond(cond))) {
                         mRegs.pc = pop16();
+                        if (Instrumented && mCallGraph)
+                            mCallGraph->Return(mRegs.pc);
                     }
                     break;
                 }
 
                 case 0b00010000: { // DJNZ
-                    LPRINTF("DJNZ, e\n");
+                    TPRINTF("DJNZ, e\n");
                     int8_t rel = read_n();
                     mRegs.b--;
-                    if (mRegs.b) {
+                    if (branch<Instrumented>(rec.pc, mRegs.b)) {
                         mRegs.pc += rel;
                     }
                     break;
                 }
                 case 0b00011000: { // JR e
-                    LPRINTF("JR e\n");
+                    TPRINTF("JR e\n");
                     int8_t rel = read_n();
                     mRegs.pc += rel;
                     break;
                 }
                 case 0b00111000: { // JR C, e
-                    LPRINTF("JR C, e\n");
+                    TPRINTF("JR C, e\n");
                     int8_t rel = read_n();
-                    if (get_flag(FLAG_C))
+                    if (branch<Instrumented>(rec.pc, get_flag(FLAG_C)))
                         mRegs.pc += rel;
                     break;
                 }
                 case 0b00110000: { // JR NC, e
-                    LPRINTF("JR NC, e\n");
+                    TPRINTF("JR NC, e\n");
                     int8_t rel = read_n();
-                    if (!get_flag(FLAG_C))
+                    if (branch<Instrumented>(rec.pc, !get_flag(FLAG_C)))
                         mRegs.pc += rel;
                     break;
                 }
                 case 0b00101000: { // JR Z, e
-                    LPRINTF("JR Z, e\n");
+                    TPRINTF("JR Z, e\n");
                     int8_t rel = read_n();
-                    if (get_flag(FLAG_Z))
+                    if (branch<Instrumented>(rec.pc, get_flag(FLAG_Z)))
                         mRegs.pc += rel;
                     break;
                 }
                 case 0b00100000: { // JR NZ, e
-                    LPRINTF("JR NZ, e\n");
+                    TPRINTF("JR NZ, e\n");
                     int8_t rel = read_n();
-                    if (!get_flag(FLAG_Z))
+                    if (branch<Instrumented>(rec.pc, !get_flag(FLAG_Z)))
                         mRegs.pc += rel;
                     break;
                 }
                 case 0b11110011: // DI
-                    LPRINTF("DI\n");
+                    TPRINTF("DI\n");
                     mRegs.iff = 0;
                     break;
                 case 0b11111011: // EI
-                    LPRINTF("EI\n");
+                    TPRINTF("EI\n");
                     mRegs.iff = 1;
                     break;
 
                 case 0b11010011: // OUT (n), A
-                    LPRINTF("OUT (n), A\n");
+                    TPRINTF("OUT (n), A\n");
                     out(read_n(), mRegs.a);
                     break;
 
                 case 0b11011011: // IN A, (n)
-                    LPRINTF("IN A, (n)\n");
+                    TPRINTF("IN A, (n)\n");
                     mRegs.a = in(read_n());
                     break;
 
                 case 0b01000000 ... 0b01111111: { // LD r, r or LD r, (HL)
-                    LPRINTF("LD r, r\n");
+                    TPRINTF("LD r, r\n");
 
                     int r = BITS_SHIFT(op, 5, 3);
                     int r2 = BITS_SHIFT(op, 2, 0);
 
                     if (r == r2 && r == 0b110) { // HALT
                         printf("unhandled halt opcode\n");
+                        DumpFlightRecorder("halt");
                         return -1;
                     }
 
@@ -576,15 +658,15 @@ int CpuZ80::Run() {
                 }
 
                 case 0b00110010: // LD (nn), A
-                    LPRINTF("LD (nn), A)\n");
+                    TPRINTF("LD (nn), A)\n");
                     mSys.MemWrite8(read_nn(), mRegs.a);
                     break;
                 case 0b00000010: // LD (BC), A
-                    LPRINTF("LD (BC), A)\n");
+                    TPRINTF("LD (BC), A)\n");
                     mSys.MemWrite8(READ_BC(), mRegs.a);
                     break;
                 case 0b00010010: // LD (DE), A
-                    LPRINTF("LD (DE), A)\n");
+                    TPRINTF("LD (DE), A)\n");
                     mSys.MemWrite8(READ_DE(), mRegs.a);
                     break;
 
@@ -595,55 +677,55 @@ int CpuZ80::Run() {
                 case 0b00100110:
                 case 0b00101110:
                 case 0b00111110: // LD r, n
-                    LPRINTF("LD r, n\n");
+                    TPRINTF("LD r, n\n");
                     write_r_reg(BITS_SHIFT(op, 5, 3), read_n());
                     break;
                 case 0b00110110: // LD (HL), n
-                    LPRINTF("LD (HL), n\n");
+                    TPRINTF("LD (HL), n\n");
                     mSys.MemWrite8(READ_HL(), read_n());
                     break;
                 case 0b00000001:
                 case 0b00010001:
                 case 0b00100001:
                 case 0b00110001: // LD dd, nn
-                    LPRINTF("LD dd, nn\n");
+                    TPRINTF("LD dd, nn\n");
                     dd = BITS_SHIFT(op, 5, 4);
                     write_dd_reg(dd, read_nn());
                     break;
 
                 case 0b00100010: // LD (nn), HL
-                    LPRINTF("LD (nn), HL\n");
+                    TPRINTF("LD (nn), HL\n");
                     temp16 = read_nn();
 
                     mSys.MemWrite8(temp16, mRegs.l);
                     mSys.MemWrite8(temp16 + 1, mRegs.h);
                     break;
                 case 0b00101010: // LD HL, (nn)
-                    LPRINTF("LD HL, (nn)\n");
+                    TPRINTF("LD HL, (nn)\n");
                     temp16 = read_nn();
 
                     mRegs.l = mSys.MemRead8(temp16);
                     mRegs.h = mSys.MemRead8(temp16 + 1);
                     break;
                 case 0b00111010: // LD A, (nn)
-                    LPRINTF("LD A, (nn)\n");
+                    TPRINTF("LD A, (nn)\n");
                     temp16 = read_nn();
 
                     mRegs.a = mSys.MemRead8(temp16);
                     break;
                 case 0b00001010: // LD A, (BC)
-                    LPRINTF("LD A, (BC)\n");
+                    TPRINTF("LD A, (BC)\n");
                     mRegs.a = mSys.MemRead8(READ_BC());
                     break;
                 case 0b00011010: // LD A, (DE)
-                    LPRINTF("LD A, (DE)\n");
+                    TPRINTF("LD A, (DE)\n");
                     mRegs.a = mSys.MemRead8(READ_DE());
                     break;
                 case 0b11000101:
                 case 0b11010101:
                 case 0b11100101:
                 case 0b11110101: // PUSH qq
-                    LPRINTF("PUSH qq\n");
+                    TPRINTF("PUSH qq\n");
                     push16(read_qq_reg(BITS_SHIFT(op, 5, 4)));
                     break;
 
@@ -651,20 +733,20 @@ int CpuZ80::Run() {
                 case 0b11010001:
                 case 0b11100001:
                 case 0b11110001: // POP qq
-                    LPRINTF("POP qq\n");
+                    TPRINTF("POP qq\n");
                     temp16 = pop16();
                     write_qq_reg(BITS_SHIFT(op, 5, 4), temp16);
                     break;
 
                 case 0b11100011: // EX (SP), HL
-                    LPRINTF("EX (SP), HL\n");
+                    TPRINTF("EX (SP), HL\n");
                     temp16 = pop16();
                     push16(READ_HL());
                     WRITE_HL(temp16);
                     break;
 
                 case 0b00001000: // EX AF, AF'
-                    LPRINTF("EX AF, AF'\n");
+                    TPRINTF("EX AF, AF'\n");
 
                     temp16 = READ_AF();
                     WRITE_AF(READ_AF_ALT());
@@ -675,7 +757,7 @@ int CpuZ80::Run() {
                 case 0b00011001:
                 case 0b00101001:
                 case 0b00111001: { // ADD HL, ss
-                    LPRINTF("ADD HL, ss\n");
+                    TPRINTF("ADD HL, ss\n");
                     dd = BITS_SHIFT(op, 5, 4);
                     temp16 = read_dd_reg(dd);
                     uint16_t hl = READ_HL();
@@ -691,7 +773,7 @@ int CpuZ80::Run() {
                 case 0b00011011:
                 case 0b00101011:
                 case 0b00111011: // DEC ss
-                    LPRINTF("DEC ss\n");
+                    TPRINTF("DEC ss\n");
                     dd = BITS_SHIFT(op, 5, 4);
                     write_dd_reg(dd, read_dd_reg(dd) - 1);
                     break;
@@ -699,7 +781,7 @@ int CpuZ80::Run() {
                 case 0b00010011:
                 case 0b00100011:
                 case 0b00110011: // INC ss
-                    LPRINTF("INC ss\n");
+                    TPRINTF("INC ss\n");
                     dd = BITS_SHIFT(op, 5, 4);
                     write_dd_reg(dd, read_dd_reg(dd) + 1);
                     break;
@@ -711,7 +793,7 @@ int CpuZ80::Run() {
                 case 0b00100100:
                 case 0b00101100:
                 case 0b00111100: { // INC r
-                    LPRINTF("INC r\n");
+                    TPRINTF("INC r\n");
                     int r = BITS_SHIFT(op, 5, 3);
                     uint8_t old;
 
@@ -741,7 +823,7 @@ int CpuZ80::Run() {
                 case 0b00100101:
                 case 0b00101101:
                 case 0b00111101: { // DEC r
-                    LPRINTF("DEC r\n");
+                    TPRINTF("DEC r\n");
                     int r = BITS_SHIFT(op, 5, 3);
                     uint8_t old;
 
@@ -765,46 +847,46 @@ int CpuZ80::Run() {
                 }
 
                 case 0b10100000 ... 0b10100111: // AND r, AND (HL)
-                    LPRINTF("AND r\n");
+                    TPRINTF("AND r\n");
                     mRegs.a &= read_r_reg_or_hl(BITS(op, 2, 0));
                     set_flags(mRegs.a);
                     set_flag(FLAG_H, 1);
                     break;
 
                 case 0b11100110: // AND n
-                    LPRINTF("AND n\n");
+                    TPRINTF("AND n\n");
                     mRegs.a &= mSys.MemRead8(read_n());
                     set_flags(mRegs.a);
                     set_flag(FLAG_H, 1);
                     break;
 
                 case 0b10110000 ... 0b10110111: // OR r, OR (HL)
-                    LPRINTF("OR r\n");
+                    TPRINTF("OR r\n");
                     mRegs.a |= read_r_reg_or_hl(BITS(op, 2, 0));
                     set_flags(mRegs.a);
                     break;
 
                 case 0b10101000 ... 0b10101111: // XOR r, XOR (HL)
-                    LPRINTF("XOR r\n");
+                    TPRINTF("XOR r\n");
                     mRegs.a ^= read_r_reg_or_hl(BITS(op, 2, 0));
                     set_flags(mRegs.a);
                     break;
 
                 case 0b10111000 ... 0b10111111: // CP r, CP (HL)
-                    LPRINTF("CP r\n");
+                    TPRINTF("CP r\n");
                     temp8 = mRegs.a - read_r_reg_or_hl(BITS(op, 2, 0));
                     set_flags(temp8);
                     break;
 
                 case 0b11111110: // CP n
-                    LPRINTF("CP n\n");
+                    TPRINTF("CP n\n");
                     temp8 = mSys.MemRead8(read_n());
                     temp8 = mRegs.a - temp8;
                     set_flags(temp8);
                     break;
 
                 case 0b00000111: // RLCA
-                    LPRINTF("RLCA\n");
+                    TPRINTF("RLCA\n");
                     temp8 = (mRegs.a << 1) | ((mRegs.a >> 7) & 0x1);
                     set_flag(FLAG_C, mRegs.a & 0x80);
                     set_flag(FLAG_H, 0);
@@ -813,7 +895,7 @@ int CpuZ80::Run() {
                     break;
 
                 case 0b00001111: // RRCA
-                    LPRINTF("RRCA\n");
+                    TPRINTF("RRCA\n");
                     temp8 = (mRegs.a >> 1) | ((mRegs.a << 7) & 0x80);
                     set_flag(FLAG_C, mRegs.a & 0x1);
                     set_flag(FLAG_H, 0);
@@ -822,7 +904,7 @@ int CpuZ80::Run() {
                     break;
 
                 case 0b00011111: // RRA
-                    LPRINTF("RRA\n");
+                    TPRINTF("RRA\n");
                     temp8 = (mRegs.a >> 1);
                     temp8 |= get_flag(FLAG_C) ? (1 << 7) : 0;
                     set_flag(FLAG_C, mRegs.a & 0x1);
@@ -832,14 +914,14 @@ int CpuZ80::Run() {
                     break;
 
                 case 0b00111111: // CCF
-                    LPRINTF("CCF\n");
+                    TPRINTF("CCF\n");
                     set_flag(FLAG_H, get_flag(FLAG_C));
                     set_flag(FLAG_C, !(mRegs.f & FLAG_C));
                     set_flag(FLAG_N, 0);
                     break;
 
                 case 0b00110111: // SCF
-                    LPRINTF("SCF\n");
+                    TPRINTF("SCF\n");
                     set_flag(FLAG_C, 1);
                     set_flag(FLAG_H, 0);
                     set_flag(FLAG_N, 0);
@@ -847,22 +929,85 @@ int CpuZ80::Run() {
 
                 default:
                     fprintf(stderr, "unhandled opcode 0x%hhx\n", op);
+                    EMU_PROBE3(unhandled_opcode, rec.pc, op, mInstructionCount);
+                    DumpFlightRecorder("unhandled opcode");
                     return -1;
             }
         }
 
-        if (LOCAL_TRACE)
+        if (Instrumented && trace)
             Dump();
+
+        // see if we've been asked to stop or switch run loops
+        if (mSys.BreakRequested() || mInstructionCount >= mNextEvent)
+            return 1;
     }
 
     return 0;
 }
 
+int CpuZ80::Run() {
+    HostProfileRun prof;
+    BeginSlice();
+
+    for (;;) {
+        int err = NeedsInstrumentation() ? RunLoop<true>() : RunLoop<false>();
+        if (err <= 0)
+            return EndSlice(err);
+
+        mSys.ClearBreak();
+        if (HandleBreak())
+            return EndSlice(0);
+    }
+}
+
 void CpuZ80::Dump() {
-    printf("a 0x%02hhx f 0x%02hhx b 0x%02hhx c 0x%02hhx d 0x%02hhx e 0x%02hhx h 0x%02hhx l 0x%02hhx ",
-           mRegs.a, mRegs.f, mRegs.b, mRegs.c, mRegs.d, mRegs.e, mRegs.h, mRegs.l);
-    printf("sp 0x%04hx ix 0x%04hx iy 0x%04hx, pc 0x%04hx\n",
-           mRegs.sp, mRegs.ix, mRegs.iy, mRegs.pc);
+    TraceLog::Printf("a 0x%02hhx f 0x%02hhx b 0x%02hhx c 0x%02hhx d 0x%02hhx e 0x%02hhx h 0x%02hhx l 0x%02hhx ",
+                     mRegs.a, mRegs.f, mRegs.b, mRegs.c, mRegs.d, mRegs.e, mRegs.h, mRegs.l);
+    TraceLog::Printf("sp 0x%04hx ix 0x%04hx iy 0x%04hx, pc 0x%04hx\n",
+                     mRegs.sp, mRegs.ix, mRegs.iy, mRegs.pc);
+}
+
+// the register file is a plain struct, save it as is
+void CpuZ80::SaveRegs(SnapshotWriter &w) const {
+    w.AddSection("cpu", &mRegs, sizeof(mRegs));
+}
+
+int CpuZ80::LoadRegs(SnapshotReader &r) {
+    return r.Read("cpu", &mRegs, sizeof(mRegs));
+}
+
+void CpuZ80::FormatFlightRegs(const FlightRecord &r, char *buf, size_t buflen) {
+    FormatRegs(r.regs, buf, buflen);
+}
+
+void CpuZ80::FormatRegs(const uint16_t *regs, char *buf, size_t buflen) {
+    snprintf(buf, buflen, "af 0x%04hx bc 0x%04hx de 0x%04hx hl 0x%04hx sp 0x%04hx ix 0x%04hx iy 0x%04hx",
+             regs[0], regs[1], regs[2], regs[3], regs[4], regs[5], regs[6]);
+}
+
+size_t CpuZ80::DisassembleAt(uint32_t pc, char *buf, size_t buflen) {
+    uint8_t bytes[kMaxInstructionBytes];
+    for (size_t i = 0; i < sizeof(bytes); i++)
+        bytes[i] = mSys.MemPeek8((pc + i) & 0xffff);
+
+    return Disassemble(pc, bytes, buf, buflen);
+}
+
+size_t CpuZ80::Disassemble(uint32_t /* pc */, const uint8_t *bytes, char *buf, size_t buflen) {
+    // the decoder is a switch with no table behind it, so only the opcode
+    // bytes are shown, including the prefix if there is one
+    switch (bytes[0]) {
+        case 0xcb:
+        case 0xdd:
+        case 0xed:
+        case 0xfd:
+            snprintf(buf, buflen, "%02x %02x", bytes[0], bytes[1]);
+            return 2;
+        default:
+            snprintf(buf, buflen, "%02x", bytes[0]);
+            return 1;
+    }
 }
 
 void CpuZ80::Reset() {
@@ -34,9 +34,36 @@ public:
     virtual void Reset() override;
     virtual int Run() override;
 
+    virtual const char *GetName() const override { return "z80"; }
+    virtual uint32_t GetPC() const override { return mRegs.pc; }
+
     virtual void Dump() override;
+    virtual size_t DisassembleAt(uint32_t pc, char *buf, size_t buflen) override;
+
+    static const size_t kMaxInstructionBytes = 4;
+
+    // opcode bytes only, returns the number of bytes consumed
+    static size_t Disassemble(uint32_t pc, const uint8_t *bytes, char *buf, size_t buflen);
+
+    // format a register snapshot as taken for the flight recorder
+    static void FormatRegs(const uint16_t *regs, char *buf, size_t buflen);
+
+protected:
+    virtual void SaveRegs(SnapshotWriter &w) const override;
+    virtual int LoadRegs(SnapshotReader &r) override;
+
+    virtual void FormatFlightRegs(const FlightRecord &r, char *buf, size_t buflen) override;
 
 private:
+    template <bool Instrumented>
+    int RunLoop();
+
+    const FlightRecord &RecordFlight(uint16_t pc, uint8_t opcode);
+
+    // which way a conditional branch at pc went, for coverage. Returns taken.
+    template <bool Instrumented>
+    bool branch(uint16_t pc, bool taken);
+
     // internal routines
     uint16_t read_qq_reg(int dd);
     void write_qq_reg(int dd, uint16_t val);
@@ -0,0 +1,114 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "callgraph.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+
+#include "symbols.h"
+
+using namespace std;
+
+// deeper than this is almost certainly code that calls without ever returning
+static const size_t kMaxDepth = 256;
+
+// how far up the stack a return may unwind to find its caller
+static const size_t kMaxUnwind = 16;
+
+CallGraph::CallGraph() {
+    mNodes.emplace_back(new Node { nullptr, 0, 0, {} });
+    mCurrent = mNodes.back().get();
+}
+
+CallGraph::~CallGraph() {
+}
+
+void CallGraph::Call(uint32_t target, uint32_t retaddr) {
+    if (mStack.size() >= kMaxDepth) {
+        mMismatches++;
+        return;
+    }
+
+    Node *&child = mCurrent->children[target];
+    if (!child) {
+        mNodes.emplace_back(new Node { mCurrent, target, 0, {} });
+        child = mNodes.back().get();
+    }
+
+    mStack.push_back(Frame { child, retaddr });
+    mCurrent = child;
+}
+
+void CallGraph::Return(uint32_t address) {
+    // the common case, returning to the last caller
+    if (!mStack.empty() && mStack.back().retaddr == address) {
+        mStack.pop_back();
+        mCurrent = mCurrent->parent;
+        return;
+    }
+
+    // code that fiddles with the stack or uses a return as a computed jump
+    // doesn't match up. Unwind if a caller further up expects this address,
+    // otherwise treat it as a jump and stay where we are.
+    mMismatches++;
+
+    size_t limit = (mStack.size() > kMaxUnwind) ? mStack.size() - kMaxUnwind : 0;
+    for (size_t i = mStack.size(); i > limit; i--) {
+        if (mStack[i - 1].retaddr == address) {
+            mCurrent = mStack[i - 1].node->parent;
+            mStack.resize(i - 1);
+            return;
+        }
+    }
+}
+
+int CallGraph::WriteFolded(const string &file, const SymbolTable &syms) const {
+    FILE *fp = fopen(file.c_str(), "w");
+    if (!fp) {
+        cerr << "error opening call graph output " << file << endl;
+        return -errno;
+    }
+
+    for (auto &n : mNodes) {
+        if (n->count == 0)
+            continue;
+
+        // build the path from the root down
+        vector<const Node *> path;
+        for (const Node *p = n.get(); p->parent; p = p->parent)
+            path.push_back(p);
+
+        string stack = "[root]";
+        for (auto i = path.rbegin(); i != path.rend(); i++)
+            stack += ";" + syms.Describe((*i)->target);
+
+        fprintf(fp, "%s %llu\n", stack.c_str(), (unsigned long long)n->count);
+    }
+
+    fclose(fp);
+
+    return 0;
+}
+
@@ -0,0 +1,79 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class SymbolTable;
+
+// tracks the guest call stack from the cpu's call and return instructions and
+// attributes every instruction to the stack it ran under. Written out as folded
+// stacks ("a;b;c count") for flamegraph tools.
+class CallGraph {
+public:
+    CallGraph();
+    ~CallGraph();
+
+    // non copyable
+    CallGraph(const CallGraph &) = delete;
+    CallGraph &operator=(const CallGraph &) = delete;
+
+    // called by the cpu once per instruction
+    void Tick() { mCurrent->count++; }
+
+    // a subroutine call to target that is expected to come back to retaddr
+    void Call(uint32_t target, uint32_t retaddr);
+
+    // a return instruction that landed at address
+    void Return(uint32_t address);
+
+    uint64_t GetMismatches() const { return mMismatches; }
+
+    int WriteFolded(const std::string &file, const SymbolTable &syms) const;
+
+private:
+    // one node per unique call path
+    struct Node {
+        Node *parent;
+        uint32_t target;
+        uint64_t count;
+        std::unordered_map<uint32_t, Node *> children;
+    };
+
+    // live frames, matched against return addresses
+    struct Frame {
+        Node *node;
+        uint32_t retaddr;
+    };
+
+    std::vector<std::unique_ptr<Node>> mNodes;
+    std::vector<Frame> mStack;
+    Node *mCurrent;
+    uint64_t mMismatches = 0;
+};
+
@@ -0,0 +1,228 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "coverage.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "symbols.h"
+
+using namespace std;
+
+namespace {
+
+// the label, if any, then the mnemonic. Lines that are only a directive
+// (.byte, .word, .blkb...) still carry bytes but never execute.
+bool IsInstruction(const string &text) {
+    size_t pos = 0;
+    size_t colon = text.find(':');
+    if (colon != string::npos && text.find_first_of(" \t;") > colon)
+        pos = colon + 1;
+
+    pos = text.find_first_not_of(" \t", pos);
+    if (pos == string::npos)
+        return false;
+
+    return text[pos] != '.' && text[pos] != ';';
+}
+
+// what a line gets marked with, and what it adds up to in the summary
+struct LineCoverage {
+    bool code = false;
+    bool executed = false;
+    bool branch = false;
+    bool taken = false;
+    bool notTaken = false;
+};
+
+LineCoverage Classify(const Coverage &cov, uint32_t address, int bytes, const string &text) {
+    LineCoverage c;
+    if (bytes == 0 || !IsInstruction(text))
+        return c;
+
+    c.code = true;
+    c.executed = cov.Executed(address);
+    c.taken = cov.Taken(address);
+    c.notTaken = cov.NotTaken(address);
+    c.branch = c.taken || c.notTaken;
+    return c;
+}
+
+struct Counts {
+    uint64_t lines = 0;
+    uint64_t executed = 0;
+    uint64_t branches = 0;
+    uint64_t both = 0;
+    uint64_t takenOnly = 0;
+    uint64_t notTakenOnly = 0;
+
+    void Add(const LineCoverage &c) {
+        if (!c.code)
+            return;
+        lines++;
+        if (c.executed)
+            executed++;
+        if (c.branch) {
+            branches++;
+            if (c.taken && c.notTaken)
+                both++;
+            else if (c.taken)
+                takenOnly++;
+            else
+                notTakenOnly++;
+        }
+    }
+};
+
+// calls fn(file, address, bytes, text, raw line) for every line of every listing
+template <typename F>
+int ForEachListingLine(const SymbolTable &syms, F fn) {
+    for (auto &file : syms.GetListings()) {
+        FILE *fp = fopen(file.c_str(), "r");
+        if (!fp) {
+            cerr << "error opening listing file " << file << endl;
+            return -errno;
+        }
+
+        char buf[1024];
+        while (fgets(buf, sizeof(buf), fp)) {
+            string line(buf);
+            while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+                line.pop_back();
+
+            uint32_t address = 0;
+            int bytes = 0;
+            int lineno;
+            string text;
+            if (!SymbolTable::ParseListingLine(line, address, bytes, lineno, text))
+                bytes = 0;
+
+            fn(file, address, bytes, text, line);
+        }
+
+        fclose(fp);
+    }
+
+    return 0;
+}
+
+}
+
+Coverage::Coverage() {
+}
+
+Coverage::~Coverage() {
+}
+
+size_t Coverage::GetExecuted() const {
+    size_t count = 0;
+    for (size_t i = 0; i < kWords; i++)
+        count += __builtin_popcountll(mExecuted[i]);
+    return count;
+}
+
+// each line gets a five character column in front of it:
+//   '+' ran, '-' never ran, blank for lines that aren't instructions
+//   then for conditional branches 'T' and/or 'N' for taken and not taken
+int Coverage::WriteListing(const string &file, const SymbolTable &syms) const {
+    FILE *fp = fopen(file.c_str(), "w");
+    if (!fp) {
+        cerr << "error opening coverage output " << file << endl;
+        return -errno;
+    }
+
+    fprintf(fp, "# %zu addresses executed. + ran, - never ran, T branch taken, N branch not taken\n",
+            GetExecuted());
+    if (syms.GetListings().empty())
+        fprintf(fp, "# no .rst or .lst listing loaded, nothing to annotate\n");
+
+    string current;
+    int err = ForEachListingLine(syms, [&](const string &name, uint32_t address, int bytes,
+                                           const string &text, const string &line) {
+        if (name != current) {
+            fprintf(fp, "\n# %s\n", name.c_str());
+            current = name;
+        }
+
+        LineCoverage c = Classify(*this, address, bytes, text);
+        fprintf(fp, "%c %c%c  %s\n",
+                c.code ? (c.executed ? '+' : '-') : ' ',
+                c.taken ? 'T' : ' ',
+                c.notTaken ? 'N' : ' ',
+                line.c_str());
+    });
+
+    fclose(fp);
+
+    return err;
+}
+
+int Coverage::WriteSummary(const string &file, const string &name, const SymbolTable &syms) const {
+    FILE *fp = fopen(file.c_str(), "w");
+    if (!fp) {
+        cerr << "error opening coverage summary output " << file << endl;
+        return -errno;
+    }
+
+    // roll the listing lines up by the symbol they fall under
+    Counts total;
+    map<string, Counts> symbols;
+    int err = ForEachListingLine(syms, [&](const string &, uint32_t address, int bytes,
+                                           const string &text, const string &) {
+        LineCoverage c = Classify(*this, address, bytes, text);
+        if (!c.code)
+            return;
+
+        const string *sym = syms.LookupSymbol(address);
+        symbols[sym ? *sym : "[unknown]"].Add(c);
+        total.Add(c);
+    });
+
+    auto pct = [](const Counts &c) {
+        return c.lines ? (100.0 * c.executed / c.lines) : 0.0;
+    };
+
+    fprintf(fp, "# %zu addresses executed\n", GetExecuted());
+    fprintf(fp, "# branches only counts conditional branches that ran at least once\n");
+    fprintf(fp, "# name lines executed pct branches both taken-only not-taken-only\n");
+
+    auto row = [&](const string &n, const Counts &c) {
+        fprintf(fp, "%s %llu %llu %.2f %llu %llu %llu %llu\n", n.c_str(),
+                (unsigned long long)c.lines, (unsigned long long)c.executed, pct(c),
+                (unsigned long long)c.branches, (unsigned long long)c.both,
+                (unsigned long long)c.takenOnly, (unsigned long long)c.notTakenOnly);
+    };
+
+    row(name, total);
+    for (auto &s : symbols)
+        row(s.first, s.second);
+
+    fclose(fp);
+
+    return err;
+}
@@ -0,0 +1,80 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class SymbolTable;
+
+// which guest instructions have executed, and which way each conditional
+// branch has gone, one bit per address of the 64K address space
+class Coverage {
+public:
+    Coverage();
+    ~Coverage();
+
+    // non copyable
+    Coverage(const Coverage &) = delete;
+    Coverage &operator=(const Coverage &) = delete;
+
+    // called by the cpu once per instruction with the address it is about to execute
+    void Execute(uint32_t pc) {
+        pc &= kAddressSpace - 1;
+        mExecuted[pc / 64] |= 1ULL << (pc % 64);
+    }
+
+    // called by the cpu for conditional branches, with the address of the branch instruction
+    void Branch(uint32_t pc, bool taken) {
+        pc &= kAddressSpace - 1;
+        (taken ? mTaken : mNotTaken)[pc / 64] |= 1ULL << (pc % 64);
+    }
+
+    bool Executed(uint32_t a) const { return Test(mExecuted, a); }
+    bool Taken(uint32_t a) const { return Test(mTaken, a); }
+    bool NotTaken(uint32_t a) const { return Test(mNotTaken, a); }
+
+    // number of distinct addresses executed
+    size_t GetExecuted() const;
+
+    // the .rst/.lst files the symbol table loaded, each line marked with
+    // whether it ran and which ways its branch went
+    int WriteListing(const std::string &file, const SymbolTable &syms) const;
+
+    // per symbol line and branch counts, name is what goes on the total line
+    int WriteSummary(const std::string &file, const std::string &name, const SymbolTable &syms) const;
+
+private:
+    static const size_t kAddressSpace = 64*1024;
+    static const size_t kWords = kAddressSpace / 64;
+
+    static bool Test(const uint64_t *bits, uint32_t a) {
+        a &= kAddressSpace - 1;
+        return (bits[a / 64] >> (a % 64)) & 1;
+    }
+
+    uint64_t mExecuted[kWords] = {};
+    uint64_t mTaken[kWords] = {};
+    uint64_t mNotTaken[kWords] = {};
+};
@@ -0,0 +1,58 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// one instruction, as the cpu saw it just before executing it
+struct FlightRecord {
+    uint32_t count;     // low bits of the instruction count
+    uint16_t pc;
+    uint8_t  opcode;    // first opcode byte, the rest are read back when dumping
+    uint8_t  pad;
+    uint16_t regs[8];   // cpu specific register snapshot
+};
+
+// fixed size ring of the most recently executed instructions. Cheap enough
+// that every cpu keeps one running all the time, so there is some history to
+// look at when something goes wrong.
+class FlightRecorder {
+public:
+    static const size_t kEntries = 1024; // power of 2
+
+    FlightRecord &Next() { return mRing[mHead++ & (kEntries - 1)]; }
+
+    size_t Size() const { return (mHead < kEntries) ? mHead : kEntries; }
+
+    // 0 is the oldest record still in the ring
+    const FlightRecord &Get(size_t i) const {
+        return mRing[(mHead - Size() + i) & (kEntries - 1)];
+    }
+
+private:
+    FlightRecord mRing[kEntries] = {};
+    uint64_t mHead = 0;
+};
+
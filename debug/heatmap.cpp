@@ -0,0 +1,156 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "heatmap.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+Heatmap::Heatmap() {
+}
+
+Heatmap::~Heatmap() {
+}
+
+void Heatmap::AddDevice(const MemoryDevice *dev, const char *name, bool mmio) {
+    if (!dev)
+        return;
+
+    Device d;
+    d.dev = dev;
+    d.name = name;
+    d.mmio = mmio;
+    mDevices.push_back(d);
+
+    // pointers into the vector just moved
+    mLastDev = nullptr;
+    mLastCounts = &mUnmapped;
+}
+
+Heatmap::Counts &Heatmap::FindSlow(const MemoryDevice *dev) {
+    Counts *c = dev ? &mUnknown : &mUnmapped;
+    for (auto &d : mDevices) {
+        if (d.dev == dev) {
+            c = &d.counts;
+            break;
+        }
+    }
+
+    mLastDev = dev;
+    mLastCounts = c;
+    return *c;
+}
+
+void Heatmap::Report(FILE *fp) const {
+    Counts total;
+    for (auto &p : mPages) {
+        total.reads += p.reads;
+        total.writes += p.writes;
+        total.fetches += p.fetches;
+    }
+    uint64_t all = total.Total() + mPorts.Total();
+
+    fprintf(fp, "memory heatmap: %llu reads, %llu writes, %llu fetches, %llu port accesses\n",
+            (unsigned long long)total.reads, (unsigned long long)total.writes,
+            (unsigned long long)total.fetches, (unsigned long long)mPorts.Total());
+
+    auto pct = [all](uint64_t n) {
+        return all ? (100.0 * n / all) : 0.0;
+    };
+
+    // by device, the mmio lines are the accesses that go the slow way
+    fprintf(fp, "%-12s %-6s %14s %14s %14s %7s\n", "device", "kind", "reads", "writes", "fetches", "pct");
+    auto line = [&](const string &name, const char *kind, const Counts &c) {
+        if (!c.Total())
+            return;
+        fprintf(fp, "%-12s %-6s %14llu %14llu %14llu %6.2f%%\n", name.c_str(), kind,
+                (unsigned long long)c.reads, (unsigned long long)c.writes,
+                (unsigned long long)c.fetches, pct(c.Total()));
+    };
+    uint64_t mmio = mPorts.Total();
+    for (auto &d : mDevices) {
+        line(d.name, d.mmio ? "mmio" : "memory", d.counts);
+        if (d.mmio)
+            mmio += d.counts.Total();
+    }
+    line("io ports", "port", mPorts);
+    line("unmapped", "-", mUnmapped);
+    line("unnamed", "-", mUnknown);
+    fprintf(fp, "%.2f%% of bus traffic to mmio and ports\n", pct(mmio));
+
+    // one character per page, log scaled against the busiest page
+    static const char kShades[] = " .:-=+*#%@";
+    const int kLevels = sizeof(kShades) - 2;
+
+    uint64_t busiest = 0;
+    for (auto &p : mPages)
+        busiest = max(busiest, p.Total());
+
+    fprintf(fp, "\npage map, 4K per row, 256 bytes per column, '@' is the busiest page\n");
+    fprintf(fp, "       0123456789abcdef\n");
+    for (size_t row = 0; row < kPages / 16; row++) {
+        char shades[17];
+        for (size_t col = 0; col < 16; col++) {
+            uint64_t n = mPages[row * 16 + col].Total();
+            int level = 0;
+            if (n && busiest)
+                level = 1 + (int)((kLevels - 1) * log((double)n) / max(log((double)busiest), 1.0));
+            shades[col] = kShades[min(level, kLevels)];
+        }
+        shades[16] = 0;
+        fprintf(fp, "0x%04zx |%s|\n", row << (kPageShift + 4), shades);
+    }
+
+    // and the pages themselves, busiest first
+    vector<pair<uint64_t, size_t>> pages;
+    for (size_t i = 0; i < kPages; i++) {
+        if (mPages[i].Total())
+            pages.push_back(make_pair(mPages[i].Total(), i));
+    }
+    sort(pages.rbegin(), pages.rend());
+
+    fprintf(fp, "\n%-6s %14s %14s %14s %7s\n", "page", "reads", "writes", "fetches", "pct");
+    for (auto &p : pages) {
+        const Counts &c = mPages[p.second];
+        fprintf(fp, "0x%04zx %14llu %14llu %14llu %6.2f%%\n", p.second << kPageShift,
+                (unsigned long long)c.reads, (unsigned long long)c.writes,
+                (unsigned long long)c.fetches, pct(c.Total()));
+    }
+}
+
+int Heatmap::WriteReport(const string &file) const {
+    FILE *fp = fopen(file.c_str(), "w");
+    if (!fp) {
+        cerr << "error opening heatmap output " << file << endl;
+        return -errno;
+    }
+
+    Report(fp);
+    fclose(fp);
+
+    return 0;
+}
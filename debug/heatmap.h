@@ -0,0 +1,122 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+class MemoryDevice;
+
+// guest bus traffic, reads, writes and instruction fetches counted per 256
+// byte page of the address space and per memory device behind it
+class Heatmap {
+public:
+    Heatmap();
+    ~Heatmap();
+
+    // non copyable
+    Heatmap(const Heatmap &) = delete;
+    Heatmap &operator=(const Heatmap &) = delete;
+
+    // give a device its own line in the report. mmio is for devices with
+    // registers behind them rather than plain memory.
+    void AddDevice(const MemoryDevice *dev, const char *name, bool mmio);
+
+    // called by the cpu just before it reads an opcode, so that read counts as a fetch
+    void Fetch() { mFetch = true; }
+
+    // called by the system bus with the guest address and the device it
+    // decoded to, null if nothing is mapped there
+    void Read(size_t address, const MemoryDevice *dev) {
+        Counts &page = mPages[(address >> kPageShift) & (kPages - 1)];
+        Counts &d = Find(dev);
+        if (mFetch) {
+            page.fetches++;
+            d.fetches++;
+            mFetch = false;
+        } else {
+            page.reads++;
+            d.reads++;
+        }
+    }
+    void Write(size_t address, const MemoryDevice *dev) {
+        mPages[(address >> kPageShift) & (kPages - 1)].writes++;
+        Find(dev).writes++;
+    }
+
+    // io space, for cpus that have one. Ports aren't broken down any further.
+    void PortRead() { mPorts.reads++; }
+    void PortWrite() { mPorts.writes++; }
+
+    // per device totals, a page map and the busy pages
+    void Report(FILE *fp) const;
+    int WriteReport(const std::string &file) const;
+
+    // have the cpu print a report at its next break, signal safe
+    void RequestReport() { mReportRequested = true; }
+    bool TakeReportRequest() { return mReportRequested.exchange(false); }
+
+private:
+    static const size_t kPageShift = 8;
+    static const size_t kPages = 64*1024 >> kPageShift;
+
+    struct Counts {
+        uint64_t reads = 0;
+        uint64_t writes = 0;
+        uint64_t fetches = 0;
+
+        uint64_t Total() const { return reads + writes + fetches; }
+    };
+
+    struct Device {
+        const MemoryDevice *dev;
+        std::string name;
+        bool mmio;
+        Counts counts;
+    };
+
+    // the last device looked up is nearly always the next one too
+    Counts &Find(const MemoryDevice *dev) {
+        if (dev == mLastDev)
+            return *mLastCounts;
+        return FindSlow(dev);
+    }
+    Counts &FindSlow(const MemoryDevice *dev);
+
+    Counts mPages[kPages];
+    Counts mPorts;
+    Counts mUnmapped;
+    Counts mUnknown;
+    std::vector<Device> mDevices;
+
+    const MemoryDevice *mLastDev = nullptr;
+    Counts *mLastCounts = &mUnmapped;
+
+    bool mFetch = false;
+    std::atomic<bool> mReportRequested { false };
+};
@@ -0,0 +1,211 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "hostprofile.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+atomic<bool> HostProfile::sEnabled { false };
+atomic<bool> HostProfile::sReportRequested { false };
+uint32_t HostProfile::sInterval = 64;
+
+namespace {
+
+// every thread that has ever counted anything, kept around after the thread
+// is gone so its time still shows up in the report
+mutex sThreadsLock;
+vector<unique_ptr<HostProfile::Thread>> sThreads;
+
+thread_local HostProfile::Thread *tThread;
+
+// to turn ticks into seconds, taken when counting starts
+uint64_t sStartTicks;
+// cost of reading the counter, which is about what a bus access costs
+uint64_t sReadOverhead;
+chrono::steady_clock::time_point sStartTime;
+
+const char *const kLayerNames[HostProfile::LAYER_COUNT] = {
+    "decode/dispatch",
+    "memory bus",
+    "devices",
+    "console",
+    "sleep",
+};
+
+void Add(atomic<uint64_t> &counter, uint64_t val) {
+    counter.store(counter.load(memory_order_relaxed) + val, memory_order_relaxed);
+}
+
+}
+
+void HostProfile::Enable(uint32_t interval) {
+    sInterval = interval ? interval : 1;
+
+    sReadOverhead = ~0ULL;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t t = ReadTicks();
+        sReadOverhead = min(sReadOverhead, ReadTicks() - t);
+    }
+
+    sStartTicks = ReadTicks();
+    sStartTime = chrono::steady_clock::now();
+    sEnabled = true;
+}
+
+HostProfile::Thread *HostProfile::GetThread() {
+    if (tThread)
+        return tThread;
+
+    unique_ptr<Thread> t(new Thread());
+    for (auto &c : t->ticks)
+        c = 0;
+    t->runTicks = 0;
+    t->runStart = 0;
+    t->slices = 0;
+    t->countdown = sInterval;
+    t->depth = 0;
+    t->sampling = false;
+    t->child = 0;
+
+    tThread = t.get();
+
+    lock_guard<mutex> lock(sThreadsLock);
+    sThreads.push_back(move(t));
+    return tThread;
+}
+
+void HostProfile::Report(FILE *fp) {
+    if (!IsEnabled())
+        return;
+
+    uint64_t now = ReadTicks();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - sStartTime).count();
+    double ticksPerSec = secs > 0 ? (now - sStartTicks) / secs : 1;
+
+    lock_guard<mutex> lock(sThreadsLock);
+
+    uint64_t total[LAYER_COUNT] = {};
+    uint64_t totalRun = 0;
+    uint64_t totalSlices = 0;
+    size_t cpuThreads = 0;
+
+    auto print = [&](const char *title, const uint64_t *ticks, uint64_t run, uint64_t slices) {
+        fprintf(fp, "%s: %.3f seconds running in %llu slices, %.1f us per slice\n", title,
+                run / ticksPerSec, (unsigned long long)slices,
+                slices ? run / ticksPerSec / slices * 1e6 : 0.0);
+        for (int l = 0; l < LAYER_COUNT; l++) {
+            fprintf(fp, "\t%-16s %6.2f%% %10.3f seconds\n", kLayerNames[l],
+                    run ? ticks[l] * 100.0 / run : 0.0, ticks[l] / ticksPerSec);
+        }
+    };
+
+    for (size_t i = 0; i < sThreads.size(); i++) {
+        Thread &t = *sThreads[i];
+
+        // a slice still going counts up to now
+        uint64_t run = t.runTicks;
+        uint64_t start = t.runStart;
+        if (start)
+            run += now - start;
+        if (!run)
+            continue;
+
+        uint64_t ticks[LAYER_COUNT];
+        uint64_t layered = 0;
+        for (int l = 1; l < LAYER_COUNT; l++) {
+            ticks[l] = t.ticks[l];
+            layered += ticks[l];
+        }
+        ticks[DISPATCH] = run > layered ? run - layered : 0;
+
+        char title[64];
+        snprintf(title, sizeof(title), "host profile, thread %zu", i);
+        print(title, ticks, run, t.slices);
+
+        for (int l = 0; l < LAYER_COUNT; l++)
+            total[l] += ticks[l];
+        totalRun += run;
+        totalSlices += t.slices;
+        cpuThreads++;
+    }
+
+    if (cpuThreads > 1)
+        print("host profile, all threads", total, totalRun, totalSlices);
+    fprintf(fp, "host profile: one in %u layer boundaries timed\n", sInterval);
+}
+
+HostProfile::Thread *HostProfile::BeginScope(Layer layer) {
+    Thread *t = GetThread();
+
+    // only time spent running a cpu is broken down
+    if (!t->runStart.load(memory_order_relaxed))
+        return nullptr;
+
+    // the outermost scope decides for everything nested in it
+    int depth = t->depth++;
+    if (depth == 0) {
+        t->sampling = --t->countdown == 0;
+        if (t->sampling)
+            t->countdown = sInterval;
+    }
+
+    if (t->sampling && depth < Thread::kMaxDepth) {
+        Thread::Frame &f = t->frames[depth];
+        f.layer = layer;
+        f.savedChild = t->child;
+        t->child = 0;
+        f.start = ReadTicks();
+    }
+
+    return t;
+}
+
+void HostProfile::EndScope(Thread *t) {
+    int depth = --t->depth;
+
+    if (t->sampling && depth < Thread::kMaxDepth) {
+        Thread::Frame &f = t->frames[depth];
+        uint64_t elapsed = ReadTicks() - f.start;
+        elapsed = elapsed > sReadOverhead ? elapsed - sReadOverhead : 0;
+        uint64_t self = elapsed > t->child ? elapsed - t->child : 0;
+        Add(t->ticks[f.layer], self * sInterval);
+        t->child = f.savedChild + elapsed;
+    }
+}
+
+void HostProfileRun::Begin() {
+    mThread = HostProfile::GetThread();
+    mStart = HostProfile::ReadTicks();
+    mThread->runStart.store(mStart, memory_order_relaxed);
+}
+
+void HostProfileRun::End() {
+    Add(mThread->runTicks, HostProfile::ReadTicks() - mStart);
+    Add(mThread->slices, 1);
+    mThread->runStart.store(0, memory_order_relaxed);
+}
@@ -0,0 +1,150 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Breakdown of host time by emulator layer, on the threads running a cpu.
+//
+// The boundaries between layers are marked with HostProfileScope. One in N
+// of the outermost scopes on a thread is timed with the cycle counter, along
+// with everything nested inside it, and scaled back up by N. Nested scopes
+// take their time out of the enclosing one. Whatever time inside the cpu's
+// Run() isn't in any scope is charged to instruction decode and dispatch.
+class HostProfile {
+public:
+    enum Layer {
+        DISPATCH,   // the run loop itself, what's left over
+        BUS,        // system memory map dispatch and the memory devices
+        DEVICE,     // uarts and other device handlers
+        CONSOLE,    // console locking and io
+        SLEEP,      // waiting on the host, for input and the like
+        LAYER_COUNT
+    };
+
+    // start counting, timing one in interval top level scopes
+    static void Enable(uint32_t interval = 64);
+    static bool IsEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+    // totals per thread that has run a cpu, and over all of them. Not async
+    // signal safe, from a handler use RequestReport() instead.
+    static void Report(FILE *fp);
+
+    // have the next cpu to look print the report, from a signal handler
+    static void RequestReport() { sReportRequested = true; }
+    static bool TakeReportRequest() { return sReportRequested.exchange(false); }
+
+    static uint64_t ReadTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t v;
+        __asm__ volatile("mrs %0, cntvct_el0" : "=r"(v));
+        return v;
+#else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    // counters for one thread, written only by it
+    struct Thread {
+        std::atomic<uint64_t> ticks[LAYER_COUNT];
+        std::atomic<uint64_t> runTicks;
+        std::atomic<uint64_t> runStart;     // 0 when not inside Run()
+        std::atomic<uint64_t> slices;
+
+        // the scopes open on the thread, past kMaxDepth they just count depth
+        static const int kMaxDepth = 8;
+        struct Frame {
+            Layer layer;
+            uint64_t start;
+            uint64_t savedChild;
+        } frames[kMaxDepth];
+        int depth;
+        uint32_t countdown;
+        bool sampling;
+        uint64_t child;                     // time of scopes nested in the current one
+    };
+    static Thread *GetThread();
+
+    // layer boundaries, BeginScope returns null if the thread isn't running a cpu
+    static Thread *BeginScope(Layer layer);
+    static void EndScope(Thread *t);
+
+private:
+    static std::atomic<bool> sEnabled;
+    static std::atomic<bool> sReportRequested;
+    static uint32_t sInterval;
+};
+
+// marks code belonging to a layer, for as long as it's in scope
+class HostProfileScope {
+public:
+    // all of the state lives in the thread, so when profiling is off this
+    // is a load and a branch on either end
+    explicit HostProfileScope(HostProfile::Layer layer)
+        : mThread(HostProfile::IsEnabled() ? HostProfile::BeginScope(layer) : nullptr) {}
+    ~HostProfileScope() {
+        if (mThread)
+            HostProfile::EndScope(mThread);
+    }
+
+    // non copyable
+    HostProfileScope(const HostProfileScope &) = delete;
+    HostProfileScope &operator=(const HostProfileScope &) = delete;
+
+private:
+    HostProfile::Thread *mThread;
+};
+
+// one slice of a cpu's Run(), the total that the layers are a breakdown of
+class HostProfileRun {
+public:
+    HostProfileRun() {
+        if (HostProfile::IsEnabled())
+            Begin();
+    }
+    ~HostProfileRun() {
+        if (mThread)
+            End();
+    }
+
+    // non copyable
+    HostProfileRun(const HostProfileRun &) = delete;
+    HostProfileRun &operator=(const HostProfileRun &) = delete;
+
+private:
+    void Begin();
+    void End();
+
+    HostProfile::Thread *mThread = nullptr;
+    uint64_t mStart = 0;
+};
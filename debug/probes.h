@@ -0,0 +1,64 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+// Static tracepoints for attaching bpftrace, perf or systemtap to a running
+// emulator, under the provider name emu:
+//
+//   bpftrace -e 'usdt:./build-emu/emu:emu:mmio_read { @[str(arg0)] = count(); }'
+//
+// With <sys/sdt.h> around each probe is a single nop plus a note in the
+// binary. The arguments are still evaluated every time, attached or not, the
+// note only records where the tracer can find them, so keep them to values
+// already at hand. Without it they compile away entirely.
+//
+// probe                    arguments
+// slice_begin              instruction count
+// slice_end                instruction count, Run() result
+// unhandled_opcode         pc, opcode, instruction count
+// mmio_read, mmio_write    device name, address, value (z80 io ports too)
+// console_enqueue          bytes of host input queued
+// console_dequeue          byte handed to the guest
+// console_output           byte written by the guest
+// system_init              system, rom file name
+// system_shutdown          system
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define EMU_HAVE_SDT 1
+#endif
+#endif
+
+#if EMU_HAVE_SDT
+#define EMU_PROBE(name) DTRACE_PROBE(emu, name)
+#define EMU_PROBE1(name, a) DTRACE_PROBE1(emu, name, a)
+#define EMU_PROBE2(name, a, b) DTRACE_PROBE2(emu, name, a, b)
+#define EMU_PROBE3(name, a, b, c) DTRACE_PROBE3(emu, name, a, b, c)
+#else
+#define EMU_PROBE(name) do { } while (0)
+#define EMU_PROBE1(name, a) do { } while (0)
+#define EMU_PROBE2(name, a, b) do { } while (0)
+#define EMU_PROBE3(name, a, b, c) do { } while (0)
+#endif
@@ -0,0 +1,106 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "profiler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "symbols.h"
+
+using namespace std;
+
+Profiler::Profiler(uint32_t interval)
+    :   mInterval(interval ? interval : 1),
+        mHits(new uint64_t[kAddressSpace]) {
+    mCountdown = mInterval;
+    memset(mHits.get(), 0, kAddressSpace * sizeof(uint64_t));
+}
+
+Profiler::~Profiler() {
+}
+
+int Profiler::WriteReport(const string &file, const SymbolTable &syms) const {
+    FILE *fp = fopen(file.c_str(), "w");
+    if (!fp) {
+        cerr << "error opening profile output " << file << endl;
+        return -errno;
+    }
+
+    fprintf(fp, "# %llu samples, one every %u instructions\n",
+            (unsigned long long)mSamples, mInterval);
+
+    auto pct = [this](uint64_t hits) {
+        return mSamples ? (100.0 * hits / mSamples) : 0.0;
+    };
+
+    // roll the samples up by the symbol they fall under
+    map<string, uint64_t> functions;
+    vector<pair<uint64_t, uint32_t>> addrs;
+    for (uint32_t a = 0; a < kAddressSpace; a++) {
+        if (!mHits[a])
+            continue;
+
+        const string *sym = syms.LookupSymbol(a);
+        functions[sym ? *sym : "[unknown]"] += mHits[a];
+        addrs.push_back(make_pair(mHits[a], a));
+    }
+
+    vector<pair<uint64_t, string>> sorted;
+    for (auto &f : functions)
+        sorted.push_back(make_pair(f.second, f.first));
+    sort(sorted.rbegin(), sorted.rend());
+
+    fprintf(fp, "\n# functions\n");
+    fprintf(fp, "%12s %7s  %s\n", "samples", "pct", "symbol");
+    for (auto &f : sorted)
+        fprintf(fp, "%12llu %6.2f%%  %s\n", (unsigned long long)f.first, pct(f.first), f.second.c_str());
+
+    sort(addrs.rbegin(), addrs.rend());
+
+    fprintf(fp, "\n# lines\n");
+    fprintf(fp, "%12s %7s  %-6s %-24s %s\n", "samples", "pct", "addr", "location", "source");
+    for (auto &a : addrs) {
+        const SymbolTable::Line *line = syms.LookupLine(a.second);
+
+        string where = syms.Describe(a.second);
+        string text;
+        if (line) {
+            where = line->file + ":" + to_string(line->line);
+            text = line->text;
+        }
+
+        fprintf(fp, "%12llu %6.2f%%  0x%04x %-24s %s\n", (unsigned long long)a.first, pct(a.first),
+                a.second, where.c_str(), text.c_str());
+    }
+
+    fclose(fp);
+
+    return 0;
+}
+
@@ -0,0 +1,64 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class SymbolTable;
+
+// sampling profiler, records the guest PC once every N retired instructions
+class Profiler {
+public:
+    explicit Profiler(uint32_t interval);
+    ~Profiler();
+
+    // non copyable
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+    // called by the cpu once per instruction with the address it is about to execute
+    void Tick(uint32_t pc) {
+        if (--mCountdown == 0) {
+            mCountdown = mInterval;
+            mHits[pc & (kAddressSpace - 1)]++;
+            mSamples++;
+        }
+    }
+
+    uint64_t GetSamples() const { return mSamples; }
+
+    // per function and per line report, resolved against the symbol table
+    int WriteReport(const std::string &file, const SymbolTable &syms) const;
+
+private:
+    static const size_t kAddressSpace = 64*1024;
+
+    uint32_t mInterval;
+    uint32_t mCountdown;
+    uint64_t mSamples = 0;
+    std::unique_ptr<uint64_t[]> mHits;
+};
+
@@ -0,0 +1,300 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "rewind.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "console.h"
+#include "cpu/cpu.h"
+#include "debug/timeline.h"
+#include "dev/memory.h"
+#include "system/snapshot.h"
+#include "system/system.h"
+
+using namespace std;
+
+Rewind::Rewind(System &sys, Console &con, uint64_t deltaInterval, size_t budget)
+    :   mSys(sys),
+        mCon(con),
+        mDeltaInterval(max<uint64_t>(deltaInterval, 1)),
+        mKeyframeInterval(mDeltaInterval * kDeltasPerKeyframe),
+        mBudget(budget) {
+}
+
+Rewind::~Rewind() {
+    if (mReplaying)
+        mCon.SetMuted(false);
+}
+
+uint64_t Rewind::NextCapture() const {
+    return mReplaying ? min(mNextCapture, mReplayTarget) : mNextCapture;
+}
+
+void Rewind::RequestSeek(uint64_t count) {
+    {
+        lock_guard<mutex> lck(mLock);
+        mSeekPending = true;
+        mSeekRelative = false;
+        mSeekValue = count;
+    }
+    mSys.RequestBreak();
+}
+
+void Rewind::RequestStepBack(uint64_t instructions) {
+    {
+        lock_guard<mutex> lck(mLock);
+        mSeekPending = true;
+        mSeekRelative = true;
+        mSeekValue = instructions;
+    }
+    mSys.RequestBreak();
+}
+
+void Rewind::Service() {
+    uint64_t now = mSys.GetCpu()->GetInstructionCount();
+
+    if (mReplaying && now >= mReplayTarget) {
+        mReplaying = false;
+        mCon.SetMuted(false);
+        printf("rewind: at instruction %llu\n", (unsigned long long)now);
+    }
+
+    bool seek;
+    uint64_t target;
+    {
+        lock_guard<mutex> lck(mLock);
+        mNow = now;
+        seek = mSeekPending;
+        target = mSeekRelative ? now - min(now, mSeekValue) : mSeekValue;
+        mSeekPending = false;
+    }
+
+    if (seek) {
+        Seek(target, now);
+        now = mSys.GetCpu()->GetInstructionCount();
+    }
+
+    if (now >= mNextCapture)
+        Capture(now);
+}
+
+void Rewind::ClearDirty() {
+    for (auto *m : mBanks)
+        m->ClearDirty();
+}
+
+void Rewind::Capture(uint64_t now) {
+    TimelineScope span("rewind capture", "snapshot");
+
+    bool keyframe;
+    {
+        lock_guard<mutex> lck(mLock);
+        keyframe = mFrames.empty() || now - mFrames.back().count >= mKeyframeInterval;
+    }
+
+    SnapshotWriter w(mSys.GetCpu()->GetName(), keyframe);
+    mSys.SaveSnapshot(w);
+
+    if (mBanks.empty()) {
+        for (auto &b : w.GetBanks()) {
+            mBankNames.push_back(b.name);
+            mBanks.push_back(b.mem);
+        }
+    }
+
+    if (keyframe) {
+        Keyframe k;
+        k.count = now;
+        w.Write(k.image);
+
+        lock_guard<mutex> lck(mLock);
+        mBytes += Size(k);
+        mFrames.push_back(move(k));
+        Trim();
+    } else {
+        Delta d;
+        d.count = now;
+        w.Write(d.state);
+
+        // walk the dirty bitmaps a word at a time, most of them are zero
+        for (uint32_t b = 0; b < mBanks.size(); b++) {
+            const Memory *m = mBanks[b];
+            const uint8_t *mem = (const uint8_t *)m->GetPtr();
+            const uint64_t *dirty = m->GetDirty();
+            size_t pages = m->GetPageCount();
+
+            for (size_t word = 0; word < (pages + 63) / 64; word++) {
+                for (uint64_t bits = dirty[word]; bits; bits &= bits - 1) {
+                    uint32_t page = word * 64 + __builtin_ctzll(bits);
+                    size_t offset = (size_t)page << Memory::kPageShift;
+                    size_t len = m->GetSize() - offset;
+                    if (len > Memory::kPageSize)
+                        len = Memory::kPageSize;
+
+                    d.pages.push_back({ b, page });
+                    d.data.insert(d.data.end(), mem + offset, mem + offset + len);
+                    d.data.resize(d.pages.size() << Memory::kPageShift);
+                }
+            }
+        }
+
+        lock_guard<mutex> lck(mLock);
+        mBytes += Size(d);
+        mFrames.back().deltas.push_back(move(d));
+        Trim();
+    }
+
+    ClearDirty();
+    mNextCapture = now + mDeltaInterval;
+}
+
+void Rewind::Seek(uint64_t target, uint64_t now) {
+    TimelineScope span("rewind seek", "snapshot");
+
+    unique_lock<mutex> lck(mLock);
+
+    if (mFrames.empty() || target < mFrames.front().count || target > now) {
+        printf("rewind: instruction %llu is outside the window %llu-%llu\n", (unsigned long long)target,
+               mFrames.empty() ? 0ULL : (unsigned long long)mFrames.front().count, (unsigned long long)now);
+        return;
+    }
+
+    // last keyframe at or before the target, then its deltas up to the target
+    size_t f = mFrames.size() - 1;
+    while (mFrames[f].count > target)
+        f--;
+    Keyframe &k = mFrames[f];
+
+    vector<uint8_t> image = k.image;
+    vector<SnapshotSection *> banks;
+    for (auto &name : mBankNames)
+        banks.push_back(FindSnapshotSection(image, name));
+
+    uint64_t restored = k.count;
+    size_t used = 0;
+    for (; used < k.deltas.size() && k.deltas[used].count <= target; used++) {
+        const Delta &d = k.deltas[used];
+
+        for (size_t i = 0; i < d.pages.size(); i++) {
+            const SnapshotSection *s = banks[d.pages[i].bank];
+            size_t offset = (size_t)d.pages[i].page << Memory::kPageShift;
+            size_t len = s->length - offset;
+            if (len > Memory::kPageSize)
+                len = Memory::kPageSize;
+            memcpy(image.data() + s->offset + offset, d.data.data() + (i << Memory::kPageShift), len);
+        }
+
+        if (PatchSnapshot(image, d.state) < 0) {
+            printf("rewind: delta at %llu doesn't match its keyframe\n", (unsigned long long)d.count);
+            return;
+        }
+        restored = d.count;
+    }
+
+    SnapshotReader r;
+    int err = r.Open(image.data(), image.size());
+    if (err >= 0)
+        err = mSys.LoadSnapshot(r);
+    if (err < 0) {
+        // partially restored state is no better than any other, carry on from here
+        printf("rewind: error %d restoring instruction %llu\n", err, (unsigned long long)restored);
+    }
+
+    // everything after the restore point is about to be rewritten
+    while (k.deltas.size() > used) {
+        mBytes -= Size(k.deltas.back());
+        k.deltas.pop_back();
+    }
+    while (mFrames.size() > f + 1) {
+        mBytes -= Size(mFrames.back());
+        mFrames.pop_back();
+    }
+    lck.unlock();
+
+    ClearDirty();
+    mNextCapture = restored + mDeltaInterval;
+
+    if (target > restored) {
+        mReplayTarget = target;
+        mReplaying = true;
+        mCon.SetMuted(true);
+    } else {
+        mReplaying = false;
+        mCon.SetMuted(false);
+        printf("rewind: at instruction %llu\n", (unsigned long long)restored);
+    }
+}
+
+size_t Rewind::Size(const Delta &d) {
+    return d.state.size() + d.data.size() + d.pages.size() * sizeof(PageRef);
+}
+
+size_t Rewind::Size(const Keyframe &k) {
+    size_t bytes = k.image.size();
+    for (auto &d : k.deltas)
+        bytes += Size(d);
+    return bytes;
+}
+
+// drop the oldest keyframes to get back under budget, always keeping the newest
+void Rewind::Trim() {
+    while (mBytes > mBudget && mFrames.size() > 1) {
+        mBytes -= Size(mFrames.front());
+        mFrames.pop_front();
+    }
+}
+
+void Rewind::PrintStatus() {
+    lock_guard<mutex> lck(mLock);
+
+    size_t deltas = 0;
+    for (auto &k : mFrames)
+        deltas += k.deltas.size();
+
+    printf("rewind: window %llu-%llu, %zu keyframes, %zu deltas, %zu KB\n",
+           mFrames.empty() ? 0ULL : (unsigned long long)mFrames.front().count, (unsigned long long)mNow,
+           mFrames.size(), deltas, mBytes / 1024);
+}
+
+bool Rewind::Command(const string &line) {
+    if (line.compare(0, 6, "rewind") != 0 || (line.size() > 6 && line[6] != ' '))
+        return false;
+
+    const char *arg = line.c_str() + 6;
+    while (*arg == ' ')
+        arg++;
+
+    if (*arg == 0) {
+        PrintStatus();
+    } else if (*arg == '-') {
+        RequestStepBack(strtoull(arg + 1, nullptr, 0));
+    } else {
+        RequestSeek(strtoull(arg, nullptr, 0));
+    }
+
+    return true;
+}
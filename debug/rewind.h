@@ -0,0 +1,125 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Console;
+class Memory;
+class System;
+
+// Rewind buffer, for stepping the machine back to an earlier instruction count.
+//
+// Every keyframe interval the whole machine is saved to memory with the
+// snapshot code. Every delta interval in between only the cpu and device state
+// are saved, plus the 256 byte pages of memory written since the previous
+// capture, going by the dirty bits Memory keeps on its write path. Restoring a
+// capture starts from its keyframe and lays the deltas up to it on top, any
+// count between captures is reached by re-running from the one before with
+// the console muted. Time is the instruction count, there is no cycle model.
+// The oldest keyframes are dropped to keep the whole thing inside a memory
+// budget, so how far back it reaches depends on how much the guest writes.
+class Rewind {
+public:
+    static const uint64_t kDefaultDeltaInterval = 100000;
+    static const uint64_t kDeltasPerKeyframe = 100;
+    static const size_t kDefaultBudget = 8*1024*1024;
+
+    Rewind(System &sys, Console &con, uint64_t deltaInterval = kDefaultDeltaInterval,
+           size_t budget = kDefaultBudget);
+    ~Rewind();
+
+    // non copyable
+    Rewind(const Rewind &) = delete;
+    Rewind &operator=(const Rewind &) = delete;
+
+    // cpu thread, between instructions. The cpu drops out of its run loop at
+    // NextCapture() and calls Service(), which also carries out seeks.
+    uint64_t NextCapture() const;
+    void Service();
+
+    // any thread, go back to an absolute instruction count or one relative
+    // to the current count, at the next instruction boundary
+    void RequestSeek(uint64_t count);
+    void RequestStepBack(uint64_t instructions);
+
+    // print the window that can be returned to and what it costs
+    void PrintStatus();
+
+    // console command: "rewind" for status, "rewind <count>", "rewind -<instructions>".
+    // returns false if the line isn't a rewind command.
+    bool Command(const std::string &line);
+
+private:
+    struct PageRef {
+        uint32_t bank;
+        uint32_t page;
+    };
+
+    struct Delta {
+        uint64_t count;
+        std::vector<uint8_t> state;     // snapshot without memory banks
+        std::vector<PageRef> pages;
+        std::vector<uint8_t> data;      // Memory::kPageSize bytes per page
+    };
+
+    struct Keyframe {
+        uint64_t count;
+        std::vector<uint8_t> image;     // complete snapshot
+        std::deque<Delta> deltas;
+    };
+
+    void Capture(uint64_t now);
+    void Seek(uint64_t target, uint64_t now);
+    void ClearDirty();
+    void Trim();
+    static size_t Size(const Keyframe &k);
+    static size_t Size(const Delta &d);
+
+    System &mSys;
+    Console &mCon;
+    uint64_t mDeltaInterval;
+    uint64_t mKeyframeInterval;
+    size_t mBudget;
+
+    // cpu thread only
+    uint64_t mNextCapture = 0;
+    uint64_t mReplayTarget = 0;
+    bool mReplaying = false;
+    std::vector<std::string> mBankNames;
+    std::vector<Memory *> mBanks;
+
+    // shared with the thread asking for seeks and status
+    mutable std::mutex mLock;
+    std::deque<Keyframe> mFrames;
+    size_t mBytes = 0;
+    bool mSeekPending = false;
+    bool mSeekRelative = false;
+    uint64_t mSeekValue = 0;
+    uint64_t mNow = 0;
+};
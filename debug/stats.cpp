@@ -0,0 +1,262 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "stats.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+atomic<bool> Stats::sReportRequested { false };
+
+// std::min takes it by reference
+const uint32_t StatsBlock::kMaxSlots;
+
+namespace {
+
+// on the heap until published, never freed, cpu threads may still be counting at exit
+StatsBlock *sBlock;
+bool sPublished;
+string sShmName;
+
+// handing out slots, the counters themselves don't need it
+mutex sSlotLock;
+
+StatsBlock *Block() {
+    if (!sBlock) {
+        sBlock = static_cast<StatsBlock *>(calloc(1, sizeof(StatsBlock)));
+        sBlock->magic = StatsBlock::kMagic;
+        sBlock->version = StatsBlock::kVersion;
+        sBlock->pid = getpid();
+        sBlock->startNs = Stats::WallNs();
+    }
+    return sBlock;
+}
+
+void CopyName(char *dest, size_t len, const string &src) {
+    strncpy(dest, src.c_str(), len - 1);
+    dest[len - 1] = 0;
+}
+
+}
+
+uint64_t Stats::NowNs() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t Stats::WallNs() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+string Stats::ShmName(pid_t pid) {
+    return "/emu-stats." + to_string(pid);
+}
+
+int Stats::Publish() {
+    lock_guard<mutex> lock(sSlotLock);
+
+    if (sPublished)
+        return 0;
+    if (sBlock && sBlock->slotCount > 0) {
+        fprintf(stderr, "stats: publishing after systems have started\n");
+        return -EBUSY;
+    }
+
+    sShmName = ShmName(getpid());
+    int fd = shm_open(sShmName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "stats: error creating shared memory %s: %s\n", sShmName.c_str(), strerror(errno));
+        return -errno;
+    }
+
+    int err = 0;
+    void *ptr = MAP_FAILED;
+    if (ftruncate(fd, sizeof(StatsBlock)) < 0) {
+        err = -errno;
+    } else {
+        ptr = mmap(NULL, sizeof(StatsBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (ptr == MAP_FAILED)
+            err = -errno;
+    }
+    close(fd);
+
+    if (err < 0) {
+        fprintf(stderr, "stats: error mapping shared memory %s: %s\n", sShmName.c_str(), strerror(-err));
+        shm_unlink(sShmName.c_str());
+        return err;
+    }
+
+    // fresh from ftruncate it's all zeros, fill in the header last so readers
+    // don't see the magic before the rest
+    StatsBlock *b = static_cast<StatsBlock *>(ptr);
+    b->version = StatsBlock::kVersion;
+    b->pid = getpid();
+    b->startNs = sBlock ? sBlock->startNs : WallNs();
+    atomic_thread_fence(memory_order_release);
+    b->magic = StatsBlock::kMagic;
+
+    free(sBlock);
+    sBlock = b;
+    sPublished = true;
+
+    return 0;
+}
+
+// the mapping stays, just the name goes away
+void Stats::Unpublish() {
+    lock_guard<mutex> lock(sSlotLock);
+
+    if (!sPublished)
+        return;
+    shm_unlink(sShmName.c_str());
+    sPublished = false;
+}
+
+StatsSlot *Stats::AddSlot(const string &name, const string &system) {
+    lock_guard<mutex> lock(sSlotLock);
+
+    StatsBlock *b = Block();
+
+    StatsSlot *slot = nullptr;
+    if (b->slotCount < StatsBlock::kMaxSlots) {
+        slot = &b->slots[b->slotCount];
+    } else {
+        for (auto &s : b->slots) {
+            if (s.state == StatsSlot::DONE) {
+                slot = &s;
+                break;
+            }
+        }
+        if (!slot)
+            return nullptr;
+    }
+
+    // nobody else writes a slot that isn't running, clear it out for the new system
+    slot->state = StatsSlot::FREE;
+    CopyName(slot->name, sizeof(slot->name), name);
+    CopyName(slot->system, sizeof(slot->system), system);
+    slot->instructions = 0;
+    slot->ips = 0;
+    slot->slices = 0;
+    slot->consoleIn = 0;
+    slot->consoleOut = 0;
+    slot->sleepNs = 0;
+    slot->deviceCount = 0;
+    slot->windowNs = NowNs();
+    slot->windowInstructions = 0;
+    slot->state = StatsSlot::RUNNING;
+
+    if (slot == &b->slots[b->slotCount])
+        b->slotCount++;
+
+    return slot;
+}
+
+void Stats::ReleaseSlot(StatsSlot *slot) {
+    if (!slot)
+        return;
+
+    slot->ips = 0;
+    slot->state = StatsSlot::DONE;
+}
+
+StatsDevice *Stats::AddDevice(StatsSlot *slot, const char *name) {
+    if (!slot || slot->deviceCount >= StatsSlot::kMaxDevices)
+        return nullptr;
+
+    StatsDevice *d = &slot->devices[slot->deviceCount];
+    CopyName(d->name, sizeof(d->name), name);
+    d->reads = 0;
+    d->writes = 0;
+    slot->deviceCount++;
+
+    return d;
+}
+
+void Stats::UpdateInstructions(StatsSlot *slot, uint64_t count) {
+    slot->instructions.store(count, memory_order_relaxed);
+
+    uint64_t now = NowNs();
+    uint64_t elapsed = now - slot->windowNs;
+    if (elapsed < 1000000000ULL)
+        return;
+
+    // a snapshot load can move the count backwards
+    uint64_t ran = count > slot->windowInstructions ? count - slot->windowInstructions : 0;
+    slot->ips.store(ran * 1000000000ULL / elapsed, memory_order_relaxed);
+    slot->windowNs = now;
+    slot->windowInstructions = count;
+}
+
+void Stats::Report(FILE *fp) {
+    Report(*Block(), fp);
+}
+
+void Stats::Report(const StatsBlock &b, FILE *fp) {
+    double up = (WallNs() - b.startNs) / 1e9;
+    fprintf(fp, "emu stats, pid %llu, up %.1f seconds\n", (unsigned long long)b.pid, up);
+    fprintf(fp, "%-16s %-10s %-7s %14s %9s %8s %8s %8s %9s\n", "name", "system", "state",
+            "instructions", "MIPS", "slices", "con in", "con out", "sleep ms");
+
+    uint32_t count = min<uint32_t>(b.slotCount.load(), StatsBlock::kMaxSlots);
+    uint64_t totalInstructions = 0;
+    uint64_t totalIps = 0;
+    uint32_t running = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const StatsSlot &s = b.slots[i];
+        uint32_t state = s.state;
+        if (state == StatsSlot::FREE)
+            continue;
+
+        uint64_t instructions = s.instructions;
+        uint64_t ips = s.ips;
+        fprintf(fp, "%-16.32s %-10.16s %-7s %14llu %9.2f %8llu %8llu %8llu %9.1f\n", s.name, s.system,
+                state == StatsSlot::RUNNING ? "running" : "done",
+                (unsigned long long)instructions, ips / 1e6,
+                (unsigned long long)s.slices.load(), (unsigned long long)s.consoleIn.load(),
+                (unsigned long long)s.consoleOut.load(), s.sleepNs / 1e6);
+
+        uint32_t devices = min<uint32_t>(s.deviceCount.load(), StatsSlot::kMaxDevices);
+        for (uint32_t d = 0; d < devices; d++) {
+            fprintf(fp, "\t%-14.16s %12llu reads %12llu writes\n", s.devices[d].name,
+                    (unsigned long long)s.devices[d].reads.load(), (unsigned long long)s.devices[d].writes.load());
+        }
+
+        totalInstructions += instructions;
+        if (state == StatsSlot::RUNNING) {
+            totalIps += ips;
+            running++;
+        }
+    }
+
+    if (running > 1) {
+        fprintf(fp, "%-16s %-10s %-7u %14llu %9.2f\n", "total", "", running,
+                (unsigned long long)totalInstructions, totalIps / 1e6);
+    }
+}
@@ -0,0 +1,120 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <sys/types.h>
+
+// Live counters for every system in the process, one slot each, so a run can
+// be watched while it goes. The block normally lives on the heap, Publish()
+// moves it to /dev/shm where emu-stat can map it from another process.
+//
+// Each slot is written by whatever thread is running its system at the time,
+// only ever one at once, so the counters are plain loads and stores on
+// atomics and readers see a consistent enough view without any locking.
+
+// one memory mapped or io device of a system
+struct StatsDevice {
+    char name[16];
+    std::atomic<uint64_t> reads;
+    std::atomic<uint64_t> writes;
+};
+
+struct StatsSlot {
+    enum State : uint32_t {
+        FREE,
+        RUNNING,
+        DONE,
+    };
+    std::atomic<uint32_t> state;
+    char name[32];
+    char system[16];
+
+    std::atomic<uint64_t> instructions;
+    std::atomic<uint64_t> ips;              // instructions per second, over the last second or so
+    std::atomic<uint64_t> slices;           // times the cpu's Run() has returned
+    std::atomic<uint64_t> consoleIn;
+    std::atomic<uint64_t> consoleOut;
+    std::atomic<uint64_t> sleepNs;          // waiting on the host for input
+
+    static const int kMaxDevices = 4;
+    std::atomic<uint32_t> deviceCount;
+    StatsDevice devices[kMaxDevices];
+
+    // where the current rate window started, for the writer only
+    uint64_t windowNs;
+    uint64_t windowInstructions;
+};
+
+struct StatsBlock {
+    static const uint32_t kMagic = 0x54534d45; // "EMST"
+    static const uint32_t kVersion = 1;
+    static const uint32_t kMaxSlots = 64;
+
+    uint32_t magic;
+    uint32_t version;
+    uint64_t pid;
+    uint64_t startNs;                       // wall clock, for the uptime
+    std::atomic<uint32_t> slotCount;        // slots ever used, the rest are untouched
+    StatsSlot slots[kMaxSlots];
+};
+
+// bump a counter that only the calling thread writes
+inline void StatsAdd(std::atomic<uint64_t> &c, uint64_t val) {
+    c.store(c.load(std::memory_order_relaxed) + val, std::memory_order_relaxed);
+}
+
+class Stats {
+public:
+    // move the block to shared memory, before any slots are handed out
+    static int Publish();
+    static void Unpublish();
+    static std::string ShmName(pid_t pid);
+
+    // a slot for a system being started, null if they're all busy. Slots of
+    // systems that are done get reused once the block is full.
+    static StatsSlot *AddSlot(const std::string &name, const std::string &system);
+    static void ReleaseSlot(StatsSlot *slot);
+    static StatsDevice *AddDevice(StatsSlot *slot, const char *name);
+
+    // the cpu's instruction count, and the rate once a second has gone by
+    static void UpdateInstructions(StatsSlot *slot, uint64_t count);
+
+    static uint64_t NowNs();
+    static uint64_t WallNs();
+
+    // summary of every slot in use, of this process or one mapped from another
+    static void Report(FILE *fp);
+    static void Report(const StatsBlock &b, FILE *fp);
+
+    // have the next cpu to look print the summary, from a signal handler
+    static void RequestReport() { sReportRequested = true; }
+    static bool TakeReportRequest() { return sReportRequested.exchange(false); }
+
+private:
+    static std::atomic<bool> sReportRequested;
+};
@@ -0,0 +1,324 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "symbols.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "trace.h"
+
+#define LOCAL_TRACE 0
+
+using namespace std;
+
+static bool IsHex(const string &s) {
+    if (s.empty())
+        return false;
+    for (char c : s) {
+        if (!isxdigit((unsigned char)c))
+            return false;
+    }
+    return true;
+}
+
+static bool IsIdentifier(const string &s) {
+    if (s.empty())
+        return false;
+    if (!isalpha((unsigned char)s[0]) && s[0] != '_' && s[0] != '.' && s[0] != '$')
+        return false;
+    for (char c : s) {
+        if (!isalnum((unsigned char)c) && c != '_' && c != '.' && c != '$')
+            return false;
+    }
+    return true;
+}
+
+// parse a value column, stripping any area prefix aslink puts in front ("C:0000")
+static bool ParseValue(string s, uint32_t &val) {
+    size_t colon = s.find(':');
+    if (colon != string::npos)
+        s = s.substr(colon + 1);
+    if (s.size() < 4 || s.size() > 8 || !IsHex(s))
+        return false;
+    val = strtoul(s.c_str(), NULL, 16);
+    return true;
+}
+
+static vector<string> Split(const string &s) {
+    vector<string> tokens;
+    istringstream is(s);
+    string t;
+    while (is >> t)
+        tokens.push_back(t);
+    return tokens;
+}
+
+static string Extension(const string &file) {
+    size_t dot = file.rfind('.');
+    size_t slash = file.rfind('/');
+    if (dot == string::npos || (slash != string::npos && dot < slash))
+        return "";
+    string ext = file.substr(dot + 1);
+    for (auto &c : ext)
+        c = tolower(c);
+    return ext;
+}
+
+static string BaseName(const string &file) {
+    size_t slash = file.rfind('/');
+    return (slash == string::npos) ? file : file.substr(slash + 1);
+}
+
+SymbolTable::SymbolTable() {
+}
+
+SymbolTable::~SymbolTable() {
+}
+
+int SymbolTable::Load(const string &file) {
+    string ext = Extension(file);
+
+    if (ext == "map") {
+        return LoadSymbolFile(file, true);
+    } else if (ext == "sym") {
+        return LoadSymbolFile(file, false);
+    } else if (ext == "rst" || ext == "lst") {
+        return LoadListing(file);
+    }
+
+    cerr << "unknown symbol file type " << file << endl;
+    return -1;
+}
+
+int SymbolTable::LoadForRom(const string &rom) {
+    string base = rom;
+    if (!Extension(rom).empty())
+        base = rom.substr(0, rom.rfind('.'));
+
+    int loaded = 0;
+    for (auto ext : { ".map", ".sym", ".rst" }) {
+        string file = base + ext;
+        FILE *fp = fopen(file.c_str(), "r");
+        if (!fp)
+            continue;
+        fclose(fp);
+
+        if (Load(file) >= 0)
+            loaded++;
+    }
+
+    return loaded;
+}
+
+void SymbolTable::AddSymbol(uint32_t address, const string &name) {
+    // assembler internal symbols are of no use in a report
+    if (name.compare(0, 3, ".__") == 0)
+        return;
+
+    // first one wins, so explicit files beat ones picked up by name
+    mSymbols.insert(make_pair(address, name));
+}
+
+// .map lists "value name" pairs, .sym lists "name value flags" in columns
+// separated by '|'. Anything else on the line is skipped.
+int SymbolTable::LoadSymbolFile(const string &file, bool valueFirst) {
+    FILE *fp = fopen(file.c_str(), "r");
+    if (!fp) {
+        cerr << "error opening symbol file " << file << endl;
+        return -errno;
+    }
+
+    int count = 0;
+    char buf[1024];
+    while (fgets(buf, sizeof(buf), fp)) {
+        string line(buf);
+
+        size_t start = 0;
+        for (;;) {
+            size_t bar = line.find('|', start);
+            auto tokens = Split(line.substr(start, (bar == string::npos) ? string::npos : bar - start));
+
+            for (size_t i = 0; i + 1 < tokens.size(); i++) {
+                string name = valueFirst ? tokens[i + 1] : tokens[i];
+                string value = valueFirst ? tokens[i] : tokens[i + 1];
+
+                // the .sym format glues '=' on to absolute symbols
+                if (!name.empty() && name.back() == '=')
+                    name.pop_back();
+
+                uint32_t val;
+                if (IsIdentifier(name) && ParseValue(value, val)) {
+                    LTRACEF("symbol '%s' at 0x%x\n", name.c_str(), val);
+                    AddSymbol(val, name);
+                    count++;
+                    break;
+                }
+            }
+
+            if (bar == string::npos)
+                break;
+            start = bar + 1;
+        }
+    }
+
+    fclose(fp);
+
+    return count;
+}
+
+// listing lines look like
+//   "   C000 8E 10 00      [ 3]   12 start:\tldx\t#0x1000"
+// address, code bytes, optional cycle count, right aligned line number, then the source
+bool SymbolTable::ParseListingLine(const string &line, uint32_t &address, int &bytes, int &lineno, string &text) {
+    // address
+    size_t pos = line.find_first_not_of(' ');
+    if (pos == string::npos)
+        return false;
+    size_t end = line.find(' ', pos);
+    if (end == string::npos)
+        return false;
+
+    if (!ParseValue(line.substr(pos, end - pos), address))
+        return false;
+    pos = end;
+
+    // code bytes are separated by single spaces, the line number column by more
+    bytes = 0;
+    while (pos + 3 <= line.size() && line[pos] == ' ' &&
+            isxdigit((unsigned char)line[pos + 1]) && isxdigit((unsigned char)line[pos + 2]) &&
+            (pos + 3 == line.size() || line[pos + 3] == ' ')) {
+        bytes++;
+        pos += 3;
+    }
+
+    // optional cycle count
+    pos = line.find_first_not_of(' ', pos);
+    if (pos != string::npos && line[pos] == '[') {
+        pos = line.find(']', pos);
+        if (pos != string::npos)
+            pos = line.find_first_not_of(' ', pos + 1);
+    }
+    if (pos == string::npos || !isdigit((unsigned char)line[pos]))
+        return false;
+
+    // line number
+    end = pos;
+    while (end < line.size() && isdigit((unsigned char)line[end]))
+        end++;
+    lineno = atoi(line.substr(pos, end - pos).c_str());
+
+    text.clear();
+    if (end < line.size())
+        text = line.substr(end + 1);
+
+    return true;
+}
+
+int SymbolTable::LoadListing(const string &file) {
+    FILE *fp = fopen(file.c_str(), "r");
+    if (!fp) {
+        cerr << "error opening listing file " << file << endl;
+        return -errno;
+    }
+
+    mListings.push_back(file);
+
+    string name = BaseName(file);
+
+    int count = 0;
+    char buf[1024];
+    while (fgets(buf, sizeof(buf), fp)) {
+        string line(buf);
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+            line.pop_back();
+
+        uint32_t address;
+        int bytes;
+        int lineno;
+        string text;
+        if (!ParseListingLine(line, address, bytes, lineno, text))
+            continue;
+
+        // pick up labels as symbols, listings are often all we have
+        size_t colon = text.find(':');
+        if (colon != string::npos && IsIdentifier(text.substr(0, colon)))
+            AddSymbol(address, text.substr(0, colon));
+
+        // lines that only carry an address (equates, labels on their own) don't own code
+        if (bytes == 0)
+            continue;
+
+        Line l;
+        l.file = name;
+        l.line = lineno;
+        l.text = text;
+        if (mLines.insert(make_pair(address, l)).second)
+            count++;
+    }
+
+    fclose(fp);
+
+    return count;
+}
+
+const string *SymbolTable::LookupSymbol(uint32_t address, uint32_t *offset) const {
+    auto i = mSymbols.upper_bound(address);
+    if (i == mSymbols.begin())
+        return NULL;
+    i--;
+
+    if (offset)
+        *offset = address - i->first;
+    return &i->second;
+}
+
+const SymbolTable::Line *SymbolTable::LookupLine(uint32_t address) const {
+    auto i = mLines.find(address);
+    if (i == mLines.end())
+        return NULL;
+    return &i->second;
+}
+
+string SymbolTable::Describe(uint32_t address) const {
+    char str[256];
+
+    uint32_t offset;
+    const string *sym = LookupSymbol(address, &offset);
+    if (!sym) {
+        snprintf(str, sizeof(str), "0x%04x", address);
+    } else if (offset == 0) {
+        snprintf(str, sizeof(str), "%s", sym->c_str());
+    } else {
+        snprintf(str, sizeof(str), "%s+0x%x", sym->c_str(), offset);
+    }
+
+    return str;
+}
+
@@ -0,0 +1,83 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// symbol and source line information for guest code, loaded from the
+// files the asxxxx assemblers and aslink leave behind (.map, .sym, .rst, .lst)
+class SymbolTable {
+public:
+    SymbolTable();
+    ~SymbolTable();
+
+    // non copyable
+    SymbolTable(const SymbolTable &) = delete;
+    SymbolTable &operator=(const SymbolTable &) = delete;
+
+    // load a single file, type is inferred from the extension
+    int Load(const std::string &file);
+
+    // load whatever .map/.sym/.rst files sit next to a rom image
+    int LoadForRom(const std::string &rom);
+
+    bool Empty() const { return mSymbols.empty() && mLines.empty(); }
+
+    struct Line {
+        std::string file;
+        int line;
+        std::string text;
+    };
+
+    // nearest symbol at or below address, NULL if there is none
+    const std::string *LookupSymbol(uint32_t address, uint32_t *offset = nullptr) const;
+
+    // listing line that generated the code at exactly this address, NULL if unknown
+    const Line *LookupLine(uint32_t address) const;
+
+    // symbol+offset or a bare hex address, for reports
+    std::string Describe(uint32_t address) const;
+
+    // .rst/.lst files that have been loaded, in order
+    const std::vector<std::string> &GetListings() const { return mListings; }
+
+    // pull apart one line of a listing, newline already stripped. False if
+    // it doesn't start with an address and carry a line number.
+    static bool ParseListingLine(const std::string &line, uint32_t &address, int &bytes,
+                                 int &lineno, std::string &text);
+
+private:
+    int LoadSymbolFile(const std::string &file, bool valueFirst);
+    int LoadListing(const std::string &file);
+
+    void AddSymbol(uint32_t address, const std::string &name);
+
+    std::map<uint32_t, std::string> mSymbols;
+    std::map<uint32_t, Line> mLines;
+    std::vector<std::string> mListings;
+};
+
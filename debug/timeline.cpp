@@ -0,0 +1,204 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "timeline.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <unistd.h>
+#include <vector>
+
+#include "cpu/cpu.h"
+
+using namespace std;
+
+atomic<bool> Timeline::sEnabled { false };
+
+namespace {
+
+// past this many events a thread just counts what it drops
+const size_t kMaxEventsPerThread = 1 << 20;
+
+const uint64_t kNoInstructions = UINT64_MAX;
+
+struct Event {
+    const char *name;
+    const char *cat;
+    const char *argName;
+    int64_t arg;
+    uint64_t start;
+    uint64_t duration;          // UINT64_MAX for an instant
+    uint64_t instructions;
+};
+
+struct ThreadEvents {
+    string name;
+    vector<Event> events;
+    uint64_t dropped = 0;
+};
+
+// every thread that has recorded anything, kept after it exits until written out
+mutex sThreadsLock;
+vector<unique_ptr<ThreadEvents>> sThreads;
+
+thread_local ThreadEvents *tEvents;
+thread_local const Cpu *tCpu;
+
+chrono::steady_clock::time_point sStart;
+
+ThreadEvents *Events() {
+    if (tEvents)
+        return tEvents;
+
+    unique_ptr<ThreadEvents> t(new ThreadEvents());
+    t->events.reserve(4096);
+
+    lock_guard<mutex> lock(sThreadsLock);
+    t->name = "thread " + to_string(sThreads.size());
+    tEvents = t.get();
+    sThreads.push_back(move(t));
+    return tEvents;
+}
+
+void Record(const Event &e) {
+    ThreadEvents *t = Events();
+    if (t->events.size() >= kMaxEventsPerThread) {
+        t->dropped++;
+        return;
+    }
+    t->events.push_back(e);
+}
+
+// names are literals from our own source, but keep the json valid regardless
+void WriteString(FILE *fp, const string &s) {
+    putc('"', fp);
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            putc('\\', fp);
+        if ((unsigned char)c >= 0x20)
+            putc(c, fp);
+    }
+    putc('"', fp);
+}
+
+}
+
+void Timeline::Enable() {
+    sStart = chrono::steady_clock::now();
+    sEnabled = true;
+}
+
+uint64_t Timeline::Now() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - sStart).count();
+}
+
+void Timeline::Instant(const char *name, const char *cat, const char *argName, int64_t arg) {
+    Record(Event { name, cat, argName, arg, Now(), UINT64_MAX, ThreadInstructions() });
+}
+
+void Timeline::Span(const char *name, const char *cat, uint64_t start, uint64_t instructions,
+                    const char *argName, int64_t arg) {
+    Record(Event { name, cat, argName, arg, start, Now() - start, instructions });
+}
+
+void Timeline::SetThreadName(const string &name) {
+    if (!IsEnabled())
+        return;
+
+    ThreadEvents *t = Events();
+    lock_guard<mutex> lock(sThreadsLock);
+    t->name = name;
+}
+
+void Timeline::SetThreadCpu(const Cpu *cpu) {
+    tCpu = cpu;
+}
+
+uint64_t Timeline::ThreadInstructions() {
+    return tCpu ? tCpu->GetInstructionCount() : kNoInstructions;
+}
+
+int Timeline::Write(const string &file) {
+    if (!IsEnabled())
+        return 0;
+
+    FILE *fp = fopen(file.c_str(), "w");
+    if (!fp) {
+        fprintf(stderr, "error opening timeline file %s\n", file.c_str());
+        return -errno;
+    }
+
+    lock_guard<mutex> lock(sThreadsLock);
+
+    int pid = getpid();
+    size_t count = 0;
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"emu\"}}", pid);
+    for (size_t tid = 0; tid < sThreads.size(); tid++) {
+        ThreadEvents &t = *sThreads[tid];
+
+        fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%zu,\"args\":{\"name\":", pid, tid);
+        WriteString(fp, t.name);
+        fprintf(fp, "}}");
+
+        for (auto &e : t.events) {
+            fprintf(fp, ",\n{\"name\":");
+            WriteString(fp, e.name);
+            fprintf(fp, ",\"cat\":");
+            WriteString(fp, e.cat);
+            if (e.duration == UINT64_MAX) {
+                fprintf(fp, ",\"ph\":\"i\",\"s\":\"t\"");
+            } else {
+                fprintf(fp, ",\"ph\":\"X\",\"dur\":%.3f", e.duration / 1000.0);
+            }
+            fprintf(fp, ",\"ts\":%.3f,\"pid\":%d,\"tid\":%zu,\"args\":{", e.start / 1000.0, pid, tid);
+
+            const char *sep = "";
+            if (e.instructions != kNoInstructions) {
+                fprintf(fp, "\"instructions\":%llu", (unsigned long long)e.instructions);
+                sep = ",";
+            }
+            if (e.argName) {
+                fprintf(fp, "%s", sep);
+                WriteString(fp, e.argName);
+                fprintf(fp, ":%lld", (long long)e.arg);
+            }
+            fprintf(fp, "}}");
+        }
+        count += t.events.size();
+
+        if (t.dropped) {
+            fprintf(stderr, "timeline: %s dropped %llu events past the first %zu\n", t.name.c_str(),
+                    (unsigned long long)t.dropped, kMaxEventsPerThread);
+        }
+    }
+    fprintf(fp, "\n]}\n");
+
+    fclose(fp);
+    printf("timeline: wrote %zu events to %s\n", count, file.c_str());
+
+    return 0;
+}
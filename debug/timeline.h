@@ -0,0 +1,95 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+class Cpu;
+
+// Timeline of what the emulator is doing, written out as Chrome trace event
+// json (chrome://tracing, ui.perfetto.dev) for looking at latency and jitter.
+//
+// Events go into a buffer per thread and are all written out at the end, so
+// recording one is a clock read and a store. Names and categories must be
+// string literals, only the pointers are kept. Events on a thread running a
+// cpu carry its instruction count.
+class Timeline {
+public:
+    static void Enable();
+    static bool IsEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+    // nanoseconds since Enable()
+    static uint64_t Now();
+
+    // something that happened, with an optional argument
+    static void Instant(const char *name, const char *cat, const char *argName = nullptr, int64_t arg = 0);
+
+    // something that went from start until now, instructions is the count at
+    // the start or UINT64_MAX if there's no cpu on the thread
+    static void Span(const char *name, const char *cat, uint64_t start, uint64_t instructions,
+                     const char *argName = nullptr, int64_t arg = 0);
+
+    // the track the calling thread's events show up on
+    static void SetThreadName(const std::string &name);
+
+    // cpu running on the calling thread, for the instruction counts, null once it stops
+    static void SetThreadCpu(const Cpu *cpu);
+    static uint64_t ThreadInstructions();
+
+    // everything recorded so far, from all threads. Only once they're done
+    // recording, at exit.
+    static int Write(const std::string &file);
+
+private:
+    static std::atomic<bool> sEnabled;
+};
+
+// a span covering the scope
+class TimelineScope {
+public:
+    TimelineScope(const char *name, const char *cat)
+        :   mName(name), mCat(cat), mEnabled(Timeline::IsEnabled()) {
+        if (mEnabled) {
+            mStart = Timeline::Now();
+            mInstructions = Timeline::ThreadInstructions();
+        }
+    }
+    ~TimelineScope() {
+        if (mEnabled)
+            Timeline::Span(mName, mCat, mStart, mInstructions);
+    }
+
+    // non copyable
+    TimelineScope(const TimelineScope &) = delete;
+    TimelineScope &operator=(const TimelineScope &) = delete;
+
+private:
+    const char *mName;
+    const char *mCat;
+    bool mEnabled;
+    uint64_t mStart = 0;
+    uint64_t mInstructions = 0;
+};
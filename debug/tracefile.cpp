@@ -0,0 +1,310 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "tracefile.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "system/system.h"
+
+using namespace std;
+
+static const char kTraceMagic[8] = { 'E', 'M', 'U', 'T', 'R', 'A', 'C', 'E' };
+static const uint32_t kTraceVersion = 1;
+
+TraceWriter::TraceWriter(System &sys)
+    :   mSys(sys),
+        mCodeSeen(64*1024 / 64) {
+}
+
+TraceWriter::~TraceWriter() {
+    Close();
+}
+
+int TraceWriter::Open(const string &file, const char *cpu) {
+    mFd = open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (mFd < 0) {
+        cerr << "error opening trace file " << file << endl;
+        return -errno;
+    }
+
+    if (ftruncate(mFd, kInitialSize) < 0) {
+        cerr << "error sizing trace file " << file << endl;
+        return -errno;
+    }
+
+    void *ptr = mmap(nullptr, kInitialSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+    if (ptr == MAP_FAILED) {
+        cerr << "error mapping trace file " << file << endl;
+        return -errno;
+    }
+    mBase = (uint8_t *)ptr;
+    mSize = kInitialSize;
+
+    TraceFileHeader *h = (TraceFileHeader *)Reserve(sizeof(TraceFileHeader));
+    memcpy(h->magic, kTraceMagic, sizeof(h->magic));
+    h->version = kTraceVersion;
+    h->headerSize = sizeof(TraceFileHeader);
+    snprintf(h->cpu, sizeof(h->cpu), "%s", cpu);
+    Commit(sizeof(TraceFileHeader));
+
+    mFlusher = thread(&TraceWriter::FlushThread, this);
+
+    return 0;
+}
+
+void TraceWriter::Close() {
+    if (mFd < 0)
+        return;
+
+    {
+        lock_guard<mutex> lock(mMapLock);
+        mStop = true;
+    }
+    mFlushCond.notify_one();
+    if (mFlusher.joinable())
+        mFlusher.join();
+
+    if (mBase)
+        munmap(mBase, mSize);
+    mBase = nullptr;
+
+    // trim the preallocated tail
+    if (ftruncate(mFd, mPos) < 0)
+        cerr << "error truncating trace file" << endl;
+    close(mFd);
+    mFd = -1;
+}
+
+// out of room, make the file bigger and map it again. Rare enough that
+// doubling and a full remap under the lock is fine.
+void TraceWriter::Grow(size_t len) {
+    lock_guard<mutex> lock(mMapLock);
+
+    size_t newSize = mSize * 2;
+    while (mPos + len > newSize)
+        newSize *= 2;
+
+    munmap(mBase, mSize);
+    mBase = nullptr;
+
+    void *ptr = MAP_FAILED;
+    if (ftruncate(mFd, newSize) == 0)
+        ptr = mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+    if (ptr == MAP_FAILED) {
+        // nothing sensible to do about losing the trace halfway through
+        cerr << "error growing trace file to " << newSize << " bytes, aborting" << endl;
+        abort();
+    }
+
+    mBase = (uint8_t *)ptr;
+    mSize = newSize;
+}
+
+void TraceWriter::Sync(uint64_t count) {
+    uint8_t *p = Reserve(9);
+    p[0] = TRACE_SYNC;
+    for (int i = 0; i < 8; i++)
+        p[1 + i] = count >> (i * 8);
+    Commit(9);
+}
+
+// first time through this pc, put the instruction bytes in the trace
+void TraceWriter::Code(uint16_t pc) {
+    mCodeSeen[pc / 64] |= 1ULL << (pc % 64);
+
+    uint8_t *p = Reserve(4 + kMaxCodeBytes);
+    p[0] = TRACE_CODE;
+    p[1] = pc;
+    p[2] = pc >> 8;
+    p[3] = kMaxCodeBytes;
+    for (size_t i = 0; i < kMaxCodeBytes; i++)
+        p[4 + i] = mSys.MemPeek8((pc + i) & 0xffff);
+    Commit(4 + kMaxCodeBytes);
+}
+
+// start writeback of whole pages behind the writer so dirty pages
+// don't pile up in the page cache
+void TraceWriter::FlushThread() {
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+
+    unique_lock<mutex> lock(mMapLock);
+    while (!mStop) {
+        mFlushCond.wait_for(lock, chrono::milliseconds(250));
+
+        size_t end = mPublished.load(memory_order_acquire) & ~(pageSize - 1);
+        if (end <= mFlushed || !mBase)
+            continue;
+
+        msync(mBase + mFlushed, end - mFlushed, MS_ASYNC);
+#if __linux__
+        sync_file_range(mFd, mFlushed, end - mFlushed, SYNC_FILE_RANGE_WRITE);
+#endif
+        mFlushed = end;
+    }
+}
+
+TraceReader::TraceReader()
+    :   mImage(new uint8_t[64*1024]()) {
+}
+
+TraceReader::~TraceReader() {
+    if (mBase)
+        munmap((void *)mBase, mSize);
+}
+
+int TraceReader::Open(const string &file) {
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cerr << "error opening trace file " << file << endl;
+        return -errno;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(TraceFileHeader)) {
+        cerr << "trace file " << file << " is too short" << endl;
+        close(fd);
+        return -EINVAL;
+    }
+
+    void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        cerr << "error mapping trace file " << file << endl;
+        return -errno;
+    }
+    mBase = (const uint8_t *)ptr;
+    mSize = st.st_size;
+
+    madvise(ptr, mSize, MADV_SEQUENTIAL);
+
+    const TraceFileHeader *h = (const TraceFileHeader *)mBase;
+    if (memcmp(h->magic, kTraceMagic, sizeof(h->magic)) != 0 || h->version != kTraceVersion ||
+        h->headerSize < sizeof(TraceFileHeader) || h->headerSize > mSize) {
+        cerr << "trace file " << file << " has a bad header" << endl;
+        return -EINVAL;
+    }
+
+    memcpy(mCpu, h->cpu, sizeof(h->cpu));
+    mPos = h->headerSize;
+
+    return 0;
+}
+
+bool TraceReader::Next(TraceEvent &e) {
+    auto u16 = [this](size_t off) -> uint16_t {
+        return mBase[mPos + off] | (mBase[mPos + off + 1] << 8);
+    };
+
+    // let go of what's been read, a trace many times the size of memory
+    // shouldn't stay resident just because it was mapped
+    if (mPos - mDropped >= kDropChunk) {
+        size_t end = mPos & ~(kDropChunk - 1);
+        madvise((void *)(mBase + mDropped), end - mDropped, MADV_DONTNEED);
+        mDropped = end;
+    }
+
+    while (Have(1)) {
+        uint8_t tag = mBase[mPos];
+
+        switch (tag) {
+            case TRACE_CODE: {
+                if (!Have(4) || !Have(4 + mBase[mPos + 3]))
+                    return false;
+                uint16_t addr = u16(1);
+                size_t len = mBase[mPos + 3];
+                for (size_t i = 0; i < len; i++)
+                    mImage[(addr + i) & 0xffff] = mBase[mPos + 4 + i];
+                mPos += 4 + len;
+                break;
+            }
+            case TRACE_WRITE:
+                if (!Have(4))
+                    return false;
+                e.type = TraceEvent::WRITE;
+                e.count = mCount - 1;
+                e.address = u16(1);
+                e.value = mBase[mPos + 3];
+                mImage[e.address] = e.value;
+                mPos += 4;
+                return true;
+            case TRACE_SYNC:
+                if (!Have(9))
+                    return false;
+                mCount = 0;
+                for (int i = 0; i < 8; i++)
+                    mCount |= (uint64_t)mBase[mPos + 1 + i] << (i * 8);
+                mPos += 9;
+                break;
+            default: {
+                if (tag & ~(TRACE_INSN_PC_ABS | TRACE_INSN_REGS))
+                    return false;
+
+                size_t len = 1 + ((tag & TRACE_INSN_PC_ABS) ? 2 : 1) + 1;
+                if (!Have(len))
+                    return false;
+
+                if (tag & TRACE_INSN_PC_ABS) {
+                    mPc = u16(1);
+                } else {
+                    mPc += (int8_t)mBase[mPos + 1];
+                }
+
+                e.type = TraceEvent::INSN;
+                e.count = mCount++;
+                e.address = mPc;
+                e.value = mBase[mPos + len - 1];
+                e.changed = 0;
+
+                if (tag & TRACE_INSN_REGS) {
+                    if (!Have(len + 1))
+                        return false;
+                    uint8_t mask = mBase[mPos + len];
+                    len++;
+                    for (int i = 0; i < 8; i++) {
+                        if (!(mask & (1 << i)))
+                            continue;
+                        if (!Have(len + 2))
+                            return false;
+                        mRegs[i] = u16(len);
+                        len += 2;
+                    }
+                    e.changed = mask;
+                }
+                memcpy(e.regs, mRegs, sizeof(e.regs));
+                mPos += len;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,236 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "debug/flightrecorder.h"
+
+class System;
+
+// Binary full execution trace.
+//
+// A fixed header followed by a stream of variable length records, all
+// multi-byte fields little endian. Instruction records carry the pc as a
+// delta from the previous one where it fits, the first opcode byte, and only
+// the registers that changed since the previous record. The instruction bytes
+// themselves go out once, the first time a pc is executed, and guest memory
+// writes are recorded so a decoder can keep its copy of the code current.
+struct TraceFileHeader {
+    char magic[8];      // "EMUTRACE"
+    uint32_t version;
+    uint32_t headerSize;
+    char cpu[16];       // cpu name, as the cpu reports it
+};
+
+enum : uint8_t {
+    // 0x00 - 0x3f, instruction: pc, opcode, [regmask, regs]
+    TRACE_INSN          = 0x00,
+    TRACE_INSN_PC_ABS   = 0x01, // 16 bit pc follows instead of a signed 8 bit delta
+    TRACE_INSN_REGS     = 0x02, // changed register mask and values follow the opcode
+
+    TRACE_CODE          = 0x40, // u16 address, u8 length, bytes
+    TRACE_WRITE         = 0x41, // u16 address, u8 value
+    TRACE_SYNC          = 0x42, // u64 instruction count of the next instruction record
+};
+
+class TraceWriter {
+public:
+    explicit TraceWriter(System &sys);
+    ~TraceWriter();
+
+    // non copyable
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+    int Open(const std::string &file, const char *cpu);
+    void Close();
+
+    // called by the cpu once per instruction, with its flight record of it
+    void Instruction(uint64_t count, const FlightRecord &r);
+
+    // called by the system on every guest memory write
+    void Write(uint32_t address, uint8_t val) {
+        uint8_t *p = Reserve(4);
+        p[0] = TRACE_WRITE;
+        p[1] = address;
+        p[2] = address >> 8;
+        p[3] = val;
+        Commit(4);
+    }
+
+    uint64_t GetInstructions() const { return mInstructions; }
+    size_t GetBytes() const { return mPos; }
+
+private:
+    static const size_t kMaxCodeBytes = 5;
+    static const uint64_t kSyncInterval = 64*1024; // power of 2
+    static const size_t kInitialSize = 64*1024*1024;
+
+    uint8_t *Reserve(size_t len) {
+        if (mPos + len > mSize)
+            Grow(len);
+        return mBase + mPos;
+    }
+    void Commit(size_t len) {
+        mPos += len;
+        mPublished.store(mPos, std::memory_order_release);
+    }
+
+    void Grow(size_t len);
+    void Sync(uint64_t count);
+    void Code(uint16_t pc);
+    void FlushThread();
+
+    System &mSys;
+
+    int mFd = -1;
+    uint8_t *mBase = nullptr;
+    size_t mSize = 0;
+    size_t mPos = 0;
+
+    // encoder state
+    uint64_t mNextCount = 0;
+    uint64_t mInstructions = 0;
+    uint16_t mLastPc = 0;
+    uint16_t mLastRegs[8] = {};
+    std::vector<uint64_t> mCodeSeen;
+
+    // background writeback of the finished part of the mapping
+    std::thread mFlusher;
+    std::mutex mMapLock;
+    std::condition_variable mFlushCond;
+    bool mStop = false;
+    std::atomic<size_t> mPublished { 0 };
+    size_t mFlushed = 0;
+};
+
+inline void TraceWriter::Instruction(uint64_t count, const FlightRecord &r) {
+    // absolute count now and then, and whenever the sequence breaks
+    if (count != mNextCount || (count & (kSyncInterval - 1)) == 0)
+        Sync(count);
+    mNextCount = count + 1;
+    mInstructions++;
+
+    if (!(mCodeSeen[r.pc / 64] & (1ULL << (r.pc % 64))))
+        Code(r.pc);
+
+    // tag, 16 bit pc, opcode, mask, 8 registers
+    uint8_t *start = Reserve(5 + 8 * 2);
+    uint8_t *p = start + 1;
+    uint8_t tag = TRACE_INSN;
+
+    int delta = (int)r.pc - (int)mLastPc;
+    if (delta >= -128 && delta <= 127) {
+        *p++ = (uint8_t)delta;
+    } else {
+        tag |= TRACE_INSN_PC_ABS;
+        *p++ = r.pc;
+        *p++ = r.pc >> 8;
+    }
+    mLastPc = r.pc;
+
+    *p++ = r.opcode;
+
+    uint8_t *maskp = p++;
+    uint8_t mask = 0;
+    for (int i = 0; i < 8; i++) {
+        if (r.regs[i] != mLastRegs[i]) {
+            mask |= 1 << i;
+            *p++ = r.regs[i];
+            *p++ = r.regs[i] >> 8;
+            mLastRegs[i] = r.regs[i];
+        }
+    }
+    if (mask) {
+        tag |= TRACE_INSN_REGS;
+        *maskp = mask;
+    } else {
+        p = maskp;
+    }
+
+    *start = tag;
+    Commit(p - start);
+}
+
+// one decoded record, code records are folded into the reader's memory image
+struct TraceEvent {
+    enum Type {
+        INSN,
+        WRITE,
+    } type;
+
+    uint64_t count;     // instruction count, for writes the instruction that did it
+    uint16_t address;   // pc or write address
+    uint8_t value;      // opcode or written value
+    uint8_t changed;    // mask of registers that changed since the last instruction
+    uint16_t regs[8];
+};
+
+class TraceReader {
+public:
+    TraceReader();
+    ~TraceReader();
+
+    // non copyable
+    TraceReader(const TraceReader &) = delete;
+    TraceReader &operator=(const TraceReader &) = delete;
+
+    int Open(const std::string &file);
+
+    const char *GetCpu() const { return mCpu; }
+
+    // returns false at the end of the trace, or on a corrupt record
+    bool Next(TraceEvent &e);
+
+    // guest memory as far as the trace has revealed it so far
+    const uint8_t *GetImage() const { return mImage.get(); }
+
+    size_t GetOffset() const { return mPos; }
+    size_t GetSize() const { return mSize; }
+
+private:
+    static const size_t kDropChunk = 64*1024*1024; // power of 2
+
+    bool Have(size_t len) const { return mPos + len <= mSize; }
+
+    const uint8_t *mBase = nullptr;
+    size_t mSize = 0;
+    size_t mPos = 0;
+    size_t mDropped = 0;
+
+    char mCpu[sizeof(TraceFileHeader::cpu) + 1] = {};
+    uint64_t mCount = 0;
+    uint16_t mPc = 0;
+    uint16_t mRegs[8] = {};
+    std::unique_ptr<uint8_t[]> mImage;
+};
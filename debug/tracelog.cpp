@@ -0,0 +1,586 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "tracelog.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// per thread, single producer single consumer. Positions only ever count up,
+// the index into the buffer is the position masked by the size.
+struct Ring {
+    static const size_t kSize = 4 * 1024 * 1024;
+
+    uint8_t *buf;
+    atomic<size_t> head { 0 };  // written by the logging thread
+    atomic<size_t> tail { 0 };  // written by whoever is formatting
+    size_t pending = 0;         // head once the reserved record is committed
+};
+
+// records are 16 byte aligned so a header always fits before the end of the
+// buffer. A null format marks the rest of the buffer as unused.
+struct Header {
+    uint32_t size;              // including the header
+    uint32_t len;               // of the arguments
+    const char *fmt;
+};
+
+const size_t kAlign = 16;
+
+// raw file: the magic, then records of a RawHeader and len bytes. A record
+// with kDefine set in len holds the format string for id, the first time id
+// is used. The rest hold the arguments of one Printf().
+struct RawHeader {
+    uint32_t id;
+    uint32_t len;
+};
+
+const char kRawMagic[8] = "EMUTLOG";
+const uint32_t kDefine = 0x80000000;
+
+// never freed, the formatter thread may still be running at exit
+struct State {
+    mutex ringsLock;
+    vector<Ring *> rings;
+
+    // held while formatting, so Flush() and the thread take turns
+    mutex drainLock;
+    string out;
+
+    // raw mode, out is records rather than text
+    FILE *raw = nullptr;
+    unordered_map<const char *, uint32_t> ids;
+};
+
+State *sState;
+once_flag sStartOnce;
+thread_local Ring *tRing;
+
+void Drain(bool all);
+
+void FormatterThread() {
+    for (;;) {
+        Drain(false);
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+
+void Start() {
+    sState = new State();
+    thread(&FormatterThread).detach();
+    atexit(&TraceLog::Flush);
+}
+
+}
+
+// pulls the arguments back out of a record, in order
+class TraceLogFormatter {
+public:
+    TraceLogFormatter(const uint8_t *p, const uint8_t *end) : mPtr(p), mEnd(end) {}
+
+    void Format(const char *fmt, string &out);
+
+private:
+    struct Arg {
+        TraceLog::Tag tag = TraceLog::UINT;
+        uint64_t val = 0;
+        const char *str = "";
+    };
+    Arg Next();
+
+    // one parsed %conversion
+    struct Conversion {
+        bool left = false;
+        bool zero = false;
+        bool other = false;     // flags or lengths only snprintf handles
+        bool l = false;
+        bool ll = false;
+        int width = 0;
+        int precision = -1;
+        int nstars = 0;
+        int stars[2];
+        char conv = 0;
+    };
+
+    template <typename T>
+    void Append(string &out, const char *spec, int nstars, const int *stars, T val);
+    bool AppendFast(string &out, const Conversion &c, const Arg &a);
+    void Pad(string &out, const Conversion &c, size_t len, const char *digits, bool neg);
+
+    const uint8_t *mPtr;
+    const uint8_t *mEnd;
+};
+
+TraceLogFormatter::Arg TraceLogFormatter::Next() {
+    Arg a;
+    if (mPtr >= mEnd)
+        return a;
+
+    a.tag = static_cast<TraceLog::Tag>(*mPtr++);
+    if (a.tag == TraceLog::STRING) {
+        a.str = reinterpret_cast<const char *>(mPtr);
+        mPtr += strlen(a.str) + 1;
+    } else {
+        memcpy(&a.val, mPtr, sizeof(a.val));
+        mPtr += sizeof(a.val);
+    }
+    return a;
+}
+
+template <typename T>
+void TraceLogFormatter::Append(string &out, const char *spec, int nstars, const int *stars, T val) {
+    char buf[512];
+    int len;
+    switch (nstars) {
+        default:
+        case 0: len = snprintf(buf, sizeof(buf), spec, val); break;
+        case 1: len = snprintf(buf, sizeof(buf), spec, stars[0], val); break;
+        case 2: len = snprintf(buf, sizeof(buf), spec, stars[0], stars[1], val); break;
+    }
+    if (len > 0)
+        out.append(buf, min<size_t>(len, sizeof(buf) - 1));
+}
+
+// the handful of conversions the trace macros actually use, without going
+// through snprintf. Only '-' and '0' flags and a plain width, anything else
+// goes the slow way.
+bool TraceLogFormatter::AppendFast(string &out, const Conversion &c, const Arg &a) {
+    if (c.other || c.nstars || c.precision >= 0 || a.tag == TraceLog::DOUBLE)
+        return false;
+
+    static const char lower[] = "0123456789abcdef";
+    static const char upper[] = "0123456789ABCDEF";
+
+    char buf[32];
+    char *end = buf + sizeof(buf);
+    char *p = end;
+    bool neg = false;
+
+    switch (c.conv) {
+        case 'd':
+        case 'i': {
+            int64_t v = static_cast<int64_t>(a.val);
+            if (!c.l && !c.ll)
+                v = static_cast<int>(v);
+            uint64_t u = v < 0 ? -static_cast<uint64_t>(v) : v;
+            neg = v < 0;
+            do { *--p = lower[u % 10]; u /= 10; } while (u);
+            break;
+        }
+        case 'u':
+        case 'x':
+        case 'X': {
+            uint64_t u = a.val;
+            if (!c.l && !c.ll)
+                u = static_cast<unsigned int>(u);
+            if (c.conv == 'u') {
+                do { *--p = lower[u % 10]; u /= 10; } while (u);
+            } else {
+                const char *digits = (c.conv == 'x') ? lower : upper;
+                do { *--p = digits[u & 0xf]; u >>= 4; } while (u);
+            }
+            break;
+        }
+        case 'c':
+            *--p = static_cast<char>(a.val);
+            break;
+        case 's':
+            if (a.tag != TraceLog::STRING)
+                return false;
+            Pad(out, c, strlen(a.str), a.str, false);
+            return true;
+        default:
+            return false;
+    }
+
+    Pad(out, c, end - p, p, neg);
+    return true;
+}
+
+void TraceLogFormatter::Pad(string &out, const Conversion &c, size_t len, const char *digits, bool neg) {
+    size_t total = len + (neg ? 1 : 0);
+    size_t pad = (c.width > 0 && static_cast<size_t>(c.width) > total) ? c.width - total : 0;
+    bool zero = c.zero && !c.left && c.conv != 's' && c.conv != 'c';
+
+    if (pad && !c.left && !zero)
+        out.append(pad, ' ');
+    if (neg)
+        out.push_back('-');
+    if (pad && zero)
+        out.append(pad, '0');
+    out.append(digits, len);
+    if (pad && c.left)
+        out.append(pad, ' ');
+}
+
+// printf conversion by conversion, each argument cast to what its length
+// modifier says it should be
+void TraceLogFormatter::Format(const char *fmt, string &out) {
+    while (*fmt) {
+        if (*fmt != '%') {
+            const char *start = fmt;
+            while (*fmt && *fmt != '%')
+                fmt++;
+            out.append(start, fmt - start);
+            continue;
+        }
+        if (fmt[1] == '%') {
+            out.push_back('%');
+            fmt += 2;
+            continue;
+        }
+
+        const char *start = fmt++;
+        Conversion c;
+        for (;; fmt++) {
+            if (*fmt == '-') c.left = true;
+            else if (*fmt == '0') c.zero = true;
+            else if (*fmt == '+' || *fmt == ' ' || *fmt == '#' || *fmt == '\'') c.other = true;
+            else break;
+        }
+        for (int field = 0; field < 2; field++) {
+            if (field == 1) {
+                if (*fmt != '.')
+                    break;
+                fmt++;
+                c.precision = 0;
+            }
+            if (*fmt == '*') {
+                c.stars[c.nstars++] = static_cast<int>(Next().val);
+                fmt++;
+            }
+            int n = 0;
+            while (*fmt >= '0' && *fmt <= '9')
+                n = n * 10 + (*fmt++ - '0');
+            if (field == 0)
+                c.width = n;
+            else
+                c.precision = n;
+        }
+
+        char length[3] = {};
+        for (int i = 0; i < 2 && *fmt && strchr("hljztLq", *fmt); i++)
+            length[i] = *fmt++;
+
+        c.conv = *fmt;
+        if (!c.conv)
+            break;
+        fmt++;
+
+        c.l = !strcmp(length, "l");
+        c.ll = !strcmp(length, "ll") || !strcmp(length, "q");
+        bool z = !strcmp(length, "z");
+        bool j = !strcmp(length, "j");
+        bool t = !strcmp(length, "t");
+        if (z || j || t || length[0] == 'L')
+            c.other = true;
+
+        char spec[64];
+        size_t specLen = min<size_t>(fmt - start, sizeof(spec) - 1);
+        memcpy(spec, start, specLen);
+        spec[specLen] = 0;
+
+        Arg a;
+        switch (c.conv) {
+            case 'd':
+            case 'i': {
+                a = Next();
+                if (AppendFast(out, c, a))
+                    break;
+                int64_t v = a.tag == TraceLog::DOUBLE ? 0 : static_cast<int64_t>(a.val);
+                if (c.l) Append(out, spec, c.nstars, c.stars, static_cast<long>(v));
+                else if (c.ll) Append(out, spec, c.nstars, c.stars, static_cast<long long>(v));
+                else if (z) Append(out, spec, c.nstars, c.stars, static_cast<ssize_t>(v));
+                else if (j) Append(out, spec, c.nstars, c.stars, static_cast<intmax_t>(v));
+                else if (t) Append(out, spec, c.nstars, c.stars, static_cast<ptrdiff_t>(v));
+                else Append(out, spec, c.nstars, c.stars, static_cast<int>(v));
+                break;
+            }
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+            case 'c': {
+                a = Next();
+                if (AppendFast(out, c, a))
+                    break;
+                uint64_t v = a.tag == TraceLog::DOUBLE ? 0 : a.val;
+                if (c.l) Append(out, spec, c.nstars, c.stars, static_cast<unsigned long>(v));
+                else if (c.ll) Append(out, spec, c.nstars, c.stars, static_cast<unsigned long long>(v));
+                else if (z) Append(out, spec, c.nstars, c.stars, static_cast<size_t>(v));
+                else if (j) Append(out, spec, c.nstars, c.stars, static_cast<uintmax_t>(v));
+                else if (t) Append(out, spec, c.nstars, c.stars, static_cast<ptrdiff_t>(v));
+                else Append(out, spec, c.nstars, c.stars, static_cast<unsigned int>(v));
+                break;
+            }
+            case 's':
+                a = Next();
+                if (AppendFast(out, c, a))
+                    break;
+                Append(out, spec, c.nstars, c.stars, a.tag == TraceLog::STRING ? a.str : "(?)");
+                break;
+            case 'p':
+                a = Next();
+                Append(out, spec, c.nstars, c.stars, reinterpret_cast<void *>(static_cast<uintptr_t>(a.val)));
+                break;
+            case 'f': case 'F':
+            case 'e': case 'E':
+            case 'g': case 'G':
+            case 'a': case 'A': {
+                a = Next();
+                double d;
+                if (a.tag == TraceLog::DOUBLE) {
+                    memcpy(&d, &a.val, sizeof(d));
+                } else {
+                    d = static_cast<double>(static_cast<int64_t>(a.val));
+                }
+                if (length[0] == 'L')
+                    Append(out, spec, c.nstars, c.stars, static_cast<long double>(d));
+                else
+                    Append(out, spec, c.nstars, c.stars, d);
+                break;
+            }
+            case 'n':
+                Next();
+                break;
+            default:
+                out.append(spec);
+                break;
+        }
+    }
+}
+
+namespace {
+
+// write out all of the formatted text, or only up through the last complete
+// line so a stray printf doesn't land in the middle of one
+void Write(string &out, bool all) {
+    if (sState->raw) {
+        fwrite(out.data(), 1, out.size(), sState->raw);
+        out.clear();
+        return;
+    }
+
+    size_t len = out.size();
+    if (!all) {
+        size_t nl = out.rfind('\n');
+        len = (nl == string::npos) ? 0 : nl + 1;
+    }
+    if (!len)
+        return;
+
+    fwrite(out.data(), 1, len, stdout);
+    out.erase(0, len);
+}
+
+void AppendRaw(string &out, uint32_t id, uint32_t len, const void *data) {
+    RawHeader h = { id, len };
+    out.append(reinterpret_cast<const char *>(&h), sizeof(h));
+    out.append(static_cast<const char *>(data), len & ~kDefine);
+}
+
+// copy a record to out as is, defining its format first if it's new
+void AppendRecord(string &out, const Header *h, const uint8_t *args) {
+    auto i = sState->ids.find(h->fmt);
+    if (i == sState->ids.end()) {
+        i = sState->ids.emplace(h->fmt, sState->ids.size()).first;
+        AppendRaw(out, i->second, strlen(h->fmt) | kDefine, h->fmt);
+    }
+    AppendRaw(out, i->second, h->len, args);
+}
+
+// format whatever each thread has logged, returns once they're all empty
+void Drain(bool all) {
+    lock_guard<mutex> drain(sState->drainLock);
+
+    vector<Ring *> rings;
+    {
+        lock_guard<mutex> lock(sState->ringsLock);
+        rings = sState->rings;
+    }
+
+    string &out = sState->out;
+    for (Ring *r : rings) {
+        size_t tail = r->tail.load(memory_order_relaxed);
+        size_t head = r->head.load(memory_order_acquire);
+        while (tail != head) {
+            size_t index = tail & (Ring::kSize - 1);
+            const Header *h = reinterpret_cast<const Header *>(r->buf + index);
+            if (!h->fmt) {
+                tail += Ring::kSize - index;
+            } else {
+                const uint8_t *args = r->buf + index + sizeof(Header);
+                if (sState->raw)
+                    AppendRecord(out, h, args);
+                else
+                    TraceLogFormatter(args, args + h->len).Format(h->fmt, out);
+                tail += h->size;
+            }
+
+            // hand back the space as we go, the logging thread may be waiting on it
+            r->tail.store(tail, memory_order_release);
+
+            if (out.size() >= 64 * 1024)
+                Write(out, false);
+            if (tail == head)
+                head = r->head.load(memory_order_acquire);
+        }
+    }
+
+    Write(out, all);
+    fflush(sState->raw ? sState->raw : stdout);
+}
+
+}
+
+void TraceLog::Flush() {
+    if (sState)
+        Drain(true);
+}
+
+int TraceLog::SetRawFile(const string &file) {
+    call_once(sStartOnce, &Start);
+
+    FILE *fp = fopen(file.c_str(), "wb");
+    if (!fp) {
+        int err = -errno;
+        fprintf(stderr, "error opening trace log '%s'\n", file.c_str());
+        return err;
+    }
+    fwrite(kRawMagic, 1, sizeof(kRawMagic), fp);
+
+    lock_guard<mutex> drain(sState->drainLock);
+    sState->raw = fp;
+    return 0;
+}
+
+int TraceLog::Decode(const string &file, FILE *out) {
+    FILE *fp = fopen(file.c_str(), "rb");
+    if (!fp) {
+        int err = -errno;
+        fprintf(stderr, "error opening trace log '%s'\n", file.c_str());
+        return err;
+    }
+
+    char magic[sizeof(kRawMagic)];
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) || memcmp(magic, kRawMagic, sizeof(magic)) != 0) {
+        fprintf(stderr, "'%s' is not a trace log\n", file.c_str());
+        fclose(fp);
+        return -EINVAL;
+    }
+
+    vector<string> fmts;
+    vector<uint8_t> args;
+    string text;
+    int err = 0;
+
+    RawHeader h;
+    while (fread(&h, sizeof(h), 1, fp) == 1) {
+        uint32_t len = h.len & ~kDefine;
+        args.resize(len + 1);
+        if (len && fread(args.data(), len, 1, fp) != 1) {
+            fprintf(stderr, "trace log '%s' is truncated\n", file.c_str());
+            err = -EINVAL;
+            break;
+        }
+
+        if (h.len & kDefine) {
+            if (h.id >= fmts.size())
+                fmts.resize(h.id + 1);
+            fmts[h.id].assign(reinterpret_cast<const char *>(args.data()), len);
+            continue;
+        }
+        if (h.id >= fmts.size()) {
+            fprintf(stderr, "trace log '%s' uses undefined format %u\n", file.c_str(), h.id);
+            err = -EINVAL;
+            break;
+        }
+
+        TraceLogFormatter(args.data(), args.data() + len).Format(fmts[h.id].c_str(), text);
+        if (text.size() >= 64 * 1024) {
+            fwrite(text.data(), 1, text.size(), out);
+            text.clear();
+        }
+    }
+    fwrite(text.data(), 1, text.size(), out);
+
+    fclose(fp);
+    return err;
+}
+
+uint8_t *TraceLog::Reserve(const char *fmt, size_t len) {
+    Ring *r = tRing;
+    if (!r) {
+        call_once(sStartOnce, &Start);
+
+        r = new Ring();
+        r->buf = static_cast<uint8_t *>(malloc(Ring::kSize));
+
+        lock_guard<mutex> lock(sState->ringsLock);
+        sState->rings.push_back(r);
+        tRing = r;
+    }
+
+    size_t size = (sizeof(Header) + len + kAlign - 1) & ~(kAlign - 1);
+    size_t head = r->head.load(memory_order_relaxed);
+    size_t index = head & (Ring::kSize - 1);
+
+    // doesn't fit before the end, skip to the start
+    size_t skip = (index + size > Ring::kSize) ? Ring::kSize - index : 0;
+
+    // wait for the formatter to catch up if it has to
+    while (head + skip + size - r->tail.load(memory_order_acquire) > Ring::kSize)
+        this_thread::yield();
+
+    if (skip) {
+        Header *h = reinterpret_cast<Header *>(r->buf + index);
+        h->size = skip;
+        h->fmt = nullptr;
+        head += skip;
+        index = 0;
+    }
+
+    Header *h = reinterpret_cast<Header *>(r->buf + index);
+    h->size = size;
+    h->len = len;
+    h->fmt = fmt;
+    r->pending = head + size;
+
+    return r->buf + index + sizeof(Header);
+}
+
+void TraceLog::Commit() {
+    tRing->head.store(tRing->pending, memory_order_release);
+}
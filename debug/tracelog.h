@@ -0,0 +1,132 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+// Deferred printf behind the TRACEF family of macros. The calling thread only
+// copies the format pointer and the raw arguments into a ring buffer of its
+// own, a background thread does the formatting and writes it to stdout.
+//
+// The format has to be a literal, only the pointer is kept. %s arguments are
+// copied, up to kMaxString bytes. Lines from one thread come out in order,
+// lines from different threads and from plain printf can interleave
+// differently than they would have. If the formatter falls behind the
+// buffer fills and logging threads wait for it, nothing is dropped.
+class TraceLog {
+public:
+    template <typename... Args>
+    static void Printf(const char *fmt, Args... args) {
+        uint8_t *p = Reserve(fmt, SizeAll(args...));
+        PutAll(p, args...);
+        Commit();
+    }
+
+    // format and write out everything logged so far, from every thread
+    static void Flush();
+
+    // write raw records to file instead of text to stdout, before anything is logged
+    static int SetRawFile(const std::string &file);
+
+    // format a file written by SetRawFile() to out
+    static int Decode(const std::string &file, FILE *out);
+
+    static const size_t kMaxString = 255;
+
+private:
+    // space for a record of len bytes of arguments in the calling thread's buffer
+    static uint8_t *Reserve(const char *fmt, size_t len);
+    static void Commit();
+
+    // each argument is a tag byte, then 8 bytes of value or a nul terminated string
+    enum Tag : uint8_t {
+        INT,
+        UINT,
+        DOUBLE,
+        POINTER,
+        STRING,
+    };
+
+    static uint8_t *PutRaw(uint8_t *p, Tag t, uint64_t v) {
+        *p++ = t;
+        memcpy(p, &v, sizeof(v));
+        return p + sizeof(v);
+    }
+
+    static size_t StringLen(const char *s) { return s ? strnlen(s, kMaxString) : 0; }
+
+    template <typename T>
+    static size_t Size(T) { return 1 + sizeof(uint64_t); }
+    static size_t Size(const char *s) { return 1 + StringLen(s) + 1; }
+    static size_t Size(char *s) { return Size(static_cast<const char *>(s)); }
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, uint8_t *>::type
+    Put(uint8_t *p, T v) { return PutRaw(p, INT, static_cast<uint64_t>(static_cast<int64_t>(v))); }
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, uint8_t *>::type
+    Put(uint8_t *p, T v) { return PutRaw(p, UINT, static_cast<uint64_t>(v)); }
+
+    template <typename T>
+    static typename std::enable_if<std::is_enum<T>::value, uint8_t *>::type
+    Put(uint8_t *p, T v) { return PutRaw(p, INT, static_cast<uint64_t>(static_cast<int64_t>(v))); }
+
+    template <typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value, uint8_t *>::type
+    Put(uint8_t *p, T v) {
+        double d = v;
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        return PutRaw(p, DOUBLE, bits);
+    }
+
+    template <typename T>
+    static uint8_t *Put(uint8_t *p, T *v) { return PutRaw(p, POINTER, reinterpret_cast<uintptr_t>(v)); }
+
+    static uint8_t *Put(uint8_t *p, const char *s) {
+        size_t len = StringLen(s);
+        *p++ = STRING;
+        if (len)
+            memcpy(p, s, len);
+        p[len] = 0;
+        return p + len + 1;
+    }
+    static uint8_t *Put(uint8_t *p, char *s) { return Put(p, static_cast<const char *>(s)); }
+
+    static size_t SizeAll() { return 0; }
+    template <typename T, typename... Rest>
+    static size_t SizeAll(T v, Rest... rest) { return Size(v) + SizeAll(rest...); }
+
+    static uint8_t *PutAll(uint8_t *p) { return p; }
+    template <typename T, typename... Rest>
+    static uint8_t *PutAll(uint8_t *p, T v, Rest... rest) { return PutAll(Put(p, v), rest...); }
+
+    friend class TraceLogFormatter;
+};
@@ -26,12 +26,18 @@
 #include <cassert>
 #include <iostream>
 
+#include "debug/hostprofile.h"
+#include "debug/probes.h"
+#include "debug/stats.h"
+#include "debug/timeline.h"
+#include "debug/tracelog.h"
 #include "memory.h"
 #include "mc6850.h"
+#include "system/snapshot.h"
 
 #define TRACE 0
 
-#define TRACEF(str, x...) do { if (TRACE) printf(str, ## x); } while (0)
+#define TRACEF(str, x...) do { if (TRACE) TraceLog::Printf(str, ## x); } while (0)
 
 #define STAT_RDRF (1<<0)
 #define STAT_TDRE (1<<1)
@@ -52,7 +58,37 @@ MC6850::MC6850(Console &con)
 MC6850::~MC6850() {
 }
 
+namespace {
+struct MC6850State {
+    uint8_t control;
+    uint8_t status;
+    int16_t pendingRx;
+};
+}
+
+void MC6850::SaveState(SnapshotWriter &w, const std::string &name) {
+    MC6850State s = { mControl, mStatus, (int16_t)mPendingRx };
+    w.AddSection(name, &s, sizeof(s));
+}
+
+int MC6850::LoadState(SnapshotReader &r, const std::string &name) {
+    MC6850State s;
+    int err = r.Read(name, &s, sizeof(s));
+    if (err < 0)
+        return err;
+
+    mControl = s.control;
+    mStatus = s.status;
+    mPendingRx = s.pendingRx;
+    return 0;
+}
+
 uint8_t MC6850::ReadByte(size_t address) {
+    HostProfileScope prof(HostProfile::DEVICE);
+
+    if (mStats)
+        StatsAdd(mStats->reads, 1);
+
     uint8_t val;
 
     TRACEF("MC6850: readbyte address 0x%zx\n", address);
@@ -78,20 +114,32 @@ uint8_t MC6850::ReadByte(size_t address) {
             val = mPendingRx;
             mPendingRx = -1;
             TRACEF("cpu read data %d\n", val);
+            if (Timeline::IsEnabled())
+                Timeline::Instant("mc6850 rx", "device", "char", val);
         }
     } else {
         // unknown
     }
+
+    EMU_PROBE3(mmio_read, "mc6850", address, val);
     return val;
 }
 
 void MC6850::WriteByte(size_t address, uint8_t val) {
+    HostProfileScope prof(HostProfile::DEVICE);
+
+    if (mStats)
+        StatsAdd(mStats->writes, 1);
+    EMU_PROBE3(mmio_write, "mc6850", address, val);
+
     TRACEF("MC6850: writebyte address 0x%zx, val 0x%hhx\n", address, val);
 
     if (address == 0) {
         // control register
         // XXX ignore for now
         mControl = val;
+        if (Timeline::IsEnabled())
+            Timeline::Instant("mc6850 control", "device", "val", val);
         //printf("MC6850: control reg %#x\n", val);
     } else if (address == 1) {
         // data register
@@ -23,26 +23,79 @@
  */
 #include "memory.h"
 
+#include <cerrno>
 #include <cstring>
+#include <sys/mman.h>
+
+#include "system/snapshot.h"
 
 Memory::Memory() {
 }
 
 Memory::~Memory() {
+    Free();
 }
 
-int Memory::Alloc(size_t len) {
-    mMem.release();
+void Memory::Free() {
+    if (mMapped) {
+        munmap(mMem, mSize);
+    } else {
+        delete[] mMem;
+    }
+    mMem = nullptr;
     mSize = 0;
+    mMapped = false;
+}
+
+int Memory::Alloc(size_t len) {
+    Free();
 
-    mMem.reset(new uint8_t[len]);
+    mMem = new uint8_t[len];
     if (!mMem)
         return -1;
 
     mSize = len;
+    mDirty.assign((GetPageCount() + 63) / 64, 0);
 
-    memset(mMem.get(), 0, len);
+    memset(mMem, 0, len);
 
     return 0;
 }
 
+int Memory::Map(int fd, off_t offset) {
+    size_t len = mSize;
+
+    void *ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, offset);
+    if (ptr == MAP_FAILED)
+        return -errno;
+
+    Free();
+
+    mMem = (uint8_t *)ptr;
+    mSize = len;
+    mMapped = true;
+
+    return 0;
+}
+
+void Memory::LoadDirty(const void *data) {
+    for (size_t word = 0; word < mDirty.size(); word++) {
+        for (uint64_t bits = mDirty[word]; bits; bits &= bits - 1) {
+            size_t offset = (word * 64 + __builtin_ctzll(bits)) << kPageShift;
+            size_t len = mSize - offset;
+            if (len > kPageSize)
+                len = kPageSize;
+            memcpy(mMem + offset, (const uint8_t *)data + offset, len);
+        }
+        mDirty[word] = 0;
+    }
+}
+
+void Memory::SaveState(SnapshotWriter &w, const std::string &name) {
+    w.AddMemory(name, *this);
+}
+
+int Memory::LoadState(SnapshotReader &r, const std::string &name) {
+    return r.MapMemory(name, *this);
+}
+
@@ -23,9 +23,16 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
-#include <memory>
+#include <cstring>
+#include <string>
 #include <sys/types.h>
+#include <vector>
+
+class SnapshotReader;
+class SnapshotWriter;
+struct StatsDevice;
 
 class MemoryDevice {
 public:
@@ -38,6 +45,20 @@ public:
 
     virtual uint8_t ReadByte(size_t address) = 0;
     virtual void WriteByte(size_t address, uint8_t val) = 0;
+
+    // read without side effects, for debug tools. Devices whose registers
+    // change state on read just return 0.
+    virtual uint8_t PeekByte(size_t) { return 0; }
+
+    // save state, under sections starting with name. Most devices have none.
+    virtual void SaveState(SnapshotWriter &, const std::string &) {}
+    virtual int LoadState(SnapshotReader &, const std::string &) { return 0; }
+
+    // count accesses in a system's live stats, for devices worth watching. Not owned.
+    void SetStats(StatsDevice *dev) { mStats = dev; }
+
+protected:
+    StatsDevice *mStats = nullptr;
 };
 
 class Memory : public MemoryDevice {
@@ -47,16 +68,49 @@ public:
 
     int Alloc(size_t len);
 
+    // replace the contents with a private copy on write mapping of a file,
+    // offset must be page aligned
+    int Map(int fd, off_t offset);
+
     // simple accessors, assumes bounds checking somewhere else
     virtual uint8_t ReadByte(size_t address) override { return mMem[address]; }
-    virtual void WriteByte(size_t address, uint8_t val) override { mMem[address] = val; }
+    virtual void WriteByte(size_t address, uint8_t val) override {
+        mMem[address] = val;
+        mDirty[address >> (kPageShift + 6)] |= 1ULL << ((address >> kPageShift) & 63);
+    }
+    virtual uint8_t PeekByte(size_t address) override { return mMem[address]; }
+
+    virtual void SaveState(SnapshotWriter &w, const std::string &name) override;
+    virtual int LoadState(SnapshotReader &r, const std::string &name) override;
 
     size_t GetSize() const { return mSize; }
 
+    // overwrite the contents, without marking anything dirty
+    void Load(const void *data) { memcpy(mMem, data, mSize); }
+
+    // put back just the dirty pages from a copy of the contents, and clear them
+    void LoadDirty(const void *data);
+
+    // pages written through WriteByte() since the last ClearDirty(), one bit per
+    // page, for building incremental save states
+    static const size_t kPageShift = 8;
+    static const size_t kPageSize = 1 << kPageShift;
+    size_t GetPageCount() const { return (mSize + kPageSize - 1) >> kPageShift; }
+    bool IsDirty(size_t page) const { return mDirty[page >> 6] & (1ULL << (page & 63)); }
+    const uint64_t *GetDirty() const { return mDirty.data(); }
+
+    // start over once whoever is saving state has what it needs
+    void ClearDirty() { std::fill(mDirty.begin(), mDirty.end(), 0); }
+
     // grab a raw pointer to it, don't abuse!
-    void *GetPtr() { return mMem.get(); }
+    void *GetPtr() { return mMem; }
+    const void *GetPtr() const { return mMem; }
 
 private:
-    std::unique_ptr<uint8_t[]> mMem;
+    void Free();
+
+    uint8_t *mMem = nullptr;
     size_t mSize = 0;
+    bool mMapped = false;
+    std::vector<uint64_t> mDirty;
 };
@@ -24,12 +24,19 @@
 
 #include <cstdio>
 #include <cassert>
+#include <cstring>
 #include <iostream>
 
+#include "debug/hostprofile.h"
+#include "debug/probes.h"
+#include "debug/stats.h"
+#include "debug/timeline.h"
+#include "debug/tracelog.h"
 #include "memory.h"
 #include "uart16550.h"
+#include "system/snapshot.h"
 
-//#define TRACEF(str, x...) do { printf("uart16550: " str, ## x); } while (0)
+//#define TRACEF(str, x...) do { TraceLog::Printf("uart16550: " str, ## x); } while (0)
 #define TRACEF(str, x...) do { } while (0)
 
 using namespace std;
@@ -59,7 +66,37 @@ uart16550::uart16550(Console &con)
 uart16550::~uart16550() {
 }
 
+namespace {
+struct uart16550State {
+    uint8_t registers[8 + 2];
+    int16_t pendingRx;
+};
+}
+
+void uart16550::SaveState(SnapshotWriter &w, const std::string &name) {
+    uart16550State s;
+    memcpy(s.registers, mRegisters, sizeof(s.registers));
+    s.pendingRx = mPendingRx;
+    w.AddSection(name, &s, sizeof(s));
+}
+
+int uart16550::LoadState(SnapshotReader &r, const std::string &name) {
+    uart16550State s;
+    int err = r.Read(name, &s, sizeof(s));
+    if (err < 0)
+        return err;
+
+    memcpy(mRegisters, s.registers, sizeof(mRegisters));
+    mPendingRx = s.pendingRx;
+    return 0;
+}
+
 uint8_t uart16550::ReadByte(size_t address) {
+    HostProfileScope prof(HostProfile::DEVICE);
+
+    if (mStats)
+        StatsAdd(mStats->reads, 1);
+
     uint8_t val;
 
     TRACEF("uart16550: readbyte address 0x%zx\n", address);
@@ -85,6 +122,8 @@ uint8_t uart16550::ReadByte(size_t address) {
                 if (mPendingRx >= 0) {
                     val = mPendingRx;
                     mPendingRx = -1;
+                    if (Timeline::IsEnabled())
+                        Timeline::Instant("uart16550 rx", "device", "char", val);
                 }
             }
             break;
@@ -121,10 +160,17 @@ uint8_t uart16550::ReadByte(size_t address) {
     }
 
     TRACEF("returning val 0x%hhx\n", val);
+    EMU_PROBE3(mmio_read, "uart16550", address, val);
     return val;
 }
 
 void uart16550::WriteByte(size_t address, uint8_t val) {
+    HostProfileScope prof(HostProfile::DEVICE);
+
+    if (mStats)
+        StatsAdd(mStats->writes, 1);
+    EMU_PROBE3(mmio_write, "uart16550", address, val);
+
     TRACEF("uart16550: writebyte address 0x%zx, val 0x%hhx\n", address, val);
 
     /* device is mirrored for the entire address space */
@@ -153,6 +199,8 @@ void uart16550::WriteByte(size_t address, uint8_t val) {
             break;
         case LCR:
             mRegisters[LCR] = val;
+            if (Timeline::IsEnabled())
+                Timeline::Instant("uart16550 lcr", "device", "val", val);
             break;
         case MCR:
             mRegisters[MCR] = val;
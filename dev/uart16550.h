@@ -37,6 +37,9 @@ public:
     virtual uint8_t ReadByte(size_t address) override;
     virtual void WriteByte(size_t address, uint8_t val) override;
 
+    virtual void SaveState(SnapshotWriter &w, const std::string &name) override;
+    virtual int LoadState(SnapshotReader &r, const std::string &name) override;
+
 private:
     uint8_t mRegisters[8 + 2] = {};
     int mPendingRx = -1;
@@ -0,0 +1,430 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "farm.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "cpu/cpu.h"
+#include "debug/coverage.h"
+#include "debug/stats.h"
+#include "debug/symbols.h"
+#include "debug/timeline.h"
+#include "headless.h"
+#include "system/system.h"
+
+using namespace std;
+
+// instructions a job runs before going to the back of its worker's queue
+static const uint64_t kSliceInstructions = 1000000;
+
+// split a manifest line into key=value pairs, handling quotes and escapes
+static bool ParseManifestLine(const string &line, vector<pair<string, string>> &pairs) {
+    size_t i = 0;
+    while (i < line.size()) {
+        if (isspace((unsigned char)line[i])) {
+            i++;
+            continue;
+        }
+
+        size_t eq = line.find('=', i);
+        if (eq == string::npos)
+            return false;
+        string key = line.substr(i, eq - i);
+        i = eq + 1;
+
+        string val;
+        bool quoted = (i < line.size() && line[i] == '"');
+        if (quoted)
+            i++;
+        for (; i < line.size(); i++) {
+            char c = line[i];
+            if (quoted && c == '"') {
+                i++;
+                break;
+            }
+            if (!quoted && isspace((unsigned char)c))
+                break;
+            if (c == '\\' && i + 1 < line.size()) {
+                c = line[++i];
+                switch (c) {
+                    case 'n': c = '\n'; break;
+                    case 'r': c = '\r'; break;
+                    case 't': c = '\t'; break;
+                }
+            }
+            val.push_back(c);
+        }
+
+        pairs.push_back(make_pair(key, val));
+    }
+
+    return true;
+}
+
+int ParseFarmManifest(const string &file, vector<FarmJob> &jobs) {
+    ifstream in(file);
+    if (!in) {
+        cerr << "error opening farm manifest " << file << endl;
+        return -ENOENT;
+    }
+
+    string line;
+    for (int lineno = 1; getline(in, line); lineno++) {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == string::npos || line[start] == '#')
+            continue;
+
+        vector<pair<string, string>> pairs;
+        if (!ParseManifestLine(line, pairs)) {
+            cerr << file << ":" << lineno << ": expected key=value" << endl;
+            return -EINVAL;
+        }
+
+        FarmJob job;
+        job.name = "job" + to_string(jobs.size());
+        for (auto &p : pairs) {
+            if (p.first == "name") {
+                job.name = p.second;
+            } else if (p.first == "system") {
+                job.system = p.second;
+            } else if (p.first == "cpu") {
+                job.cpu = p.second;
+            } else if (p.first == "rom") {
+                job.rom = p.second;
+            } else if (p.first == "input") {
+                job.input = p.second;
+            } else if (p.first == "output") {
+                job.output = p.second;
+            } else if (p.first == "stop-on") {
+                job.stopOn = p.second;
+            } else if (p.first == "max-instructions") {
+                job.maxInstructions = strtoull(p.second.c_str(), NULL, 0);
+            } else if (p.first == "timeout") {
+                job.timeout = strtod(p.second.c_str(), NULL);
+            } else if (p.first == "load-state") {
+                job.loadState = p.second;
+            } else if (p.first == "save-state") {
+                job.saveState = p.second;
+            } else if (p.first == "flight-recorder") {
+                job.flightRecorder = p.second;
+            } else if (p.first == "coverage") {
+                job.coverage = p.second;
+            } else if (p.first == "coverage-summary") {
+                job.coverageSummary = p.second;
+            } else {
+                cerr << file << ":" << lineno << ": unknown key '" << p.first << "'" << endl;
+                return -EINVAL;
+            }
+        }
+
+        if (job.stopOn == "" && !job.maxInstructions && job.timeout <= 0) {
+            cerr << file << ":" << lineno << ": job needs stop-on, max-instructions or timeout" << endl;
+            return -EINVAL;
+        }
+
+        jobs.push_back(job);
+    }
+
+    return 0;
+}
+
+namespace {
+
+// a job while it's running, owns its own console and system
+struct Instance {
+    FarmJob *job;
+    unique_ptr<Coverage> coverage;
+    unique_ptr<HeadlessConsole> console;
+    unique_ptr<System> sys;
+    chrono::steady_clock::time_point start;
+};
+
+struct WorkQueue {
+    mutex lock;
+    deque<Instance *> queue;
+};
+
+class Farm {
+public:
+    Farm(vector<FarmJob> &jobs, unsigned int threads);
+
+    void Run();
+
+private:
+    void Worker(unsigned int index);
+    Instance *Take(unsigned int index);
+    int Start(Instance &inst);
+    bool RunSlice(Instance &inst);
+    void Finish(Instance *inst);
+
+    vector<Instance> mInstances;
+    vector<unique_ptr<WorkQueue>> mQueues;
+    atomic<size_t> mRemaining;
+
+    // jobs sitting in a queue, idle workers sleep until there's one or it's all over
+    atomic<size_t> mQueued;
+    mutex mIdleLock;
+    condition_variable mIdle;
+};
+
+Farm::Farm(vector<FarmJob> &jobs, unsigned int threads)
+    :   mInstances(jobs.size()),
+        mRemaining(jobs.size()),
+        mQueued(jobs.size()) {
+    for (unsigned int i = 0; i < threads; i++)
+        mQueues.emplace_back(new WorkQueue());
+
+    // deal the jobs out round robin, stealing evens out the rest
+    for (size_t i = 0; i < jobs.size(); i++) {
+        mInstances[i].job = &jobs[i];
+        mQueues[i % threads]->queue.push_back(&mInstances[i]);
+    }
+}
+
+void Farm::Run() {
+    vector<thread> workers;
+    for (unsigned int i = 0; i < mQueues.size(); i++)
+        workers.emplace_back(&Farm::Worker, this, i);
+    for (auto &t : workers)
+        t.join();
+}
+
+// own queue from the front, otherwise steal from the back of someone else's
+Instance *Farm::Take(unsigned int index) {
+    for (size_t n = 0; n < mQueues.size(); n++) {
+        WorkQueue &q = *mQueues[(index + n) % mQueues.size()];
+
+        lock_guard<mutex> lock(q.lock);
+        if (q.queue.empty())
+            continue;
+
+        Instance *inst;
+        if (n == 0) {
+            inst = q.queue.front();
+            q.queue.pop_front();
+        } else {
+            inst = q.queue.back();
+            q.queue.pop_back();
+        }
+        mQueued--;
+        return inst;
+    }
+
+    return nullptr;
+}
+
+void Farm::Worker(unsigned int index) {
+    Timeline::SetThreadName("farm worker " + to_string(index));
+
+    while (mRemaining > 0) {
+        Instance *inst = Take(index);
+        if (!inst) {
+            // everything left is being run by someone else right now, wait for
+            // one of them to go back in a queue or for the last one to finish
+            unique_lock<mutex> lock(mIdleLock);
+            mIdle.wait(lock, [this]() { return mQueued > 0 || mRemaining == 0; });
+            continue;
+        }
+
+        if (!inst->sys && Start(*inst) < 0) {
+            inst->job->status = 1;
+            Finish(inst);
+            continue;
+        }
+
+        if (RunSlice(*inst)) {
+            Finish(inst);
+        } else {
+            {
+                WorkQueue &q = *mQueues[index];
+                lock_guard<mutex> lock(q.lock);
+                q.queue.push_back(inst);
+                mQueued++;
+            }
+
+            lock_guard<mutex> lock(mIdleLock);
+            mIdle.notify_one();
+        }
+    }
+}
+
+int Farm::Start(Instance &inst) {
+    FarmJob &job = *inst.job;
+
+    inst.console.reset(new HeadlessConsole());
+    if (job.input != "" && inst.console->SetInput(job.input) < 0)
+        return -1;
+    if (job.output != "") {
+        if (inst.console->SetOutput(job.output) < 0)
+            return -1;
+    } else {
+        inst.console->DiscardOutput();
+    }
+
+    inst.sys = System::Factory(job.system, *inst.console);
+    if (!inst.sys) {
+        cerr << job.name << ": unknown system " << job.system << endl;
+        return -1;
+    }
+    if (job.cpu != "")
+        inst.sys->SetCpu(job.cpu);
+    if (job.rom != "")
+        inst.sys->SetRom(job.rom);
+
+    if (inst.sys->Init() < 0) {
+        cerr << job.name << ": error initializing system" << endl;
+        return -1;
+    }
+    if (job.loadState != "" && inst.sys->LoadSnapshot(job.loadState) < 0)
+        return -1;
+
+    inst.sys->SetStats(Stats::AddSlot(job.name, job.system));
+
+    // off unless the job names its own file, jobs sharing one would overwrite each other
+    inst.sys->GetCpu()->SetFlightRecorderFile(job.flightRecorder);
+
+    if (job.coverage != "" || job.coverageSummary != "") {
+        inst.coverage.reset(new Coverage());
+        inst.sys->GetCpu()->SetCoverage(inst.coverage.get());
+    }
+
+    inst.console->SetStopPattern(job.stopOn, inst.sys->GetCpu());
+    inst.start = chrono::steady_clock::now();
+
+    return 0;
+}
+
+// returns true once the job is over, with its status filled in
+bool Farm::RunSlice(Instance &inst) {
+    FarmJob &job = *inst.job;
+    Cpu *cpu = inst.sys->GetCpu();
+
+    uint64_t limit = cpu->GetInstructionCount() + kSliceInstructions;
+    if (job.maxInstructions && job.maxInstructions < limit)
+        limit = job.maxInstructions;
+    cpu->SetInstructionLimit(limit);
+
+    int err = cpu->Run();
+
+    job.instructions = cpu->GetInstructionCount();
+    job.seconds = chrono::duration<double>(chrono::steady_clock::now() - inst.start).count();
+
+    if (inst.console->PatternSeen()) {
+        job.status = HEADLESS_PATTERN;
+    } else if (err < 0) {
+        job.status = HEADLESS_CPU_STOPPED;
+    } else if (inst.sys->HasExited()) {
+        job.status = HEADLESS_EXITED;
+    } else if (job.maxInstructions && job.instructions >= job.maxInstructions) {
+        job.status = HEADLESS_LIMIT;
+    } else if (job.timeout > 0 && job.seconds >= job.timeout) {
+        job.status = HEADLESS_TIMEOUT;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+void Farm::Finish(Instance *inst) {
+    FarmJob &job = *inst->job;
+
+    if (inst->sys && job.saveState != "" && inst->sys->SaveSnapshot(job.saveState) < 0)
+        job.status = 1;
+
+    if (inst->coverage) {
+        SymbolTable syms;
+        syms.LoadForRom(job.rom);
+
+        if (job.coverage != "" && inst->coverage->WriteListing(job.coverage, syms) < 0)
+            job.status = 1;
+        if (job.coverageSummary != "" && inst->coverage->WriteSummary(job.coverageSummary, job.name, syms) < 0)
+            job.status = 1;
+    }
+
+    // tear down here, on the worker, so it happens in parallel too
+    inst->sys.reset();
+    inst->console.reset();
+    inst->coverage.reset();
+
+    if (--mRemaining == 0) {
+        lock_guard<mutex> lock(mIdleLock);
+        mIdle.notify_all();
+    }
+}
+
+} // namespace
+
+int RunFarm(vector<FarmJob> &jobs, unsigned int threads) {
+    if (threads == 0)
+        threads = max(1u, thread::hardware_concurrency());
+
+    auto start = chrono::steady_clock::now();
+
+    Farm farm(jobs, threads);
+    farm.Run();
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    uint64_t instructions = 0;
+    int status = 0;
+    for (auto &j : jobs) {
+        instructions += j.instructions;
+        status = max(status, j.status);
+    }
+
+    fprintf(stderr, "farm: %zu jobs on %u threads in %.3f seconds, %.1f million instructions/sec\n",
+            jobs.size(), threads, seconds, seconds > 0 ? instructions / seconds / 1000000.0 : 0.0);
+
+    return status;
+}
+
+int WriteFarmResults(const string &file, const vector<FarmJob> &jobs) {
+    FILE *fp = (file == "-") ? stdout : fopen(file.c_str(), "w");
+    if (!fp) {
+        cerr << "error opening farm results " << file << endl;
+        return -errno;
+    }
+
+    fprintf(fp, "# name status instructions seconds\n");
+    for (auto &j : jobs)
+        fprintf(fp, "%s %d %llu %.3f\n", j.name.c_str(), j.status, (unsigned long long)j.instructions, j.seconds);
+
+    if (fp != stdout)
+        fclose(fp);
+
+    return 0;
+}
@@ -0,0 +1,69 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One run in a farm, a line of the job manifest. Each line is a list of
+// key=value pairs, values may be double quoted and use \n \r \t escapes:
+//
+//   name=basic1 system=6809 rom=test/BASIC.HEX input=prog.bas stop-on="OK\r" timeout=10
+//
+// Keys are name, system, cpu, rom, input, output, stop-on, max-instructions,
+// timeout, load-state, save-state, flight-recorder, coverage and
+// coverage-summary, with the same meaning as the matching command line
+// options. The timeout counts from the job's first time slice.
+// max-instructions includes any instructions already in a loaded snapshot.
+struct FarmJob {
+    std::string name;
+    std::string system = "6809";
+    std::string cpu;
+    std::string rom;
+    std::string input;
+    std::string output;
+    std::string stopOn;
+    uint64_t maxInstructions = 0;
+    double timeout = 0;
+    std::string loadState;
+    std::string saveState;
+    std::string flightRecorder;
+    std::string coverage;
+    std::string coverageSummary;
+
+    // filled in by the run, status is one of the headless exit statuses
+    int status = -1;
+    uint64_t instructions = 0;
+    double seconds = 0;
+};
+
+int ParseFarmManifest(const std::string &file, std::vector<FarmJob> &jobs);
+
+// run every job, time sliced across a pool of worker threads. Returns the
+// highest job status, so 0 only if every job saw its stop pattern.
+int RunFarm(std::vector<FarmJob> &jobs, unsigned int threads);
+
+// one line per job, "-" for stdout
+int WriteFarmResults(const std::string &file, const std::vector<FarmJob> &jobs);
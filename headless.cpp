@@ -0,0 +1,207 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "headless.h"
+
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+#include "cpu/cpu.h"
+#include "debug/hostprofile.h"
+#include "debug/probes.h"
+#include "debug/stats.h"
+#include "debug/timeline.h"
+#include "system/system.h"
+
+using namespace std;
+
+HeadlessConsole::HeadlessConsole() {
+}
+
+HeadlessConsole::~HeadlessConsole() {
+    if (mInFd > 0)
+        close(mInFd);
+    if (mOut == stdout)
+        fflush(mOut);
+    else if (mOut)
+        fclose(mOut);
+}
+
+int HeadlessConsole::SetInput(const string &file) {
+    mInFd = (file == "-") ? 0 : open(file.c_str(), O_RDONLY);
+    if (mInFd < 0) {
+        cerr << "error opening input file " << file << endl;
+        return -errno;
+    }
+
+    // the guest polls, never block it
+    fcntl(mInFd, F_SETFL, fcntl(mInFd, F_GETFL) | O_NONBLOCK);
+
+    return 0;
+}
+
+void HeadlessConsole::SetInputData(const uint8_t *data, size_t len) {
+    mInBuffer = queue<char>();
+    for (size_t i = 0; i < len; i++)
+        mInBuffer.push(data[i]);
+}
+
+int HeadlessConsole::SetOutput(const string &file) {
+    if (file == "-")
+        return 0;
+
+    if (mOut && mOut != stdout)
+        fclose(mOut);
+
+    mOut = fopen(file.c_str(), "w");
+    if (!mOut) {
+        mOut = stdout;
+        cerr << "error opening output file " << file << endl;
+        return -errno;
+    }
+
+    return 0;
+}
+
+void HeadlessConsole::DiscardOutput() {
+    if (mOut && mOut != stdout)
+        fclose(mOut);
+    mOut = nullptr;
+}
+
+void HeadlessConsole::Putchar(char c) {
+    HostProfileScope prof(HostProfile::CONSOLE);
+
+    // nothing past the stop pattern, so the output doesn't depend on how fast we stop
+    if (mPatternSeen || IsMuted())
+        return;
+
+    if (mStats)
+        StatsAdd(mStats->consoleOut, 1);
+    EMU_PROBE1(console_output, (unsigned char)c);
+    if (Timeline::IsEnabled())
+        Timeline::Instant("output", "console", "char", (unsigned char)c);
+
+    if (mOut)
+        putc(c, mOut);
+
+    if (mPattern.empty())
+        return;
+
+    mTail.push_back(c);
+    if (mTail.size() > mPattern.size())
+        mTail.erase(0, mTail.size() - mPattern.size());
+    if (mTail == mPattern) {
+        mPatternSeen = true;
+        if (mOut)
+            fflush(mOut);
+
+        // we're on the cpu thread here, so it stops right after this instruction
+        if (mStopCpu)
+            mStopCpu->RequestStop();
+    }
+}
+
+// pull whatever is available without blocking. Guests tend to poll for
+// input in tight loops, so back off for a while if the pipe was empty.
+void HeadlessConsole::FillInput() {
+    if (mPollSkip > 0) {
+        mPollSkip--;
+        return;
+    }
+
+    char buf[4096];
+    ssize_t len = read(mInFd, buf, sizeof(buf));
+    if (len > 0) {
+        EMU_PROBE1(console_enqueue, len);
+        if (Timeline::IsEnabled())
+            Timeline::Instant("input arrived", "console", "bytes", len);
+        for (ssize_t i = 0; i < len; i++)
+            mInBuffer.push(buf[i]);
+    } else if (len == 0) {
+        // end of input, the guest just sees no more keys
+        if (mInFd > 0)
+            close(mInFd);
+        mInFd = -1;
+    } else {
+        mPollSkip = 1024;
+    }
+}
+
+int HeadlessConsole::ReadChar() {
+    if (mInBuffer.empty() && mInFd >= 0)
+        FillInput();
+
+    if (mInBuffer.empty())
+        return -1;
+
+    int c = (unsigned char)mInBuffer.front();
+    mInBuffer.pop();
+    return c;
+}
+
+int RunHeadless(System &sys, HeadlessConsole &con, double timeoutSeconds) {
+    auto start = chrono::steady_clock::now();
+
+    int status;
+    for (;;) {
+        if (con.PatternSeen()) {
+            status = HEADLESS_PATTERN;
+            break;
+        }
+        if (!sys.IsRunning()) {
+            if (sys.GetCpu()->InstructionLimitReached()) {
+                status = HEADLESS_LIMIT;
+            } else {
+                status = sys.HasExited() ? HEADLESS_EXITED : HEADLESS_CPU_STOPPED;
+            }
+            break;
+        }
+        if (timeoutSeconds > 0 &&
+            chrono::duration<double>(chrono::steady_clock::now() - start).count() >= timeoutSeconds) {
+            status = HEADLESS_TIMEOUT;
+            break;
+        }
+
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    sys.ShutdownThreaded();
+
+    const char *reason = "";
+    switch (status) {
+        case HEADLESS_PATTERN: reason = "stop pattern seen"; break;
+        case HEADLESS_LIMIT: reason = "instruction limit reached"; break;
+        case HEADLESS_TIMEOUT: reason = "timeout"; break;
+        case HEADLESS_CPU_STOPPED: reason = "cpu stopped"; break;
+        case HEADLESS_EXITED: reason = "guest exited"; break;
+    }
+    fprintf(stderr, "headless run ended: %s after %llu instructions\n",
+            reason, (unsigned long long)sys.GetCpu()->GetInstructionCount());
+
+    return status;
+}
@@ -0,0 +1,89 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <queue>
+#include <string>
+
+#include "console.h"
+
+class Cpu;
+class System;
+
+// console with no terminal behind it, for unattended batch runs. Input is
+// pulled from a file or pipe as the guest asks for it, output goes to a file.
+class HeadlessConsole : public Console {
+public:
+    HeadlessConsole();
+    virtual ~HeadlessConsole() override;
+
+    // "-" for stdin/stdout, output defaults to stdout
+    int SetInput(const std::string &file);
+
+    // replace any pending input with a buffer of bytes
+    void SetInputData(const uint8_t *data, size_t len);
+    int SetOutput(const std::string &file);
+
+    // stop the cpu once the guest has printed this
+    void SetStopPattern(const std::string &pattern, Cpu *cpu) { mPattern = pattern; mStopCpu = cpu; }
+    bool PatternSeen() const { return mPatternSeen; }
+
+    // drop guest output instead of writing it anywhere
+    void DiscardOutput();
+
+    virtual void Putchar(char c) override;
+
+protected:
+    virtual int ReadChar() override;
+
+private:
+    void FillInput();
+
+    int mInFd = -1;
+    std::queue<char> mInBuffer;
+    unsigned int mPollSkip = 0;
+
+    FILE *mOut = stdout;
+
+    std::string mPattern;
+    Cpu *mStopCpu = nullptr;
+    std::string mTail;
+    std::atomic<bool> mPatternSeen { false };
+};
+
+// process exit status of a headless run, by how it ended
+enum HeadlessStatus {
+    HEADLESS_PATTERN = 0,       // guest printed the stop pattern
+    HEADLESS_LIMIT = 2,         // hit the instruction limit
+    HEADLESS_TIMEOUT = 3,       // hit the wall clock timeout
+    HEADLESS_CPU_STOPPED = 4,   // cpu stopped on its own, unhandled opcode and the like
+    HEADLESS_EXITED = 5,        // guest program exited, CP/M warm boot and the like
+};
+
+// run an already started system until one of the stop conditions and shut
+// it down, a timeout of 0 means none. Returns one of the statuses above.
+int RunHeadless(System &sys, HeadlessConsole &con, double timeoutSeconds);
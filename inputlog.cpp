@@ -0,0 +1,101 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "inputlog.h"
+
+#include <cerrno>
+#include <iostream>
+
+#include "cpu/cpu.h"
+
+using namespace std;
+
+InputLog::InputLog() {
+}
+
+InputLog::~InputLog() {
+    if (mOut)
+        fclose(mOut);
+}
+
+int InputLog::OpenRecord(const string &file) {
+    mOut = fopen(file.c_str(), "w");
+    if (!mOut) {
+        cerr << "error creating input log " << file << endl;
+        return -errno;
+    }
+
+    fprintf(mOut, "# instruction byte\n");
+    return 0;
+}
+
+int InputLog::OpenReplay(const string &file) {
+    FILE *fp = fopen(file.c_str(), "r");
+    if (!fp) {
+        cerr << "error opening input log " << file << endl;
+        return -errno;
+    }
+
+    char line[128];
+    int lineNum = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        lineNum++;
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+
+        unsigned long long count;
+        unsigned int c;
+        if (sscanf(line, "%llu %x", &count, &c) != 2 || c > 0xff ||
+            (!mEntries.empty() && count < mEntries.back().count)) {
+            cerr << "input log " << file << ": bad entry at line " << lineNum << endl;
+            fclose(fp);
+            return -EINVAL;
+        }
+
+        mEntries.push_back({ count, (uint8_t)c });
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+void InputLog::Record(int c) {
+    if (!mOut)
+        return;
+
+    fprintf(mOut, "%llu %02x\n", (unsigned long long)mCpu->GetInstructionCount(), (unsigned int)(c & 0xff));
+
+    // cheap next to a keystroke, and the log survives the emulator being killed
+    fflush(mOut);
+}
+
+int InputLog::Next() {
+    if (mPos >= mEntries.size() || mEntries[mPos].count > mCpu->GetInstructionCount())
+        return -1;
+
+    int c = mEntries[mPos++].c;
+    if (mPos == mEntries.size())
+        fprintf(stderr, "input log replayed, switching to live input\n");
+
+    return c;
+}
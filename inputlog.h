@@ -0,0 +1,71 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class Cpu;
+
+// Console input tied to guest time, so a run can be reproduced exactly.
+//
+// Recording writes one line per byte handed to the guest, the instruction
+// count it was delivered at followed by the byte in hex. Replaying hands the
+// guest each byte the first time it asks for input at or after that count,
+// regardless of what the host is doing, then goes back to live input once
+// the log runs out. Instruction counts stand in for cycles.
+class InputLog {
+public:
+    InputLog();
+    ~InputLog();
+
+    // non copyable
+    InputLog(const InputLog &) = delete;
+    InputLog &operator=(const InputLog &) = delete;
+
+    int OpenRecord(const std::string &file);
+    int OpenReplay(const std::string &file);
+
+    // where the timestamps come from, set before the cpu starts running
+    void SetCpu(const Cpu *cpu) { mCpu = cpu; }
+
+    bool IsReplaying() const { return mPos < mEntries.size(); }
+
+    // cpu thread, from the console as the guest reads input
+    void Record(int c);
+    int Next();
+
+private:
+    struct Entry {
+        uint64_t count;
+        uint8_t c;
+    };
+
+    const Cpu *mCpu = nullptr;
+    FILE *mOut = nullptr;
+    std::vector<Entry> mEntries;
+    size_t mPos = 0;
+};
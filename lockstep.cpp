@@ -0,0 +1,323 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "lockstep.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cpu/cpu.h"
+#include "dev/memory.h"
+#include "headless.h"
+#include "system/snapshot.h"
+#include "system/system.h"
+
+using namespace std;
+
+namespace {
+
+// one copy of the machine
+struct Side {
+    const char *name;
+    unique_ptr<HeadlessConsole> console;
+    unique_ptr<System> sys;
+    Cpu *cpu = nullptr;
+    vector<SnapshotWriter::Bank> banks;
+    vector<System::DeviceWrite> deviceWrites;
+    bool stopped = false;
+
+    int Init(const LockstepConfig &config, Cpu::Engine engine, bool output);
+    void RunTo(uint64_t count);
+};
+
+int Side::Init(const LockstepConfig &config, Cpu::Engine engine, bool output) {
+    console.reset(new HeadlessConsole());
+    if (config.input != "" && console->SetInput(config.input) < 0)
+        return -1;
+    if (!output) {
+        console->DiscardOutput();
+    } else if (config.output != "" && console->SetOutput(config.output) < 0) {
+        return -1;
+    }
+
+    sys = System::Factory(config.system, *console);
+    if (!sys) {
+        cerr << "unknown system " << config.system << endl;
+        return -1;
+    }
+    if (config.cpu != "")
+        sys->SetCpu(config.cpu);
+    if (config.rom != "")
+        sys->SetRom(config.rom);
+
+    if (sys->Init() < 0) {
+        cerr << "error initializing " << name << " system" << endl;
+        return -1;
+    }
+    if (config.loadState != "" && sys->LoadSnapshot(config.loadState) < 0)
+        return -1;
+
+    cpu = sys->GetCpu();
+    cpu->SetEngine(engine);
+    sys->SetDeviceWriteLog(&deviceWrites);
+    cpu->SetFlightRecorderFile(string("lockstep-") + name + ".txt");
+
+    // the memory banks, to compare whatever gets written
+    SnapshotWriter w(cpu->GetName(), false);
+    sys->SaveSnapshot(w);
+    banks = w.GetBanks();
+    for (auto &b : banks)
+        b.mem->ClearDirty();
+
+    return 0;
+}
+
+void Side::RunTo(uint64_t count) {
+    if (stopped)
+        return;
+
+    cpu->SetInstructionLimit(count);
+    if (cpu->Run() < 0 || cpu->GetInstructionCount() < count)
+        stopped = true;
+}
+
+// runs one side a slice at a time, when told to
+class Worker {
+public:
+    explicit Worker(Side &side) : mSide(side), mThread(&Worker::Loop, this) {}
+    ~Worker() {
+        {
+            lock_guard<mutex> lck(mLock);
+            mQuit = true;
+        }
+        mCv.notify_all();
+        mThread.join();
+    }
+
+    void Start(uint64_t count) {
+        {
+            lock_guard<mutex> lck(mLock);
+            mTarget = count;
+            mBusy = true;
+        }
+        mCv.notify_all();
+    }
+
+    void Wait() {
+        unique_lock<mutex> lck(mLock);
+        mCv.wait(lck, [this]() { return !mBusy; });
+    }
+
+private:
+    void Loop() {
+        unique_lock<mutex> lck(mLock);
+        for (;;) {
+            mCv.wait(lck, [this]() { return mQuit || mBusy; });
+            if (mQuit)
+                return;
+
+            lck.unlock();
+            mSide.RunTo(mTarget);
+            lck.lock();
+
+            mBusy = false;
+            mCv.notify_all();
+        }
+    }
+
+    Side &mSide;
+    mutex mLock;
+    condition_variable mCv;
+    uint64_t mTarget = 0;
+    bool mBusy = false;
+    bool mQuit = false;
+    thread mThread;
+};
+
+// both records of the first instruction that differs, if it was the registers,
+// and the reference record before it
+void PrintDivergence(Side &ref, Side &fast, const FlightRecord *r, const FlightRecord *f,
+                     const FlightRecord *agreed) {
+    char line[256];
+
+    if (agreed) {
+        ref.cpu->FormatFlightRecord(*agreed, line, sizeof(line));
+        printf("  last agreed %s\n", line);
+    }
+    if (r && f) {
+        ref.cpu->FormatFlightRecord(*r, line, sizeof(line));
+        printf("  %-11s %s\n", ref.name, line);
+        fast.cpu->FormatFlightRecord(*f, line, sizeof(line));
+        printf("  %-11s %s\n", fast.name, line);
+    }
+
+    ref.cpu->DumpFlightRecorder("lockstep divergence");
+    fast.cpu->DumpFlightRecorder("lockstep divergence");
+}
+
+// record i of the last n instructions, i may be -1 for the one before if it's still there
+const FlightRecord *Recent(const Cpu *cpu, uint64_t n, int64_t i) {
+    const FlightRecorder &fr = cpu->GetFlightRecorder();
+    int64_t index = (int64_t)fr.Size() - (int64_t)n + i;
+    return (index >= 0) ? &fr.Get(index) : nullptr;
+}
+
+// compare what both sides did since count, true if they agree
+bool Compare(Side &ref, Side &fast, uint64_t count) {
+    uint64_t nr = ref.cpu->GetInstructionCount() - count;
+    uint64_t nf = fast.cpu->GetInstructionCount() - count;
+
+    // the records are taken before each instruction runs, so a difference shows
+    // up one instruction after the one that caused it
+    for (uint64_t i = 0; i < min(nr, nf); i++) {
+        const FlightRecord *r = Recent(ref.cpu, nr, i);
+        const FlightRecord *f = Recent(fast.cpu, nf, i);
+        if (r->pc != f->pc || r->opcode != f->opcode || memcmp(r->regs, f->regs, sizeof(r->regs)) != 0) {
+            printf("lockstep: registers diverge before instruction %u\n", r->count);
+            PrintDivergence(ref, fast, r, f, Recent(ref.cpu, nr, (int64_t)i - 1));
+            return false;
+        }
+    }
+
+    if (nr != nf) {
+        printf("lockstep: %s engine stopped at instruction %llu, %s engine at %llu\n",
+               ref.name, (unsigned long long)ref.cpu->GetInstructionCount(),
+               fast.name, (unsigned long long)fast.cpu->GetInstructionCount());
+        PrintDivergence(ref, fast, nullptr, nullptr, nullptr);
+        return false;
+    }
+
+    // device registers and io ports, output only the reference side gets to show
+    size_t nw = max(ref.deviceWrites.size(), fast.deviceWrites.size());
+    for (size_t i = 0; i < nw; i++) {
+        const System::DeviceWrite *r = (i < ref.deviceWrites.size()) ? &ref.deviceWrites[i] : nullptr;
+        const System::DeviceWrite *f = (i < fast.deviceWrites.size()) ? &fast.deviceWrites[i] : nullptr;
+        if (r && f && *r == *f)
+            continue;
+
+        printf("lockstep: device writes diverge\n");
+        for (auto &w : { make_pair(ref.name, r), make_pair(fast.name, f) }) {
+            if (w.second) {
+                printf("  %-11s instruction %llu %s %#x = %#02x\n", w.first,
+                       (unsigned long long)w.second->instruction, w.second->port ? "port" : "address",
+                       w.second->address, w.second->val);
+            } else {
+                printf("  %-11s no write\n", w.first);
+            }
+        }
+        PrintDivergence(ref, fast, nullptr, nullptr, nullptr);
+        return false;
+    }
+    ref.deviceWrites.clear();
+    fast.deviceWrites.clear();
+
+    // memory either side wrote to during the slice
+    for (size_t b = 0; b < ref.banks.size(); b++) {
+        Memory *rm = ref.banks[b].mem;
+        Memory *fm = fast.banks[b].mem;
+        const uint8_t *rp = (const uint8_t *)rm->GetPtr();
+        const uint8_t *fp = (const uint8_t *)fm->GetPtr();
+
+        for (size_t page = 0; page < rm->GetPageCount(); page++) {
+            if (!rm->IsDirty(page) && !fm->IsDirty(page))
+                continue;
+
+            size_t start = page << Memory::kPageShift;
+            size_t end = min(start + Memory::kPageSize, rm->GetSize());
+            for (size_t a = start; a < end; a++) {
+                if (rp[a] != fp[a]) {
+                    printf("lockstep: memory diverges by instruction %llu, %s offset %#zx: %s %#02x, %s %#02x\n",
+                           (unsigned long long)ref.cpu->GetInstructionCount(), ref.banks[b].name.c_str(), a,
+                           ref.name, rp[a], fast.name, fp[a]);
+                    PrintDivergence(ref, fast, nullptr, nullptr, nullptr);
+                    return false;
+                }
+            }
+        }
+
+        rm->ClearDirty();
+        fm->ClearDirty();
+    }
+
+    return true;
+}
+
+} // namespace
+
+int RunLockstep(const LockstepConfig &config) {
+    Side ref;
+    Side fast;
+    ref.name = "reference";
+    fast.name = "fast";
+
+    if (ref.Init(config, Cpu::Engine::REFERENCE, true) < 0 ||
+        fast.Init(config, Cpu::Engine::FAST, false) < 0)
+        return 1;
+
+    // same machine, same layout of banks
+    if (ref.banks.size() != fast.banks.size())
+        return 1;
+
+    uint64_t count = ref.cpu->GetInstructionCount();
+    uint64_t start = count;
+    uint64_t limit = config.maxInstructions ? config.maxInstructions : UINT64_MAX;
+
+    auto begin = chrono::steady_clock::now();
+    bool agree = true;
+    {
+        Worker refWorker(ref);
+        Worker fastWorker(fast);
+
+        // the slice is the flight recorder's length, so every instruction gets compared
+        while (count < limit && !ref.stopped && !fast.stopped) {
+            uint64_t target = min<uint64_t>(limit, count + FlightRecorder::kEntries);
+
+            refWorker.Start(target);
+            fastWorker.Start(target);
+            refWorker.Wait();
+            fastWorker.Wait();
+
+            agree = Compare(ref, fast, count);
+            if (!agree)
+                break;
+
+            count = ref.cpu->GetInstructionCount();
+        }
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    if (agree) {
+        printf("lockstep: %llu instructions, engines agree%s (%.0f instructions/sec)\n",
+               (unsigned long long)(count - start), ref.stopped ? ", both cpus stopped" : "",
+               (count - start) / secs);
+    }
+
+    return agree ? 0 : 1;
+}
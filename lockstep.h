@@ -0,0 +1,50 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Differential run of two copies of the same machine, one on the reference
+// engine and one on the fast engine, each on its own thread. Both run a slice
+// of instructions at a time, no more than the flight recorder holds, then the
+// registers recorded before every instruction of the slice, the writes to
+// device registers and io ports, and the memory pages either side wrote to
+// are compared. The first divergence stops the run
+// with both states printed and both flight recorders dumped.
+//
+// Input comes from a file, read by each copy as its guest asks for it, so both
+// see the same bytes at the same instruction. Output is from the reference copy.
+struct LockstepConfig {
+    std::string system = "6809";
+    std::string cpu;
+    std::string rom;
+    std::string input;
+    std::string output;
+    std::string loadState;
+    uint64_t maxInstructions = 0;   // 0 runs until a cpu stops
+};
+
+// 0 if the engines agreed the whole way, 1 on a divergence or setup error
+int RunLockstep(const LockstepConfig &config);
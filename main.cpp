@@ -23,19 +23,161 @@
  */
 #include <memory>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <unistd.h>
 #include <getopt.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <termios.h>
+#include <vector>
 
 #include "system/system09.h"
 #include "console.h"
+#include "conformance.h"
+#include "farm.h"
+#include "headless.h"
+#include "inputlog.h"
+#include "lockstep.h"
+#include "terminal.h"
+#include "cpu/cpu.h"
+#include "debug/callgraph.h"
+#include "debug/coverage.h"
+#include "debug/heatmap.h"
+#include "debug/hostprofile.h"
+#include "debug/profiler.h"
+#include "debug/rewind.h"
+#include "debug/stats.h"
+#include "debug/symbols.h"
+#include "debug/timeline.h"
+#include "debug/tracefile.h"
+#include "debug/tracelog.h"
 
 using namespace std;
 
+// long only options
+enum {
+    OPT_PROFILE = 0x100,
+    OPT_PROFILE_INTERVAL,
+    OPT_SYMBOLS,
+    OPT_CALLGRAPH,
+    OPT_COVERAGE,
+    OPT_COVERAGE_SUMMARY,
+    OPT_HEATMAP,
+    OPT_TRACE,
+    OPT_TRACE_PC,
+    OPT_TRACE_OPCODE,
+    OPT_TRACE_COUNT,
+    OPT_FLIGHT_RECORDER,
+    OPT_TRACE_FILE,
+    OPT_TRACE_LOG,
+    OPT_HEADLESS,
+    OPT_INPUT,
+    OPT_OUTPUT,
+    OPT_MAX_INSTRUCTIONS,
+    OPT_TIMEOUT,
+    OPT_STOP_ON,
+    OPT_FARM,
+    OPT_FARM_THREADS,
+    OPT_FARM_RESULTS,
+    OPT_SAVE_STATE,
+    OPT_LOAD_STATE,
+    OPT_REWIND,
+    OPT_REWIND_INTERVAL,
+    OPT_RECORD_INPUT,
+    OPT_REPLAY_INPUT,
+    OPT_LOCKSTEP,
+    OPT_CONFORMANCE,
+    OPT_HOST_PROFILE,
+    OPT_HOST_PROFILE_INTERVAL,
+    OPT_STATS,
+    OPT_TIMELINE,
+};
+
+// cpu that the signal handlers act on
+static Cpu *sSignalCpu;
+
+static void TraceSignal(int) {
+    if (sSignalCpu)
+        sSignalCpu->ToggleTrace();
+}
+
+static void FlightDumpSignal(int) {
+    if (sSignalCpu)
+        sSignalCpu->RequestFlightDump();
+}
+
+// live stats, and the host profile if it's on. With no single cpu to poke,
+// the next one of the farm's to drop out of its run loop prints them.
+static void ReportSignal(int) {
+    if (sSignalCpu) {
+        sSignalCpu->RequestReport();
+    } else {
+        Stats::RequestReport();
+        HostProfile::RequestReport();
+    }
+}
+
+static void UnpublishStats() {
+    Stats::Unpublish();
+}
+
+// where a crash dumps the flight recorder, --flight-recorder or one named for the pid
+static string sCrashFlightFile;
+
+// last gasp on a host crash, dump the flight recorder and die the normal way.
+// not async signal safe, but we're going down anyway.
+static void CrashSignal(int sig) {
+    signal(sig, SIG_DFL);
+
+    Cpu *cpu = sSignalCpu;
+    sSignalCpu = nullptr;
+    if (cpu)
+        cpu->DumpFlightRecorder(strsignal(sig), sCrashFlightFile.c_str());
+
+    // get out whatever trace is still queued, it leads up to the crash
+    TraceLog::Flush();
+
+    raise(sig);
+}
+
+// parse "lo-hi" or a single value, leaving hi alone if it's not specified
+static void ParseRange(const char *str, uint64_t &lo, uint64_t &hi) {
+    char *end;
+    lo = strtoull(str, &end, 0);
+    if (*end == '-')
+        hi = strtoull(end + 1, NULL, 0);
+}
+
 static void usage(char **argv) {
     fprintf(stderr, "usage: %s [-h] [-c/--cpu cpu type] [-s/--system system] [-r/--rom romfile]\n", argv[0]);
+    fprintf(stderr, "\t[--profile outfile] [--profile-interval instructions] [--symbols .map/.sym/.rst file]\n");
+    fprintf(stderr, "\t[--callgraph folded stack outfile]\n");
+    fprintf(stderr, "\t[--coverage annotated listing outfile] [--coverage-summary outfile] (executed\n");
+    fprintf(stderr, "\t instructions and branch directions, against the rom's .rst listing)\n");
+    fprintf(stderr, "\t[--trace] [--trace-pc lo-hi] [--trace-opcode op] [--trace-count start-end]\n");
+    fprintf(stderr, "\t[--flight-recorder outfile] [--trace-file binary trace outfile]\n");
+    fprintf(stderr, "\t[--trace-log outfile] (--trace and TRACEF output unformatted, for emu-trace --log)\n");
+    fprintf(stderr, "\t[--max-instructions count] [--load-state snapshot] [--save-state snapshot on exit]\n");
+    fprintf(stderr, "\t[--rewind [--rewind-interval instructions]] (ctrl-] then 'rewind -N' steps back N instructions)\n");
+    fprintf(stderr, "\t[--record-input log] [--replay-input log] (console input keyed to instruction counts)\n");
+    fprintf(stderr, "\t[--headless [--input file] [--output file] [--timeout seconds] [--stop-on string]]\n");
+    fprintf(stderr, "\t(SIGUSR2 toggles tracing, SIGQUIT dumps the flight recorder while running. Without\n");
+    fprintf(stderr, "\t --flight-recorder it's only written on a host crash, to emu-flight.<pid>.txt)\n");
+    fprintf(stderr, "\t[--host-profile [--host-profile-interval n]] (host time by emulator layer, timing\n");
+    fprintf(stderr, "\t one in n layer crossings, printed at exit or on SIGUSR1)\n");
+    fprintf(stderr, "\t[--timeline outfile] (chrome trace event json of run slices, console io, device\n");
+    fprintf(stderr, "\t and snapshot events, written at exit)\n");
+    fprintf(stderr, "\t[--heatmap outfile] (bus reads, writes and fetches per 256 byte page and per device,\n");
+    fprintf(stderr, "\t written at exit, SIGUSR1 prints it)\n");
+    fprintf(stderr, "\t[--stats] (live counters in /dev/shm/emu-stats.<pid> for emu-stat, SIGUSR1 prints them)\n");
+    fprintf(stderr, "\t[--farm job manifest [--farm-threads count] [--farm-results outfile]]\n");
+    fprintf(stderr, "\t[--lockstep] (reference and fast engines side by side, with -s -c -r --input --output\n");
+    fprintf(stderr, "\t --load-state --max-instructions, exits 1 on divergence)\n");
+    fprintf(stderr, "\t[--conformance reference trace] (check registers against a --trace-file or text log,\n");
+    fprintf(stderr, "\t with the same options as --lockstep, exits 1 on a mismatch)\n");
+    fprintf(stderr, "headless exit status: 0 stop string seen, 2 instruction limit, 3 timeout, 4 cpu stopped,\n");
+    fprintf(stderr, "\t5 guest exited\n");
 
     exit(1);
 }
@@ -44,6 +186,39 @@ int main(int argc, char **argv) {
     string romOption;
     string cpuOption;
     string systemOption = "6809";
+    string profileOption;
+    uint32_t profileInterval = 1000;
+    vector<string> symbolFiles;
+    string callGraphOption;
+    string coverageOption;
+    string coverageSummaryOption;
+    string heatmapOption;
+    bool traceOption = false;
+    TraceFilter traceFilter;
+    string flightRecorderOption;
+    string traceFileOption;
+    string traceLogOption;
+    bool headlessOption = false;
+    string inputOption;
+    string outputOption;
+    uint64_t maxInstructionsOption = 0;
+    double timeoutOption = 0;
+    string stopOnOption;
+    string farmOption;
+    unsigned int farmThreadsOption = 0;
+    string farmResultsOption = "-";
+    string saveStateOption;
+    string loadStateOption;
+    bool rewindOption = false;
+    uint64_t rewindIntervalOption = Rewind::kDefaultDeltaInterval;
+    string recordInputOption;
+    string replayInputOption;
+    bool lockstepOption = false;
+    string conformanceOption;
+    bool hostProfileOption = false;
+    uint32_t hostProfileInterval = 64;
+    bool statsOption = false;
+    string timelineOption;
 
     // read in any overriding configuration from the command line
     for (;;) {
@@ -55,6 +230,41 @@ int main(int argc, char **argv) {
             {"cpu", 1, 0, 'c'},
             {"rom", 1, 0, 'r'},
             {"system", 1, 0, 's'},
+            {"profile", 1, 0, OPT_PROFILE},
+            {"profile-interval", 1, 0, OPT_PROFILE_INTERVAL},
+            {"symbols", 1, 0, OPT_SYMBOLS},
+            {"callgraph", 1, 0, OPT_CALLGRAPH},
+            {"coverage", 1, 0, OPT_COVERAGE},
+            {"coverage-summary", 1, 0, OPT_COVERAGE_SUMMARY},
+            {"heatmap", 1, 0, OPT_HEATMAP},
+            {"trace", 0, 0, OPT_TRACE},
+            {"trace-pc", 1, 0, OPT_TRACE_PC},
+            {"trace-opcode", 1, 0, OPT_TRACE_OPCODE},
+            {"trace-count", 1, 0, OPT_TRACE_COUNT},
+            {"flight-recorder", 1, 0, OPT_FLIGHT_RECORDER},
+            {"trace-file", 1, 0, OPT_TRACE_FILE},
+            {"trace-log", 1, 0, OPT_TRACE_LOG},
+            {"headless", 0, 0, OPT_HEADLESS},
+            {"input", 1, 0, OPT_INPUT},
+            {"output", 1, 0, OPT_OUTPUT},
+            {"max-instructions", 1, 0, OPT_MAX_INSTRUCTIONS},
+            {"timeout", 1, 0, OPT_TIMEOUT},
+            {"stop-on", 1, 0, OPT_STOP_ON},
+            {"farm", 1, 0, OPT_FARM},
+            {"farm-threads", 1, 0, OPT_FARM_THREADS},
+            {"farm-results", 1, 0, OPT_FARM_RESULTS},
+            {"save-state", 1, 0, OPT_SAVE_STATE},
+            {"load-state", 1, 0, OPT_LOAD_STATE},
+            {"rewind", 0, 0, OPT_REWIND},
+            {"rewind-interval", 1, 0, OPT_REWIND_INTERVAL},
+            {"record-input", 1, 0, OPT_RECORD_INPUT},
+            {"replay-input", 1, 0, OPT_REPLAY_INPUT},
+            {"lockstep", 0, 0, OPT_LOCKSTEP},
+            {"conformance", 1, 0, OPT_CONFORMANCE},
+            {"host-profile", 0, 0, OPT_HOST_PROFILE},
+            {"host-profile-interval", 1, 0, OPT_HOST_PROFILE_INTERVAL},
+            {"stats", 0, 0, OPT_STATS},
+            {"timeline", 1, 0, OPT_TIMELINE},
             {0, 0, 0, 0},
         };
 
@@ -75,6 +285,115 @@ int main(int argc, char **argv) {
                 printf("system option: '%s'\n", optarg);
                 systemOption = optarg;
                 break;
+            case OPT_PROFILE:
+                profileOption = optarg;
+                break;
+            case OPT_PROFILE_INTERVAL:
+                profileInterval = strtoul(optarg, NULL, 0);
+                break;
+            case OPT_SYMBOLS:
+                symbolFiles.push_back(optarg);
+                break;
+            case OPT_CALLGRAPH:
+                callGraphOption = optarg;
+                break;
+            case OPT_COVERAGE:
+                coverageOption = optarg;
+                break;
+            case OPT_COVERAGE_SUMMARY:
+                coverageSummaryOption = optarg;
+                break;
+            case OPT_HEATMAP:
+                heatmapOption = optarg;
+                break;
+            case OPT_TRACE:
+                traceOption = true;
+                break;
+            case OPT_TRACE_PC: {
+                uint64_t lo, hi = 0xffffffff;
+                ParseRange(optarg, lo, hi);
+                traceFilter.pcLow = lo;
+                traceFilter.pcHigh = hi;
+                break;
+            }
+            case OPT_TRACE_OPCODE:
+                traceFilter.opcode = strtoul(optarg, NULL, 0) & 0xff;
+                break;
+            case OPT_TRACE_COUNT:
+                ParseRange(optarg, traceFilter.countStart, traceFilter.countEnd);
+                break;
+            case OPT_FLIGHT_RECORDER:
+                flightRecorderOption = optarg;
+                break;
+            case OPT_TRACE_FILE:
+                traceFileOption = optarg;
+                break;
+            case OPT_TRACE_LOG:
+                traceLogOption = optarg;
+                break;
+            case OPT_HEADLESS:
+                headlessOption = true;
+                break;
+            case OPT_INPUT:
+                inputOption = optarg;
+                break;
+            case OPT_OUTPUT:
+                outputOption = optarg;
+                break;
+            case OPT_MAX_INSTRUCTIONS:
+                maxInstructionsOption = strtoull(optarg, NULL, 0);
+                break;
+            case OPT_TIMEOUT:
+                timeoutOption = strtod(optarg, NULL);
+                break;
+            case OPT_STOP_ON:
+                stopOnOption = optarg;
+                break;
+            case OPT_FARM:
+                farmOption = optarg;
+                break;
+            case OPT_FARM_THREADS:
+                farmThreadsOption = strtoul(optarg, NULL, 0);
+                break;
+            case OPT_FARM_RESULTS:
+                farmResultsOption = optarg;
+                break;
+            case OPT_SAVE_STATE:
+                saveStateOption = optarg;
+                break;
+            case OPT_LOAD_STATE:
+                loadStateOption = optarg;
+                break;
+            case OPT_REWIND:
+                rewindOption = true;
+                break;
+            case OPT_REWIND_INTERVAL:
+                rewindIntervalOption = strtoull(optarg, NULL, 0);
+                break;
+            case OPT_RECORD_INPUT:
+                recordInputOption = optarg;
+                break;
+            case OPT_REPLAY_INPUT:
+                replayInputOption = optarg;
+                break;
+            case OPT_LOCKSTEP:
+                lockstepOption = true;
+                break;
+            case OPT_CONFORMANCE:
+                conformanceOption = optarg;
+                break;
+            case OPT_HOST_PROFILE:
+                hostProfileOption = true;
+                break;
+            case OPT_HOST_PROFILE_INTERVAL:
+                hostProfileInterval = strtoul(optarg, NULL, 0);
+                break;
+            case OPT_STATS:
+                statsOption = true;
+                break;
+            case OPT_TIMELINE:
+                timelineOption = optarg;
+                break;
             case 'h':
             default:
                 usage(argv);
@@ -82,10 +401,88 @@ int main(int argc, char **argv) {
         }
     }
 
-    // create a console object to pass to the system
-    Console console;
+    // where the host's time goes, for every mode below
+    if (hostProfileOption)
+        HostProfile::Enable(hostProfileInterval);
+    if (timelineOption != "") {
+        Timeline::Enable();
+        Timeline::SetThreadName("main");
+    }
+
+    // live counters are always kept, this makes them visible outside the process
+    if (statsOption) {
+        if (Stats::Publish() < 0)
+            return 1;
+        atexit(&UnpublishStats);
+    }
+    signal(SIGUSR1, &ReportSignal);
+
+    // --trace text unformatted to a file, emu-trace --log formats it later
+    if (traceLogOption != "" && TraceLog::SetRawFile(traceLogOption) < 0)
+        return 1;
+
+    // many headless runs from a manifest, each with its own system and console
+    if (farmOption != "") {
+        vector<FarmJob> jobs;
+        if (ParseFarmManifest(farmOption, jobs) < 0)
+            return 1;
+
+        int status = RunFarm(jobs, farmThreadsOption);
+        HostProfile::Report(stderr);
+        Timeline::Write(timelineOption);
+        if (WriteFarmResults(farmResultsOption, jobs) < 0)
+            return 1;
+
+        return status;
+    }
+
+    // two copies of the system on different engines, checked against each other
+    if (lockstepOption) {
+        LockstepConfig config;
+        config.system = systemOption;
+        config.cpu = cpuOption;
+        config.rom = romOption;
+        config.input = inputOption;
+        config.output = outputOption;
+        config.loadState = loadStateOption;
+        config.maxInstructions = maxInstructionsOption;
+
+        return RunLockstep(config);
+    }
+
+    // one system, checked against a recorded reference
+    if (conformanceOption != "") {
+        ConformanceConfig config;
+        config.system = systemOption;
+        config.cpu = cpuOption;
+        config.rom = romOption;
+        config.input = inputOption;
+        config.output = outputOption;
+        config.loadState = loadStateOption;
+        config.reference = conformanceOption;
+        config.maxInstructions = maxInstructionsOption;
 
-    auto sys = System::Factory(systemOption, console);
+        return RunConformance(config);
+    }
+
+    // create a console object to pass to the system, headless runs leave the terminal alone
+    unique_ptr<Console> console;
+    HeadlessConsole *headless = nullptr;
+    TerminalConsole *terminal = nullptr;
+    if (headlessOption) {
+        headless = new HeadlessConsole();
+        console.reset(headless);
+
+        if (inputOption != "" && headless->SetInput(inputOption) < 0)
+            return 1;
+        if (outputOption != "" && headless->SetOutput(outputOption) < 0)
+            return 1;
+    } else {
+        terminal = new TerminalConsole();
+        console.reset(terminal);
+    }
+
+    auto sys = System::Factory(systemOption, *console);
     if (!sys) {
         fprintf(stderr, "error creating system, aborting\n");
         return 1;
@@ -103,18 +500,192 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    // pick up where a previous run left off
+    if (loadStateOption != "" && sys->LoadSnapshot(loadStateOption) < 0) {
+        fprintf(stderr, "error loading snapshot, aborting\n");
+        return 1;
+    }
+
+    // named for the rom, there's only the one
+    string statsName = romOption.substr(romOption.find_last_of('/') + 1);
+    sys->SetStats(Stats::AddSlot(statsName != "" ? statsName : systemOption, systemOption));
+
+    // optional guest profiler
+    unique_ptr<Profiler> profiler;
+    if (profileOption != "") {
+        profiler.reset(new Profiler(profileInterval));
+        sys->GetCpu()->SetProfiler(profiler.get());
+    }
+
+    // optional call stack tracking
+    unique_ptr<CallGraph> callGraph;
+    if (callGraphOption != "") {
+        callGraph.reset(new CallGraph());
+        sys->GetCpu()->SetCallGraph(callGraph.get());
+    }
+
+    // optional code coverage
+    unique_ptr<Coverage> coverage;
+    if (coverageOption != "" || coverageSummaryOption != "") {
+        coverage.reset(new Coverage());
+        sys->GetCpu()->SetCoverage(coverage.get());
+    }
+
+    // optional bus traffic counts
+    unique_ptr<Heatmap> heatmap;
+    if (heatmapOption != "") {
+        heatmap.reset(new Heatmap());
+        sys->SetHeatmap(heatmap.get());
+    }
+
+    // full binary execution trace, decoded offline by emu-trace
+    unique_ptr<TraceWriter> traceWriter;
+    if (traceFileOption != "") {
+        traceWriter.reset(new TraceWriter(*sys));
+        if (traceWriter->Open(traceFileOption, sys->GetCpu()->GetName()) < 0) {
+            fprintf(stderr, "error opening trace file, aborting\n");
+            return 1;
+        }
+        sys->GetCpu()->SetTraceWriter(traceWriter.get());
+        sys->SetTraceWriter(traceWriter.get());
+    }
+
+    // deterministic input, either logging what the guest reads or feeding it an old log
+    unique_ptr<InputLog> inputLog;
+    if (recordInputOption != "" || replayInputOption != "") {
+        if (recordInputOption != "" && replayInputOption != "") {
+            fprintf(stderr, "can't record and replay input at the same time\n");
+            return 1;
+        }
+
+        inputLog.reset(new InputLog());
+        int err = (replayInputOption != "") ? inputLog->OpenReplay(replayInputOption)
+                                            : inputLog->OpenRecord(recordInputOption);
+        if (err < 0)
+            return 1;
+
+        inputLog->SetCpu(sys->GetCpu());
+        console->SetInputLog(inputLog.get());
+    }
+
+    // keep a window of recent history to step back into
+    unique_ptr<Rewind> rewind;
+    if (rewindOption) {
+        rewind.reset(new Rewind(*sys, *console, rewindIntervalOption));
+        sys->GetCpu()->SetRewind(rewind.get());
+        if (terminal) {
+            terminal->SetCommandHandler([&rewind](const string &line) {
+                if (!rewind->Command(line))
+                    printf("unknown command '%s'\n", line.c_str());
+            });
+        }
+    }
+
+    // instruction tracing, from the start or toggled later by signal
+    sSignalCpu = sys->GetCpu();
+    sSignalCpu->SetTraceFilter(traceFilter);
+    if (traceOption)
+        sSignalCpu->SetTrace(true);
+    signal(SIGUSR2, &TraceSignal);
+
+    // the flight recorder is always running, dump it on request or on the way down
+    sSignalCpu->SetFlightRecorderFile(flightRecorderOption);
+    sCrashFlightFile = flightRecorderOption;
+    if (sCrashFlightFile == "")
+        sCrashFlightFile = "emu-flight." + to_string(getpid()) + ".txt";
+    signal(SIGQUIT, &FlightDumpSignal);
+    signal(SIGABRT, &CrashSignal);
+    signal(SIGSEGV, &CrashSignal);
+    signal(SIGBUS, &CrashSignal);
+    signal(SIGFPE, &CrashSignal);
+
+    if (maxInstructionsOption)
+        sSignalCpu->SetInstructionLimit(maxInstructionsOption);
+    if (headless)
+        headless->SetStopPattern(stopOnOption, sSignalCpu);
+
     // start system thread
     sys->RunThreaded();
 
-    // enter the main console run loop
-    console.Run();
+    // enter the main console run loop, or wait for the headless run to end
+    int status = 0;
+    if (headless) {
+        status = RunHeadless(*sys, *headless, timeoutOption);
+    } else {
+        terminal->Run();
+    }
 
     printf("exiting run\n");
 
     sys->ShutdownThreaded();
+    sSignalCpu = nullptr;
 
     printf("main system thread stopped\n");
 
-    return 0;
+    HostProfile::Report(stderr);
+    Timeline::Write(timelineOption);
+
+    if (heatmap && heatmap->WriteReport(heatmapOption) >= 0)
+        printf("wrote memory heatmap to %s\n", heatmapOption.c_str());
+
+    if (saveStateOption != "") {
+        if (sys->SaveSnapshot(saveStateOption) < 0) {
+            status = 1;
+        } else {
+            printf("saved snapshot to %s\n", saveStateOption.c_str());
+        }
+    }
+
+    SymbolTable syms;
+    if (profiler || callGraph || coverage) {
+        for (auto &f : symbolFiles)
+            syms.Load(f);
+        if (symbolFiles.empty())
+            syms.LoadForRom(sys->GetRom());
+    }
+
+    if (profiler) {
+        if (profiler->WriteReport(profileOption, syms) < 0) {
+            status = 1;
+        } else {
+            printf("wrote %llu profile samples to %s\n",
+                   (unsigned long long)profiler->GetSamples(), profileOption.c_str());
+        }
+    }
+
+    if (callGraph) {
+        if (callGraph->WriteFolded(callGraphOption, syms) < 0) {
+            status = 1;
+        } else {
+            printf("wrote call graph to %s, %llu unmatched calls/returns\n",
+                   callGraphOption.c_str(), (unsigned long long)callGraph->GetMismatches());
+        }
+    }
+
+    if (coverage) {
+        int err = 0;
+        if (coverageOption != "" && coverage->WriteListing(coverageOption, syms) < 0)
+            err = -1;
+        if (coverageSummaryOption != "" &&
+            coverage->WriteSummary(coverageSummaryOption, statsName != "" ? statsName : systemOption, syms) < 0)
+            err = -1;
+
+        if (err < 0) {
+            fprintf(stderr, "error writing coverage\n");
+            status = 1;
+        } else {
+            printf("%zu addresses executed, coverage written to %s\n", coverage->GetExecuted(),
+                   coverageOption != "" ? coverageOption.c_str() : coverageSummaryOption.c_str());
+        }
+    }
+
+    if (traceWriter) {
+        traceWriter->Close();
+        printf("wrote %llu instructions to %s, %zu bytes\n",
+               (unsigned long long)traceWriter->GetInstructions(), traceFileOption.c_str(),
+               traceWriter->GetBytes());
+    }
+
+    return status;
 }
 
@@ -24,13 +24,21 @@
 
 #include "altair680.h"
 
+#include <cerrno>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 
 #include "cpu/cpu6800.h"
+#include "debug/heatmap.h"
+#include "debug/hostprofile.h"
+#include "debug/probes.h"
+#include "debug/stats.h"
+#include "debug/tracefile.h"
 #include "dev/memory.h"
 #include "dev/mc6850.h"
-#include "ihex.h"
+#include "system/romimage.h"
+#include "system/snapshot.h"
 
 #define DEFAULT_ROM "mits680b.bin"
 
@@ -57,6 +65,8 @@ void Altair680::iHexParseCallback(const uint8_t *ptr, size_t address, size_t len
 }
 
 int Altair680::Init() {
+    EMU_PROBE2(system_init, this, mRomString.c_str());
+
     cout << "initializing an Altair 680..." << endl;
     cout << "rom is " << mRomString << endl;
 
@@ -76,19 +86,17 @@ int Altair680::Init() {
     mRom_vtl.reset(rom_vtl);
 
     // read the prom directly from file
-    FILE *fp = fopen(mRomString.c_str(), "rb");
-    if (!fp) {
-        cerr << "Error opening rom file " << mRomString << endl;
-        return -errno;
-    }
+    auto rom = RomImage::LoadBinary(mRomString);
+    if (!rom)
+        return -ENOENT;
 
-    if (fread(rommem->GetPtr(), 256, 1, fp) != 1) {
-        fclose(fp);
+    const auto &data = rom->GetChunks()[0].data;
+    if (data.size() < 256) {
         cerr << "Error reading from rom file " << mRomString << endl;
-        return -errno;
+        return -EIO;
     }
 
-    fclose(fp);
+    memcpy(rommem->GetPtr(), data.data(), 256);
 
     // create a 6800 based cpu
     mCpu.reset(new Cpu6800(*this));
@@ -107,10 +115,54 @@ int Altair680::Run() {
     return mCpu->Run();
 }
 
+void Altair680::SaveState(SnapshotWriter &w) const {
+    mCpu->SaveState(w);
+    mMem->SaveState(w, "ram");
+    mRom_monitor->SaveState(w, "rom.monitor");
+    mRom_vtl->SaveState(w, "rom.vtl");
+    mUart->SaveState(w, "uart");
+}
+
+int Altair680::LoadState(SnapshotReader &r) {
+    int err = mCpu->LoadState(r);
+    if (err >= 0)
+        err = mMem->LoadState(r, "ram");
+    if (err >= 0)
+        err = mRom_monitor->LoadState(r, "rom.monitor");
+    if (err >= 0)
+        err = mRom_vtl->LoadState(r, "rom.vtl");
+    if (err >= 0)
+        err = mUart->LoadState(r, "uart");
+
+    return err;
+}
+
+Cpu *Altair680::GetCpu() {
+    return mCpu.get();
+}
+
+void Altair680::SetStats(StatsSlot *slot) {
+    System::SetStats(slot);
+    mUart->SetStats(Stats::AddDevice(slot, "mc6850"));
+}
+
+void Altair680::SetHeatmap(Heatmap *h) {
+    System::SetHeatmap(h);
+    h->AddDevice(mMem.get(), "ram", false);
+    h->AddDevice(mRom_vtl.get(), "vtl rom", false);
+    h->AddDevice(mRom_monitor.get(), "monitor rom", false);
+    h->AddDevice(mUart.get(), "mc6850", true);
+}
+
 uint8_t Altair680::MemRead8(size_t address) {
+    HostProfileScope prof(HostProfile::BUS);
+
     uint8_t val = 0;
 
+    size_t bus = address;
     MemoryDevice *mem = GetDeviceAtAddr(address);
+    if (mHeatmap)
+        mHeatmap->Read(bus, mem);
     if (mem)
         val = mem->ReadByte(address);
 
@@ -119,15 +171,33 @@ uint8_t Altair680::MemRead8(size_t address) {
 }
 
 void Altair680::MemWrite8(size_t address, uint8_t val) {
+    HostProfileScope prof(HostProfile::BUS);
+
     address &= 0xffff;
 
+    if (mTraceWriter)
+        mTraceWriter->Write(address, val);
+
+    size_t bus = address;
     MemoryDevice *mem = GetDeviceAtAddr(address);
+    if (mHeatmap)
+        mHeatmap->Write(bus, mem);
+    if (mem == mUart.get())
+        LogDeviceWrite(bus, val, false);
     if (mem)
         mem->WriteByte(address, val);
 
     //cout << "\tMemWrite8 at 0x" << hex << address << " val " << (unsigned int)val << endl;
 }
 
+uint8_t Altair680::MemPeek8(size_t address) {
+    MemoryDevice *mem = GetDeviceAtAddr(address);
+    if (mem)
+        return mem->PeekByte(address);
+
+    return 0;
+}
+
 MemoryDevice *Altair680::GetDeviceAtAddr(size_t &address) {
     address &= 0xffff;
 
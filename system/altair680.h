@@ -42,8 +42,18 @@ public:
 
     virtual int Run() override;
 
+    virtual Cpu *GetCpu() override;
+
+    virtual void SetStats(StatsSlot *slot) override;
+    virtual void SetHeatmap(Heatmap *h) override;
+
     virtual uint8_t  MemRead8(size_t address) override;
     virtual void     MemWrite8(size_t address, uint8_t val) override;
+    virtual uint8_t  MemPeek8(size_t address) override;
+
+protected:
+    virtual void SaveState(SnapshotWriter &w) const override;
+    virtual int LoadState(SnapshotReader &r) override;
 
 private:
     void iHexParseCallback(const uint8_t *ptr, size_t offset, size_t len);
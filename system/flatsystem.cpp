@@ -0,0 +1,161 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "flatsystem.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "cpu/cpu6800.h"
+#include "cpu/cpu6809.h"
+#include "cpu/cpuz80.h"
+#include "debug/heatmap.h"
+#include "debug/hostprofile.h"
+#include "debug/probes.h"
+#include "debug/tracefile.h"
+#include "dev/memory.h"
+#include "system/romimage.h"
+#include "system/snapshot.h"
+#include "trace.h"
+
+#define LOCAL_TRACE 0
+
+using namespace std;
+
+FlatSystem::FlatSystem(const std::string &subsystem, Console &con)
+    :   System(subsystem, con) {
+    mCpuString = "6809";
+}
+
+FlatSystem::~FlatSystem() {
+}
+
+std::unique_ptr<FlatSystem> FlatSystem::Create(const std::string &cpu, Console &con,
+                                               const void *image, size_t len, uint32_t address) {
+    std::unique_ptr<FlatSystem> sys(new FlatSystem("", con));
+    sys->SetCpu(cpu);
+    if (sys->Init() < 0)
+        return nullptr;
+
+    sys->Load(image, len, address);
+    return sys;
+}
+
+int FlatSystem::Init() {
+    EMU_PROBE2(system_init, this, mRomString.c_str());
+
+    if (mCpuString == "6809") {
+        mCpu.reset(new Cpu6809(*this));
+    } else if (mCpuString == "6800") {
+        mCpu.reset(new Cpu6800(*this));
+    } else if (mCpuString == "z80") {
+        mCpu.reset(new CpuZ80(*this));
+    } else {
+        cerr << "flat system: unknown cpu '" << mCpuString << "'" << endl;
+        return -1;
+    }
+    mCpu->Reset();
+
+    mMem.reset(new Memory());
+    mMem->Alloc(64*1024);
+
+    if (mRomString != "") {
+        auto rom = RomImage::LoadBinary(mRomString);
+        if (!rom)
+            return -1;
+
+        const auto &data = rom->GetChunks()[0].data;
+        Load(data.data(), data.size(), 0);
+    }
+
+    return 0;
+}
+
+int FlatSystem::Run() {
+    return mCpu->Run();
+}
+
+Cpu *FlatSystem::GetCpu() {
+    return mCpu.get();
+}
+
+void FlatSystem::SetHeatmap(Heatmap *h) {
+    System::SetHeatmap(h);
+    h->AddDevice(mMem.get(), "ram", false);
+}
+
+void FlatSystem::Load(const void *data, size_t len, uint32_t address) {
+    const uint8_t *src = (const uint8_t *)data;
+    uint8_t *ram = GetRam();
+
+    for (size_t i = 0; i < len; i++)
+        ram[(address + i) & 0xffff] = src[i];
+}
+
+uint8_t *FlatSystem::GetRam() {
+    return (uint8_t *)mMem->GetPtr();
+}
+
+void FlatSystem::SaveState(SnapshotWriter &w) const {
+    mCpu->SaveState(w);
+    mMem->SaveState(w, "ram");
+}
+
+int FlatSystem::LoadState(SnapshotReader &r) {
+    int err = mCpu->LoadState(r);
+    if (err >= 0)
+        err = mMem->LoadState(r, "ram");
+
+    return err;
+}
+
+uint8_t FlatSystem::MemRead8(size_t address) {
+    HostProfileScope prof(HostProfile::BUS);
+
+    if (mHeatmap)
+        mHeatmap->Read(address & 0xffff, mMem.get());
+
+    return mMem->ReadByte(address & 0xffff);
+}
+
+void FlatSystem::MemWrite8(size_t address, uint8_t val) {
+    HostProfileScope prof(HostProfile::BUS);
+
+    address &= 0xffff;
+
+    LTRACEF("addr 0x%zx val 0x%x\n", address, val);
+
+    if (mTraceWriter)
+        mTraceWriter->Write(address, val);
+    if (mLogWrites)
+        mWriteLog.push_back({ mCpu->GetInstructionCount(), (uint16_t)address, val });
+
+    if (mHeatmap)
+        mHeatmap->Write(address, mMem.get());
+
+    mMem->WriteByte(address, val);
+}
+
+uint8_t FlatSystem::MemPeek8(size_t address) {
+    return mMem->PeekByte(address & 0xffff);
+}
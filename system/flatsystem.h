@@ -0,0 +1,89 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "system.h"
+
+class Console;
+class Memory;
+
+// Any of the cpu cores on 64K of flat ram, with no devices and no rom files.
+// For running a core on its own from tools and tests, built from a buffer
+// instead of a machine's memory map. Optionally logs every write, to check
+// what a piece of code did to memory.
+class FlatSystem final : public System {
+public:
+    FlatSystem(const std::string &subsystem, Console &con);
+    virtual ~FlatSystem() override;
+
+    // a system running cpu with image copied in at address, the cpu reset and
+    // ready to Run(). Null if the cpu isn't one we know.
+    static std::unique_ptr<FlatSystem> Create(const std::string &cpu, Console &con,
+                                              const void *image, size_t len, uint32_t address = 0);
+
+    // the cpu comes from SetCpu(), 6809 by default. A rom file is loaded as a
+    // raw binary at address 0.
+    virtual int Init() override;
+
+    virtual int Run() override;
+
+    virtual Cpu *GetCpu() override;
+
+    virtual void SetHeatmap(Heatmap *h) override;
+
+    virtual uint8_t  MemRead8(size_t address) override;
+    virtual void     MemWrite8(size_t address, uint8_t val) override;
+    virtual uint8_t  MemPeek8(size_t address) override;
+
+    // copy into ram at address, wrapping around at the top
+    void Load(const void *data, size_t len, uint32_t address);
+
+    // all 64K, valid after Init()
+    uint8_t *GetRam();
+
+    // every guest write, in order, while enabled
+    struct WriteRecord {
+        uint64_t instruction;
+        uint16_t address;
+        uint8_t val;
+    };
+    void SetWriteLog(bool enable) { mLogWrites = enable; }
+    const std::vector<WriteRecord> &GetWriteLog() const { return mWriteLog; }
+    void ClearWriteLog() { mWriteLog.clear(); }
+
+protected:
+    virtual void SaveState(SnapshotWriter &w) const override;
+    virtual int LoadState(SnapshotReader &r) override;
+
+private:
+    std::unique_ptr<Cpu> mCpu;
+    std::unique_ptr<Memory> mMem;
+
+    bool mLogWrites = false;
+    std::vector<WriteRecord> mWriteLog;
+};
@@ -0,0 +1,87 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "romimage.h"
+
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+#include "ihex.h"
+
+using namespace std;
+
+shared_ptr<const RomImage> RomImage::LoadBinary(const string &file) {
+    return Load(file, false);
+}
+
+shared_ptr<const RomImage> RomImage::LoadHex(const string &file) {
+    return Load(file, true);
+}
+
+shared_ptr<const RomImage> RomImage::Load(const string &file, bool hex) {
+    static mutex cacheLock;
+    static map<pair<string, bool>, shared_ptr<const RomImage>> cache;
+
+    lock_guard<mutex> lock(cacheLock);
+
+    auto key = make_pair(file, hex);
+    auto it = cache.find(key);
+    if (it != cache.end())
+        return it->second;
+
+    shared_ptr<RomImage> image(new RomImage());
+
+    if (hex) {
+        // use the ihex library to parse the rom file
+        iHex parser;
+        parser.SetCallback(
+        [&image](const uint8_t *ptr, size_t offset, size_t len) {
+            image->mChunks.push_back(Chunk{ offset, vector<uint8_t>(ptr, ptr + len) });
+        }
+        );
+
+        parser.Open(file);
+        parser.Parse();
+    } else {
+        FILE *fp = fopen(file.c_str(), "rb");
+        if (!fp) {
+            cerr << "Error opening rom file " << file << endl;
+            return nullptr;
+        }
+
+        Chunk c { 0, {} };
+        uint8_t buf[4096];
+        size_t len;
+        while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+            c.data.insert(c.data.end(), buf, buf + len);
+        fclose(fp);
+
+        image->mChunks.push_back(move(c));
+    }
+
+    cache[key] = image;
+
+    return image;
+}
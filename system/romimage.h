@@ -0,0 +1,53 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A rom file, read and parsed once per process and then shared read only
+// between every system instance that uses it. Systems copy the pieces they
+// need into their own memory, so this only saves the file io and parsing.
+class RomImage {
+public:
+    struct Chunk {
+        size_t address;
+        std::vector<uint8_t> data;
+    };
+
+    // raw binary file, a single chunk at address 0
+    static std::shared_ptr<const RomImage> LoadBinary(const std::string &file);
+
+    // intel hex file, one chunk per record
+    static std::shared_ptr<const RomImage> LoadHex(const std::string &file);
+
+    const std::vector<Chunk> &GetChunks() const { return mChunks; }
+
+private:
+    static std::shared_ptr<const RomImage> Load(const std::string &file, bool hex);
+
+    std::vector<Chunk> mChunks;
+};
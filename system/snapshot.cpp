@@ -0,0 +1,296 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "snapshot.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+
+#include "dev/memory.h"
+
+using namespace std;
+
+static const char kSnapshotMagic[8] = { 'E', 'M', 'U', 'S', 'N', 'A', 'P', 0 };
+static const uint32_t kSnapshotVersion = 1;
+
+SnapshotWriter::SnapshotWriter(const char *cpu, bool withMemory)
+    :   mCpu(cpu),
+        mWithMemory(withMemory) {
+}
+
+void SnapshotWriter::AddSection(const string &name, const void *data, size_t len) {
+    Pending p { name, vector<uint8_t>((const uint8_t *)data, (const uint8_t *)data + len), nullptr, len, false };
+    mSections.push_back(move(p));
+}
+
+void SnapshotWriter::AddMemory(const string &name, Memory &mem) {
+    mBanks.push_back({ name, &mem });
+    if (!mWithMemory)
+        return;
+
+    Pending p { name, {}, (const uint8_t *)mem.GetPtr(), mem.GetSize(), true };
+    mSections.push_back(move(p));
+}
+
+static size_t Align(size_t val, size_t a) {
+    return (val + a - 1) & ~(a - 1);
+}
+
+vector<SnapshotSection> SnapshotWriter::Layout(size_t pageSize, size_t &end) const {
+    vector<SnapshotSection> toc(mSections.size());
+    size_t offset = sizeof(SnapshotHeader) + toc.size() * sizeof(SnapshotSection);
+    for (size_t i = 0; i < mSections.size(); i++) {
+        auto &p = mSections[i];
+
+        memset(&toc[i], 0, sizeof(toc[i]));
+        strncpy(toc[i].name, p.name.c_str(), sizeof(toc[i].name) - 1);
+        offset = Align(offset, p.pageAligned ? pageSize : 8);
+        toc[i].offset = offset;
+        toc[i].length = p.len;
+        offset += p.len;
+    }
+
+    end = offset;
+    return toc;
+}
+
+static SnapshotHeader MakeHeader(const string &cpu, size_t sections) {
+    SnapshotHeader h = {};
+    memcpy(h.magic, kSnapshotMagic, sizeof(h.magic));
+    h.version = kSnapshotVersion;
+    h.sectionCount = sections;
+    strncpy(h.cpu, cpu.c_str(), sizeof(h.cpu) - 1);
+    return h;
+}
+
+void SnapshotWriter::Write(vector<uint8_t> &buf) {
+    size_t end;
+    vector<SnapshotSection> toc = Layout(8, end);
+
+    buf.assign(end, 0);
+
+    SnapshotHeader h = MakeHeader(mCpu, toc.size());
+    memcpy(buf.data(), &h, sizeof(h));
+    memcpy(buf.data() + sizeof(h), toc.data(), toc.size() * sizeof(SnapshotSection));
+    for (size_t i = 0; i < mSections.size(); i++) {
+        auto &p = mSections[i];
+        memcpy(buf.data() + toc[i].offset, p.data ? p.data : p.copy.data(), p.len);
+    }
+}
+
+int SnapshotWriter::Write(const string &file) {
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+
+    // lay it out
+    size_t end;
+    vector<SnapshotSection> toc = Layout(pageSize, end);
+
+    int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        cerr << "error creating snapshot " << file << endl;
+        return -errno;
+    }
+
+    SnapshotHeader h = MakeHeader(mCpu, toc.size());
+
+    bool ok = pwrite(fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h);
+    ok = ok && pwrite(fd, toc.data(), toc.size() * sizeof(SnapshotSection), sizeof(h)) ==
+         (ssize_t)(toc.size() * sizeof(SnapshotSection));
+    for (size_t i = 0; ok && i < mSections.size(); i++) {
+        auto &p = mSections[i];
+        const uint8_t *data = p.data ? p.data : p.copy.data();
+        ok = pwrite(fd, data, p.len, toc[i].offset) == (ssize_t)p.len;
+    }
+
+    // the last mapped section has to be backed by the file all the way to its last page
+    ok = ok && ftruncate(fd, Align(end, pageSize)) == 0;
+
+    close(fd);
+
+    if (!ok) {
+        cerr << "error writing snapshot " << file << endl;
+        return -EIO;
+    }
+
+    return 0;
+}
+
+SnapshotReader::SnapshotReader() {
+}
+
+SnapshotReader::~SnapshotReader() {
+    if (mFd >= 0)
+        close(mFd);
+}
+
+int SnapshotReader::ParseHeader(const SnapshotHeader &h) {
+    if (memcmp(h.magic, kSnapshotMagic, sizeof(h.magic)) != 0) {
+        cerr << "snapshot " << mFile << " has a bad header" << endl;
+        return -EINVAL;
+    }
+    if (h.version != kSnapshotVersion) {
+        cerr << "snapshot " << mFile << " is version " << h.version << ", expected " << kSnapshotVersion << endl;
+        return -EINVAL;
+    }
+
+    memcpy(mCpu, h.cpu, sizeof(h.cpu));
+    mSections.resize(h.sectionCount);
+
+    return 0;
+}
+
+int SnapshotReader::Open(const string &file) {
+    mFile = file;
+    mFd = open(file.c_str(), O_RDONLY);
+    if (mFd < 0) {
+        cerr << "error opening snapshot " << file << endl;
+        return -errno;
+    }
+
+    SnapshotHeader h;
+    if (pread(mFd, &h, sizeof(h), 0) != (ssize_t)sizeof(h)) {
+        cerr << "snapshot " << file << " has a bad header" << endl;
+        return -EINVAL;
+    }
+
+    int err = ParseHeader(h);
+    if (err < 0)
+        return err;
+
+    size_t len = mSections.size() * sizeof(SnapshotSection);
+    if (pread(mFd, mSections.data(), len, sizeof(h)) != (ssize_t)len) {
+        cerr << "snapshot " << file << " is truncated" << endl;
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+int SnapshotReader::Open(const uint8_t *buf, size_t len) {
+    mFile = "(memory)";
+    mBuf = buf;
+    mBufLen = len;
+
+    SnapshotHeader h;
+    if (len < sizeof(h))
+        return -EINVAL;
+    memcpy(&h, buf, sizeof(h));
+
+    int err = ParseHeader(h);
+    if (err < 0)
+        return err;
+
+    size_t tocLen = mSections.size() * sizeof(SnapshotSection);
+    if (len < sizeof(h) + tocLen)
+        return -EINVAL;
+    memcpy(mSections.data(), buf + sizeof(h), tocLen);
+
+    for (auto &s : mSections) {
+        if (s.offset > len || s.length > len - s.offset)
+            return -EINVAL;
+    }
+
+    return 0;
+}
+
+const SnapshotSection *SnapshotReader::Find(const string &name, size_t len) {
+    for (auto &s : mSections) {
+        if (strncmp(s.name, name.c_str(), sizeof(s.name)) != 0)
+            continue;
+
+        if (s.length != len) {
+            cerr << "snapshot " << mFile << ": section " << name << " is " << s.length
+                 << " bytes, expected " << len << endl;
+            return nullptr;
+        }
+        return &s;
+    }
+
+    cerr << "snapshot " << mFile << ": missing section " << name << endl;
+    return nullptr;
+}
+
+int SnapshotReader::Read(const string &name, void *data, size_t len) {
+    const SnapshotSection *s = Find(name, len);
+    if (!s)
+        return -EINVAL;
+
+    if (mBuf) {
+        memcpy(data, mBuf + s->offset, len);
+        return 0;
+    }
+
+    if (pread(mFd, data, len, s->offset) != (ssize_t)len)
+        return -EIO;
+
+    return 0;
+}
+
+int SnapshotReader::MapMemory(const string &name, Memory &mem) {
+    const SnapshotSection *s = Find(name, mem.GetSize());
+    if (!s)
+        return -EINVAL;
+
+    if (mBuf) {
+        if (mDirtyOnly) {
+            mem.LoadDirty(mBuf + s->offset);
+        } else {
+            mem.Load(mBuf + s->offset);
+        }
+        return 0;
+    }
+
+    return mem.Map(mFd, s->offset);
+}
+
+SnapshotSection *FindSnapshotSection(vector<uint8_t> &image, const string &name) {
+    if (image.size() < sizeof(SnapshotHeader))
+        return nullptr;
+
+    auto *h = (const SnapshotHeader *)image.data();
+    auto *toc = (SnapshotSection *)(image.data() + sizeof(SnapshotHeader));
+    for (uint32_t i = 0; i < h->sectionCount; i++) {
+        if (strncmp(toc[i].name, name.c_str(), sizeof(toc[i].name)) == 0)
+            return &toc[i];
+    }
+
+    return nullptr;
+}
+
+int PatchSnapshot(vector<uint8_t> &image, const vector<uint8_t> &from) {
+    auto *h = (const SnapshotHeader *)from.data();
+    auto *toc = (const SnapshotSection *)(from.data() + sizeof(SnapshotHeader));
+    for (uint32_t i = 0; i < h->sectionCount; i++) {
+        const SnapshotSection *dst = FindSnapshotSection(image, string(toc[i].name, strnlen(toc[i].name, sizeof(toc[i].name))));
+        if (!dst || dst->length != toc[i].length)
+            return -EINVAL;
+
+        memcpy(image.data() + dst->offset, from.data() + toc[i].offset, toc[i].length);
+    }
+
+    return 0;
+}
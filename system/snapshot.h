@@ -0,0 +1,140 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Memory;
+
+// Save state file.
+//
+// A header, a table of named sections, then the section data. Sections hold
+// cpu registers and device state as raw structs in host byte order; memory
+// banks start on a page boundary so they can be mapped straight back in with
+// MAP_PRIVATE instead of being read. Any section whose size doesn't match what
+// the loading side expects fails the load.
+struct SnapshotHeader {
+    char magic[8];          // "EMUSNAP\0"
+    uint32_t version;
+    uint32_t sectionCount;
+    char cpu[16];           // cpu name, as the cpu reports it
+};
+
+struct SnapshotSection {
+    char name[24];
+    uint64_t offset;
+    uint64_t length;
+};
+
+class SnapshotWriter {
+public:
+    // without memory, banks are only collected in GetBanks() and left out of the
+    // output, for incremental save states that track memory themselves
+    explicit SnapshotWriter(const char *cpu, bool withMemory = true);
+
+    // small blob of state, copied
+    void AddSection(const std::string &name, const void *data, size_t len);
+
+    // memory bank, page aligned in the file. Not copied, must stay valid until Write().
+    void AddMemory(const std::string &name, Memory &mem);
+
+    int Write(const std::string &file);
+
+    // same layout, into a buffer, without padding memory banks out to pages
+    void Write(std::vector<uint8_t> &buf);
+
+    // every bank passed to AddMemory(), in order
+    struct Bank {
+        std::string name;
+        Memory *mem;
+    };
+    const std::vector<Bank> &GetBanks() const { return mBanks; }
+
+private:
+    std::vector<SnapshotSection> Layout(size_t pageSize, size_t &end) const;
+
+    struct Pending {
+        std::string name;
+        std::vector<uint8_t> copy;
+        const uint8_t *data;
+        size_t len;
+        bool pageAligned;
+    };
+
+    std::string mCpu;
+    bool mWithMemory;
+    std::vector<Pending> mSections;
+    std::vector<Bank> mBanks;
+};
+
+class SnapshotReader {
+public:
+    SnapshotReader();
+    ~SnapshotReader();
+
+    // non copyable
+    SnapshotReader(const SnapshotReader &) = delete;
+    SnapshotReader &operator=(const SnapshotReader &) = delete;
+
+    int Open(const std::string &file);
+
+    // read from a snapshot built in memory, which must outlive the reader.
+    // Memory banks are copied instead of mapped.
+    int Open(const uint8_t *buf, size_t len);
+
+    // with a snapshot in memory, only copy back the pages of each bank that
+    // have been written since, for resetting to the same snapshot over and over
+    void SetDirtyPagesOnly(bool dirtyOnly) { mDirtyOnly = dirtyOnly; }
+
+    const char *GetCpu() const { return mCpu; }
+
+    // read a section that must be exactly len bytes long
+    int Read(const std::string &name, void *data, size_t len);
+
+    // replace the backing of a memory bank with a private mapping of its section
+    int MapMemory(const std::string &name, Memory &mem);
+
+private:
+    int ParseHeader(const SnapshotHeader &h);
+    const SnapshotSection *Find(const std::string &name, size_t len);
+
+    int mFd = -1;
+    const uint8_t *mBuf = nullptr;
+    size_t mBufLen = 0;
+    bool mDirtyOnly = false;
+    std::string mFile;
+    char mCpu[sizeof(SnapshotHeader::cpu) + 1] = {};
+    std::vector<SnapshotSection> mSections;
+};
+
+// editing snapshots held in memory
+
+// the section called name, or null
+SnapshotSection *FindSnapshotSection(std::vector<uint8_t> &image, const std::string &name);
+
+// copy every section of from over the section of the same name and size in image
+int PatchSnapshot(std::vector<uint8_t> &image, const std::vector<uint8_t> &from);
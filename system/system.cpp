@@ -22,16 +22,20 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 #include "system.h"
-#include "system09.h"
-#include "system_kaypro.h"
-#include "altair680.h"
+#include "snapshot.h"
+#include "console.h"
+#include "cpu/cpu.h"
+#include "debug/probes.h"
+#include "debug/stats.h"
+#include "debug/timeline.h"
+#include "debug/tracelog.h"
 
 #include <cstdio>
 #include <cassert>
 
 #define TRACE 0
 
-#define TRACEF(str, x...) do { if (TRACE) printf(str, ## x); } while (0)
+#define TRACEF(str, x...) do { if (TRACE) TraceLog::Printf(str, ## x); } while (0)
 
 using namespace std;
 
@@ -41,37 +45,39 @@ System::System(const string &subsystem, Console &con)
 }
 
 System::~System() {
+    EMU_PROBE1(system_shutdown, this);
+
     ShutdownThreaded();
+
+    Stats::ReleaseSlot(mStats);
 }
 
-std::unique_ptr<System> System::Factory(const std::string &system, Console &con) {
-    // split the system string into a few pieces
-    size_t pos = system.find('-');
-    string mainsystem = system.substr(0, pos);
-
-    string subsystem;
-    if (pos != string::npos)
-        subsystem = system.substr(pos + 1, string::npos);
-
-    if (mainsystem == "6809") {
-        return std::unique_ptr<System>(new System09(subsystem, con));
-    } else if (mainsystem == "altair680") {
-        return std::unique_ptr<System>(new Altair680(subsystem, con));
-    } else if (mainsystem == "kaypro") {
-        return std::unique_ptr<System>(new SystemKaypro(subsystem, con));
-    } else {
-        return NULL;
-    }
+void System::SetStats(StatsSlot *slot) {
+    mStats = slot;
+    mConsole.SetStats(slot);
+    GetCpu()->SetStats(slot);
+}
+
+void System::AppendDeviceWrite(size_t address, uint8_t val, bool port) {
+    mDeviceWrites->push_back({ GetCpu()->GetInstructionCount(), (uint32_t)address, val, port });
+}
+
+void System::SetHeatmap(Heatmap *h) {
+    mHeatmap = h;
+    GetCpu()->SetHeatmap(h);
 }
 
 int System::RunThreaded() {
     assert(!mThread);
 
     auto start = [this]() {
+        Timeline::SetThreadName("system");
         printf("Starting system thread\n");
-        this->Run();
+        mRunResult = this->Run();
+        mRunning = false;
     };
 
+    mRunning = true;
     mThread.reset(new std::thread(start));
 
     return 0;
@@ -83,11 +89,32 @@ void System::ShutdownThreaded() {
 
     // tell the run loop to shut down
     mShutdown = true;
+    RequestBreak();
     mThread->join();
 
     mThread.release();
 }
 
+int System::SaveSnapshot(const string &file) {
+    TimelineScope span("save snapshot", "snapshot");
+
+    SnapshotWriter w(GetCpu()->GetName());
+    SaveState(w);
+
+    return w.Write(file);
+}
+
+int System::LoadSnapshot(const string &file) {
+    TimelineScope span("load snapshot", "snapshot");
+
+    SnapshotReader r;
+    int err = r.Open(file);
+    if (err < 0)
+        return err;
+
+    return LoadState(r);
+}
+
 uint16_t System::MemRead16(size_t address, Endian e) {
     uint16_t val;
     switch (e) {
@@ -29,8 +29,15 @@
 #include <string>
 #include <sys/types.h>
 #include <thread>
+#include <vector>
 
 class Console;
+class Cpu;
+class Heatmap;
+class TraceWriter;
+class SnapshotReader;
+class SnapshotWriter;
+struct StatsSlot;
 
 // top level object, representing the entire emulated system
 class System {
@@ -51,6 +58,45 @@ public:
     void SetRom(const std::string &rom) { mRomString = rom; }
     void SetCpu(const std::string &cpu) { mCpuString = cpu; }
 
+    const std::string &GetRom() const { return mRomString; }
+
+    // the main cpu, valid after Init()
+    virtual Cpu *GetCpu() = 0;
+
+    // save or restore the whole machine, only while it isn't running
+    int SaveSnapshot(const std::string &file);
+    int LoadSnapshot(const std::string &file);
+
+    // same, through a writer or reader set up by the caller. From the cpu thread
+    // these are fine while it's running, between instructions.
+    void SaveSnapshot(SnapshotWriter &w) const { SaveState(w); }
+    int LoadSnapshot(SnapshotReader &r) { return LoadState(r); }
+
+    // publish live counters into a slot from Stats::AddSlot, after Init(). The
+    // system owns the slot from here on and hands it back when it goes away.
+    virtual void SetStats(StatsSlot *slot);
+
+    // count bus traffic per page and per device, after Init(). Not owned.
+    virtual void SetHeatmap(Heatmap *h);
+
+    // record guest memory writes into an execution trace, not owned
+    void SetTraceWriter(TraceWriter *t) { mTraceWriter = t; }
+
+    // every write to a device register or io port, in order, while a log is
+    // set. Writes to plain memory aren't in it. Not owned.
+    struct DeviceWrite {
+        uint64_t instruction;
+        uint32_t address;   // bus address, or the port number
+        uint8_t val;
+        bool port;
+
+        bool operator==(const DeviceWrite &o) const {
+            return instruction == o.instruction && address == o.address && val == o.val && port == o.port;
+        }
+        bool operator!=(const DeviceWrite &o) const { return !(*this == o); }
+    };
+    void SetDeviceWriteLog(std::vector<DeviceWrite> *log) { mDeviceWrites = log; }
+
     enum class Endian {
         LITTLE,
         BIG
@@ -60,6 +106,9 @@ public:
     virtual uint8_t  MemRead8(size_t address) = 0;
     virtual void     MemWrite8(size_t address, uint8_t val) = 0;
 
+    // side effect free read, for debug tools
+    virtual uint8_t  MemPeek8(size_t address) = 0;
+
     // 16 and 32 bit read/writes, endian specified
     // default implementation calls through to MemRead/Write8
     virtual uint16_t MemRead16(size_t address, Endian e);
@@ -76,12 +125,42 @@ public:
 
     bool isShutdown() const { return mShutdown; }
 
+    // the guest asked to end the run, for systems where programs can exit
+    virtual bool HasExited() const { return false; }
+
+    // true while the threaded run loop is still going, the result of Run() once it isn't
+    bool IsRunning() const { return mRunning; }
+    int GetRunResult() const { return mRunResult; }
+
+    // ask the cpu run loop to drop out and look at its configuration again,
+    // safe to call from other threads and signal handlers
+    void RequestBreak() { mBreak = true; }
+    bool BreakRequested() const { return mBreak.load(std::memory_order_relaxed); }
+    void ClearBreak() { mBreak = false; }
+
 protected:
+    void LogDeviceWrite(size_t address, uint8_t val, bool port) {
+        if (mDeviceWrites)
+            AppendDeviceWrite(address, val, port);
+    }
+    void AppendDeviceWrite(size_t address, uint8_t val, bool port);
+
+    // system specific part of a snapshot, the cpu, memory banks and devices
+    virtual void SaveState(SnapshotWriter &w) const = 0;
+    virtual int LoadState(SnapshotReader &r) = 0;
+
     std::string mSubSystemString;
     Console &mConsole;
     std::unique_ptr<std::thread> mThread;
     std::string mRomString;
     std::string mCpuString;
     std::atomic<bool> mShutdown { false };
+    std::atomic<bool> mBreak { false };
+    std::atomic<bool> mRunning { false };
+    std::atomic<int> mRunResult { 0 };
+    TraceWriter *mTraceWriter = nullptr;
+    StatsSlot *mStats = nullptr;
+    Heatmap *mHeatmap = nullptr;
+    std::vector<DeviceWrite> *mDeviceWrites = nullptr;
 };
 
@@ -28,10 +28,16 @@
 #include <iostream>
 
 #include "cpu/cpu6809.h"
+#include "debug/heatmap.h"
+#include "debug/hostprofile.h"
+#include "debug/probes.h"
+#include "debug/stats.h"
+#include "debug/tracefile.h"
 #include "dev/memory.h"
 #include "dev/mc6850.h"
 #include "dev/uart16550.h"
-#include "ihex.h"
+#include "system/romimage.h"
+#include "system/snapshot.h"
 
 #define DEFAULT_ROM "test/BASIC.HEX"
 
@@ -59,6 +65,8 @@ void System09::iHexParseCallback(const uint8_t *ptr, size_t address, size_t len)
 }
 
 int System09::Init() {
+    EMU_PROBE2(system_init, this, mRomString.c_str());
+
     cout << "initializing a 6809 based system. ";
     cout << "subsystem '" << mSubSystemString << "'" << endl;
     cout << "rom is " << mRomString << endl;
@@ -93,17 +101,9 @@ int System09::Init() {
     }
 
     // preload some stuff into memory
-    iHex hex;
-
-    // use the ihex library to parse the rom file
-    hex.SetCallback(
-    [this](const uint8_t *ptr, size_t offset, size_t len) {
-        this->iHexParseCallback(ptr, offset, len);
-    }
-    );
-
-    hex.Open(mRomString);
-    hex.Parse();
+    auto rom = RomImage::LoadHex(mRomString);
+    for (auto &c : rom->GetChunks())
+        iHexParseCallback(c.data.data(), c.address, c.data.size());
 
     return 0;
 }
@@ -114,10 +114,50 @@ int System09::Run() {
     return mCpu->Run();
 }
 
+void System09::SaveState(SnapshotWriter &w) const {
+    mCpu->SaveState(w);
+    mMem->SaveState(w, "ram");
+    mRom->SaveState(w, "rom");
+    mUart->SaveState(w, "uart");
+}
+
+int System09::LoadState(SnapshotReader &r) {
+    int err = mCpu->LoadState(r);
+    if (err >= 0)
+        err = mMem->LoadState(r, "ram");
+    if (err >= 0)
+        err = mRom->LoadState(r, "rom");
+    if (err >= 0)
+        err = mUart->LoadState(r, "uart");
+
+    return err;
+}
+
+Cpu *System09::GetCpu() {
+    return mCpu.get();
+}
+
+void System09::SetStats(StatsSlot *slot) {
+    System::SetStats(slot);
+    mUart->SetStats(Stats::AddDevice(slot, mMemoryLayout == MemoryLayout::OBC ? "uart16550" : "mc6850"));
+}
+
+void System09::SetHeatmap(Heatmap *h) {
+    System::SetHeatmap(h);
+    h->AddDevice(mMem.get(), "ram", false);
+    h->AddDevice(mRom.get(), "rom", false);
+    h->AddDevice(mUart.get(), mMemoryLayout == MemoryLayout::OBC ? "uart16550" : "mc6850", true);
+}
+
 uint8_t System09::MemRead8(size_t address) {
+    HostProfileScope prof(HostProfile::BUS);
+
     uint8_t val = 0;
 
+    size_t bus = address;
     MemoryDevice *mem = GetDeviceAtAddr(address);
+    if (mHeatmap)
+        mHeatmap->Read(bus, mem);
     if (mem)
         val = mem->ReadByte(address);
 
@@ -126,15 +166,33 @@ uint8_t System09::MemRead8(size_t address) {
 }
 
 void System09::MemWrite8(size_t address, uint8_t val) {
+    HostProfileScope prof(HostProfile::BUS);
+
     address &= 0xffff;
 
+    if (mTraceWriter)
+        mTraceWriter->Write(address, val);
+
+    size_t bus = address;
     MemoryDevice *mem = GetDeviceAtAddr(address);
+    if (mHeatmap)
+        mHeatmap->Write(bus, mem);
+    if (mem == mUart.get())
+        LogDeviceWrite(bus, val, false);
     if (mem)
         mem->WriteByte(address, val);
 
     //cout << "MemWrite8 @0x" << hex << address << " val " << (unsigned int)val << endl;
 }
 
+uint8_t System09::MemPeek8(size_t address) {
+    MemoryDevice *mem = GetDeviceAtAddr(address);
+    if (mem)
+        return mem->PeekByte(address);
+
+    return 0;
+}
+
 MemoryDevice *System09::GetDeviceAtAddr(size_t &address) {
     address &= 0xffff;
 
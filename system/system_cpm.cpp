@@ -0,0 +1,363 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "system_cpm.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "console.h"
+#include "cpu/cpuz80.h"
+#include "debug/heatmap.h"
+#include "debug/hostprofile.h"
+#include "debug/probes.h"
+#include "debug/stats.h"
+#include "debug/timeline.h"
+#include "debug/tracefile.h"
+#include "dev/memory.h"
+#include "system/romimage.h"
+#include "system/snapshot.h"
+#include "trace.h"
+
+#define LOCAL_TRACE 0
+
+using namespace std;
+
+// where the stubs live, the BDOS entry is also the top of the program area
+#define BDOS_ADDR  0xfe00
+#define WBOOT_ADDR 0xff00
+#define BOOT_ADDR  0xff10
+#define TPA_ADDR   0x0100
+
+// io ports the stubs use to talk to the host
+#define PORT_BDOS_CALL  0xf0    // out: run function A, in: result
+#define PORT_BDOS_D     0xf1
+#define PORT_BDOS_E     0xf2
+#define PORT_WBOOT      0xff
+
+// BDOS entry: pass D, E, then the function number in C, read back the result in A and HL
+static const uint8_t bdosStub[] = {
+    0x7a,                   // ld a,d
+    0xd3, PORT_BDOS_D,      // out (PORT_BDOS_D),a
+    0x7b,                   // ld a,e
+    0xd3, PORT_BDOS_E,      // out (PORT_BDOS_E),a
+    0x79,                   // ld a,c
+    0xd3, PORT_BDOS_CALL,   // out (PORT_BDOS_CALL),a
+    0xdb, PORT_BDOS_CALL,   // in a,(PORT_BDOS_CALL)
+    0x6f,                   // ld l,a
+    0x26, 0x00,             // ld h,0
+    0xc9,                   // ret
+};
+
+// warm boot: tell the host the program is done, then spin until it stops us
+static const uint8_t wbootStub[] = {
+    0xd3, PORT_WBOOT,       // out (PORT_WBOOT),a
+    0x18, 0xfe,             // jr $
+};
+
+// cold boot, where the cpu comes out of reset through page zero: point page
+// zero at the warm boot stub, set up a stack that returns to it, run the program
+static const uint8_t bootStub[] = {
+    0x31, BDOS_ADDR & 0xff, BDOS_ADDR >> 8,     // ld sp,BDOS_ADDR
+    0x21, WBOOT_ADDR & 0xff, WBOOT_ADDR >> 8,   // ld hl,WBOOT_ADDR
+    0x22, 0x01, 0x00,                           // ld (1),hl
+    0x21, 0x00, 0x00,                           // ld hl,0
+    0xe5,                                       // push hl
+    0xc3, TPA_ADDR & 0xff, TPA_ADDR >> 8,       // jp TPA_ADDR
+};
+
+SystemCpm::SystemCpm(const std::string &subsystem, Console &con)
+    :   System(subsystem, con) {
+}
+
+SystemCpm::~SystemCpm() {
+}
+
+int SystemCpm::Init() {
+    EMU_PROBE2(system_init, this, mRomString.c_str());
+
+    cout << "initializing a CP/M system. ";
+    cout << "subsystem '" << mSubSystemString << "'" << endl;
+    cout << "program is " << mRomString << endl;
+
+    if (mRomString == "") {
+        cout << "cpm needs a .COM file to run, pass it with -r" << endl;
+        return -1;
+    }
+
+    // create a z80 based cpu
+    mCpu.reset(new CpuZ80(*this));
+    mCpu->Reset();
+
+    // all ram
+    mMem.reset(new Memory());
+    mMem->Alloc(64*1024);
+    uint8_t *mem = (uint8_t *)mMem->GetPtr();
+
+    // load the program
+    {
+        auto rom = RomImage::LoadBinary(mRomString);
+        if (!rom)
+            return -1;
+
+        const auto &data = rom->GetChunks()[0].data;
+        if (data.size() > BDOS_ADDR - TPA_ADDR) {
+            cout << "program " << mRomString << " is too big" << std::endl;
+            return -1;
+        }
+
+        memcpy(mem + TPA_ADDR, data.data(), data.size());
+    }
+
+    // page zero: jp boot until the boot stub makes it jp wboot, and jp bdos,
+    // which also tells the program where its memory ends
+    mem[0] = 0xc3;
+    mem[1] = BOOT_ADDR & 0xff;
+    mem[2] = BOOT_ADDR >> 8;
+    mem[5] = 0xc3;
+    mem[6] = BDOS_ADDR & 0xff;
+    mem[7] = BDOS_ADDR >> 8;
+
+    // empty default fcb and command tail
+    memset(mem + 0x5d, ' ', 11);
+    mem[0x80] = 0;
+
+    memcpy(mem + BDOS_ADDR, bdosStub, sizeof(bdosStub));
+    memcpy(mem + WBOOT_ADDR, wbootStub, sizeof(wbootStub));
+    memcpy(mem + BOOT_ADDR, bootStub, sizeof(bootStub));
+
+    return 0;
+}
+
+int SystemCpm::Run() {
+    cout << "starting main run loop" << endl;
+
+    auto start = chrono::steady_clock::now();
+    uint64_t startCount = mCpu->GetInstructionCount();
+
+    int err = mCpu->Run();
+
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    uint64_t count = mCpu->GetInstructionCount() - startCount;
+    fprintf(stderr, "cpm: %llu instructions in %.3f seconds, %.0f instructions/sec%s\n",
+            (unsigned long long)count, secs, count / secs, mExited ? ", program exited" : "");
+
+    return err;
+}
+
+void SystemCpm::SaveState(SnapshotWriter &w) const {
+    mCpu->SaveState(w);
+    mMem->SaveState(w, "ram");
+    w.AddSection("bdos", &mBdos, sizeof(mBdos));
+}
+
+int SystemCpm::LoadState(SnapshotReader &r) {
+    int err = mCpu->LoadState(r);
+    if (err >= 0)
+        err = mMem->LoadState(r, "ram");
+    if (err >= 0)
+        err = r.Read("bdos", &mBdos, sizeof(mBdos));
+
+    return err;
+}
+
+Cpu *SystemCpm::GetCpu() {
+    return mCpu.get();
+}
+
+void SystemCpm::SetStats(StatsSlot *slot) {
+    System::SetStats(slot);
+    mIoStats = Stats::AddDevice(slot, "io ports");
+}
+
+void SystemCpm::SetHeatmap(Heatmap *h) {
+    System::SetHeatmap(h);
+    h->AddDevice(mMem.get(), "ram", false);
+}
+
+uint8_t SystemCpm::MemRead8(size_t address) {
+    HostProfileScope prof(HostProfile::BUS);
+
+    if (mHeatmap)
+        mHeatmap->Read(address & 0xffff, mMem.get());
+
+    return mMem->ReadByte(address & 0xffff);
+}
+
+void SystemCpm::MemWrite8(size_t address, uint8_t val) {
+    HostProfileScope prof(HostProfile::BUS);
+
+    address &= 0xffff;
+
+    LTRACEF("addr 0x%zx val 0x%x\n", address, val);
+
+    if (mTraceWriter)
+        mTraceWriter->Write(address, val);
+
+    if (mHeatmap)
+        mHeatmap->Write(address, mMem.get());
+
+    mMem->WriteByte(address, val);
+}
+
+uint8_t SystemCpm::MemPeek8(size_t address) {
+    return mMem->PeekByte(address & 0xffff);
+}
+
+uint8_t SystemCpm::IORead8(size_t address) {
+    HostProfileScope prof(HostProfile::DEVICE);
+
+    if (mIoStats)
+        StatsAdd(mIoStats->reads, 1);
+    if (mHeatmap)
+        mHeatmap->PortRead();
+
+    uint8_t val = 0;
+
+    if ((address & 0xff) == PORT_BDOS_CALL)
+        val = mBdos.result;
+
+    LTRACEF("addr 0x%zx val 0x%x\n", address, val);
+
+    EMU_PROBE3(mmio_read, "io ports", address, val);
+
+    return val;
+}
+
+void SystemCpm::IOWrite8(size_t address, uint8_t val) {
+    HostProfileScope prof(HostProfile::DEVICE);
+
+    if (mIoStats)
+        StatsAdd(mIoStats->writes, 1);
+    if (mHeatmap)
+        mHeatmap->PortWrite();
+    EMU_PROBE3(mmio_write, "io ports", address, val);
+    LogDeviceWrite(address, val, true);
+
+    LTRACEF("addr 0x%zx val 0x%x\n", address, val);
+
+    switch (address & 0xff) {
+        case PORT_BDOS_D:
+            mBdos.d = val;
+            break;
+        case PORT_BDOS_E:
+            mBdos.e = val;
+            break;
+        case PORT_BDOS_CALL:
+            Bdos(val);
+            break;
+        case PORT_WBOOT:
+            mExited = true;
+            mCpu->RequestStop();
+            break;
+        default:
+            fprintf(stderr, "out to unknown port 0x%zx\n", address);
+            break;
+    }
+}
+
+// next console byte, optionally waiting for one to show up
+int SystemCpm::ReadChar(bool wait) {
+    int c = mBdos.pendingInput;
+    mBdos.pendingInput = -1;
+
+    bool waited = false;
+    uint64_t waitStart = 0;
+    while (c < 0) {
+        c = mConsole.GetNextChar();
+        if (c >= 0 || !wait || isShutdown() || BreakRequested())
+            break;
+        if (!waited && Timeline::IsEnabled())
+            waitStart = Timeline::Now();
+        waited = true;
+
+        HostProfileScope prof(HostProfile::SLEEP);
+        uint64_t start = Stats::NowNs();
+        this_thread::sleep_for(chrono::milliseconds(1));
+        if (mStats)
+            StatsAdd(mStats->sleepNs, Stats::NowNs() - start);
+    }
+
+    // the guest doesn't run while it waits, so the count is the same at the start
+    if (waited && Timeline::IsEnabled())
+        Timeline::Span("input wait", "sleep", waitStart, Timeline::ThreadInstructions());
+
+    return c;
+}
+
+void SystemCpm::Bdos(uint8_t func) {
+    uint16_t de = mBdos.d << 8 | mBdos.e;
+
+    LTRACEF("function %u de 0x%x\n", func, de);
+
+    if (Timeline::IsEnabled())
+        Timeline::Instant("bdos", "device", "function", func);
+
+    mBdos.result = 0;
+    switch (func) {
+        case 0: // system reset
+            mExited = true;
+            mCpu->RequestStop();
+            break;
+        case 1: { // console input, echoed
+            int c = ReadChar(true);
+            if (c >= 0) {
+                mConsole.Putchar(c);
+                mBdos.result = c;
+            }
+            break;
+        }
+        case 2: // console output
+            mConsole.Putchar(mBdos.e);
+            break;
+        case 6: // direct console io
+            if (mBdos.e == 0xff) {
+                int c = ReadChar(false);
+                mBdos.result = (c >= 0) ? c : 0;
+            } else {
+                mConsole.Putchar(mBdos.e);
+            }
+            break;
+        case 9: { // print string, '$' terminated, at most once around the address space
+            uint16_t a = de;
+            for (uint32_t i = 0; i < 0x10000 && MemPeek8(a) != '$'; i++, a++)
+                mConsole.Putchar(MemPeek8(a));
+            break;
+        }
+        case 11: // console status
+            if (mBdos.pendingInput < 0)
+                mBdos.pendingInput = ReadChar(false);
+            mBdos.result = (mBdos.pendingInput >= 0) ? 0xff : 0;
+            break;
+        case 12: // version, CP/M 2.2
+            mBdos.result = 0x22;
+            break;
+        default:
+            fprintf(stderr, "cpm: unhandled bdos function %u\n", func);
+            break;
+    }
+}
+
@@ -0,0 +1,87 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <memory>
+#include "system.h"
+
+class Console;
+class CpuZ80;
+class Memory;
+struct StatsDevice;
+
+// A bare CP/M-80 machine for running .COM programs, mostly the ZEXDOC/ZEXALL
+// instruction exercisers. 64K of flat ram, the program loaded at 0x100, and a
+// BDOS stub at the top of memory that hands calls to the host through a few
+// io ports. Only the console functions are there, no disks. A jump to 0 (warm
+// boot) ends the run.
+class SystemCpm final : public System {
+public:
+    SystemCpm(const std::string &subsystem, Console &con);
+    virtual ~SystemCpm() override;
+
+    virtual int Init() override;
+
+    virtual int Run() override;
+
+    virtual Cpu *GetCpu() override;
+
+    virtual void SetStats(StatsSlot *slot) override;
+    virtual void SetHeatmap(Heatmap *h) override;
+
+    virtual bool HasExited() const override { return mExited; }
+
+    virtual uint8_t  MemRead8(size_t address) override;
+    virtual void     MemWrite8(size_t address, uint8_t val) override;
+    virtual uint8_t  MemPeek8(size_t address) override;
+
+    virtual uint8_t  IORead8(size_t address) override;
+    virtual void     IOWrite8(size_t address, uint8_t val) override;
+
+protected:
+    virtual void SaveState(SnapshotWriter &w) const override;
+    virtual int LoadState(SnapshotReader &r) override;
+
+private:
+    void Bdos(uint8_t func);
+    int ReadChar(bool wait);
+
+    std::unique_ptr<CpuZ80> mCpu;
+    StatsDevice *mIoStats = nullptr;
+    std::unique_ptr<Memory> mMem;
+
+    // what the stub has passed in so far, and the result it reads back
+    struct BdosState {
+        uint8_t d;
+        uint8_t e;
+        uint8_t result;
+        uint8_t pad;            // saved raw in snapshots, so no compiler padding
+        int16_t pendingInput;   // read ahead by a console status call, -1 if none
+    } mBdos = { 0, 0, 0, 0, -1 };
+
+    std::atomic<bool> mExited { false };
+};
+
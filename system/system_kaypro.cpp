@@ -25,11 +25,18 @@
 #include "system_kaypro.h"
 
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 
 #include "cpu/cpuz80.h"
+#include "debug/heatmap.h"
+#include "debug/hostprofile.h"
+#include "debug/probes.h"
+#include "debug/stats.h"
+#include "debug/tracefile.h"
 #include "dev/memory.h"
-#include "ihex.h"
+#include "system/romimage.h"
+#include "system/snapshot.h"
 #include "trace.h"
 
 #define DEFAULT_ROM "rom/kaypro/kayproii_u47.bin"
@@ -49,6 +56,8 @@ SystemKaypro::~SystemKaypro() {
 }
 
 int SystemKaypro::Init() {
+    EMU_PROBE2(system_init, this, mRomString.c_str());
+
     cout << "initializing a Z80 based system. ";
     cout << "subsystem '" << mSubSystemString << "'" << endl;
     cout << "rom is " << mRomString << endl;
@@ -71,17 +80,17 @@ int SystemKaypro::Init() {
 
     // read it in
     {
-        FILE *fp = fopen(mRomString.c_str(), "rb");
-        if (!fp)
+        auto rom = RomImage::LoadBinary(mRomString);
+        if (!rom)
             return -1;
 
-        size_t err = fread(mRom->GetPtr(), 1, mRom->GetSize(), fp);
-        fclose(fp);
-
-        if (err != mRom->GetSize()) {
+        const auto &data = rom->GetChunks()[0].data;
+        if (data.size() < mRom->GetSize()) {
             cout << "error reading rom " << mRomString << std::endl;
             return -1;
         }
+
+        memcpy(mRom->GetPtr(), data.data(), mRom->GetSize());
     }
 
     // create a bank of video rom
@@ -90,17 +99,17 @@ int SystemKaypro::Init() {
 
     // read it in
     {
-        FILE *fp = fopen(VIDEO_ROM, "rb");
-        if (!fp)
+        auto rom = RomImage::LoadBinary(VIDEO_ROM);
+        if (!rom)
             return -1;
 
-        size_t err = fread(mVideoRom->GetPtr(), 1, mVideoRom->GetSize(), fp);
-        fclose(fp);
-
-        if (err != mVideoRom->GetSize()) {
+        const auto &data = rom->GetChunks()[0].data;
+        if (data.size() < mVideoRom->GetSize()) {
             cout << "error reading rom " << VIDEO_ROM << std::endl;
             return -1;
         }
+
+        memcpy(mVideoRom->GetPtr(), data.data(), mVideoRom->GetSize());
     }
 
     return 0;
@@ -112,10 +121,62 @@ int SystemKaypro::Run() {
     return mCpu->Run();
 }
 
+void SystemKaypro::SaveState(SnapshotWriter &w) const {
+    mCpu->SaveState(w);
+    mMem->SaveState(w, "ram");
+    mVideoMem->SaveState(w, "ram.video");
+    mRom->SaveState(w, "rom");
+    mVideoRom->SaveState(w, "rom.video");
+
+    uint8_t bank = mBankSwitch;
+    w.AddSection("bankswitch", &bank, sizeof(bank));
+}
+
+int SystemKaypro::LoadState(SnapshotReader &r) {
+    int err = mCpu->LoadState(r);
+    if (err >= 0)
+        err = mMem->LoadState(r, "ram");
+    if (err >= 0)
+        err = mVideoMem->LoadState(r, "ram.video");
+    if (err >= 0)
+        err = mRom->LoadState(r, "rom");
+    if (err >= 0)
+        err = mVideoRom->LoadState(r, "rom.video");
+
+    uint8_t bank;
+    if (err >= 0)
+        err = r.Read("bankswitch", &bank, sizeof(bank));
+    if (err >= 0)
+        mBankSwitch = bank ? BANK1 : BANK0;
+
+    return err;
+}
+
+Cpu *SystemKaypro::GetCpu() {
+    return mCpu.get();
+}
+
+void SystemKaypro::SetStats(StatsSlot *slot) {
+    System::SetStats(slot);
+    mIoStats = Stats::AddDevice(slot, "io ports");
+}
+
+void SystemKaypro::SetHeatmap(Heatmap *h) {
+    System::SetHeatmap(h);
+    h->AddDevice(mMem.get(), "ram", false);
+    h->AddDevice(mVideoMem.get(), "video ram", false);
+    h->AddDevice(mRom.get(), "rom", false);
+}
+
 uint8_t SystemKaypro::MemRead8(size_t address) {
+    HostProfileScope prof(HostProfile::BUS);
+
     uint8_t val = 0;
 
+    size_t bus = address;
     MemoryDevice *mem = GetDeviceAtAddr(address);
+    if (mHeatmap)
+        mHeatmap->Read(bus, mem);
     if (mem)
         val = mem->ReadByte(address);
 
@@ -124,24 +185,50 @@ uint8_t SystemKaypro::MemRead8(size_t address) {
 }
 
 void SystemKaypro::MemWrite8(size_t address, uint8_t val) {
+    HostProfileScope prof(HostProfile::BUS);
+
     address &= 0xffff;
 
     LTRACEF("addr 0x%zx val 0x%x\n", address, val);
 
+    if (mTraceWriter)
+        mTraceWriter->Write(address, val);
+
+    size_t bus = address;
     MemoryDevice *mem = GetDeviceAtAddr(address);
+    if (mHeatmap)
+        mHeatmap->Write(bus, mem);
     if (mem)
         mem->WriteByte(address, val);
 }
 
 uint8_t SystemKaypro::IORead8(size_t address) {
+    HostProfileScope prof(HostProfile::DEVICE);
+
+    if (mIoStats)
+        StatsAdd(mIoStats->reads, 1);
+    if (mHeatmap)
+        mHeatmap->PortRead();
+
     uint8_t val = 0;
 
     LTRACEF("addr 0x%zx val 0x%x\n", address, val);
 
+    EMU_PROBE3(mmio_read, "io ports", address, val);
+
     return val;
 }
 
 void SystemKaypro::IOWrite8(size_t address, uint8_t val) {
+    HostProfileScope prof(HostProfile::DEVICE);
+
+    if (mIoStats)
+        StatsAdd(mIoStats->writes, 1);
+    if (mHeatmap)
+        mHeatmap->PortWrite();
+    EMU_PROBE3(mmio_write, "io ports", address, val);
+    LogDeviceWrite(address, val, true);
+
     LTRACEF("addr 0x%zx val 0x%x\n", address, val);
 
     if (LOCAL_TRACE) {
@@ -195,6 +282,14 @@ void SystemKaypro::IOWrite8(size_t address, uint8_t val) {
     }
 }
 
+uint8_t SystemKaypro::MemPeek8(size_t address) {
+    MemoryDevice *mem = GetDeviceAtAddr(address);
+    if (mem)
+        return mem->PeekByte(address);
+
+    return 0;
+}
+
 MemoryDevice *SystemKaypro::GetDeviceAtAddr(size_t &address) {
     address &= 0xffff;
 
@@ -32,6 +32,7 @@ class Console;
 class CpuZ80;
 class MemoryDevice;
 class Memory;
+struct StatsDevice;
 
 // a Z80 based Kaypro
 class SystemKaypro final : public System {
@@ -43,18 +44,29 @@ public:
 
     virtual int Run() override;
 
+    virtual Cpu *GetCpu() override;
+
+    virtual void SetStats(StatsSlot *slot) override;
+    virtual void SetHeatmap(Heatmap *h) override;
+
     virtual uint8_t  MemRead8(size_t address) override;
     virtual void     MemWrite8(size_t address, uint8_t val) override;
+    virtual uint8_t  MemPeek8(size_t address) override;
 
     virtual uint8_t  IORead8(size_t address) override;
     virtual void     IOWrite8(size_t address, uint8_t val) override;
 
+protected:
+    virtual void SaveState(SnapshotWriter &w) const override;
+    virtual int LoadState(SnapshotReader &r) override;
+
 private:
     void iHexParseCallback(const uint8_t *ptr, size_t offset, size_t len);
 
     MemoryDevice *GetDeviceAtAddr(size_t &address);
 
     std::unique_ptr<CpuZ80> mCpu;
+    StatsDevice *mIoStats = nullptr;
     std::unique_ptr<Memory> mMem;
     std::unique_ptr<Memory> mVideoMem;
     std::unique_ptr<Memory> mRom;
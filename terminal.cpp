@@ -0,0 +1,134 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2014 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "terminal.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+
+#include "debug/probes.h"
+#include "debug/timeline.h"
+
+static struct termios oldstdin;
+static struct termios oldstdout;
+
+static void resetconsole() {
+    tcsetattr(0, TCSANOW, &oldstdin);
+    tcsetattr(1, TCSANOW, &oldstdout);
+}
+
+static void setconsole() {
+    struct termios t;
+
+    tcgetattr(0, &oldstdin);
+    tcgetattr(1, &oldstdout);
+
+    atexit(&resetconsole);
+
+    t = oldstdin;
+
+    t.c_lflag &= ~(ICANON | ECHO | ISIG); // no input processing
+    // Don't interpret various control characters, pass them through instead
+    t.c_cc[VINTR] = t.c_cc[VQUIT] = t.c_cc[VSUSP] = '\0';
+    t.c_cc[VMIN]  = 1;
+    t.c_cc[VTIME] = 0;
+    tcsetattr(0, TCSANOW, &t);
+
+    //tcgetattr(1, &t);
+    //t.c_lflag &= ~(ICANON | ECHO); // no input processing
+    //tcsetattr(1, TCSANOW, &t);
+}
+
+TerminalConsole::TerminalConsole() {
+    setconsole();
+}
+
+TerminalConsole::~TerminalConsole() {
+    resetconsole();
+}
+
+int TerminalConsole::Run() {
+    for (;;) {
+        int c = getchar();
+
+        if (c == 0x4) {
+            printf("ctrl-d on console, exiting\n");
+            return -1;
+        } else if (c == 0x1d && mCommandHandler) {
+            ReadCommand();
+        } else if (c == EOF) {
+            printf("EOF on console, exiting\n");
+            return -1;
+        } else {
+            EMU_PROBE1(console_enqueue, 1);
+            if (Timeline::IsEnabled())
+                Timeline::Instant("input arrived", "console", "char", c);
+
+            std::lock_guard<std::mutex> lck(mLock);
+            mInBuffer.push(c);
+        }
+    }
+}
+
+void TerminalConsole::ReadCommand() {
+    // the terminal is raw, so do the echo and line editing here
+    printf("\r\nemu> ");
+    fflush(stdout);
+
+    std::string line;
+    for (;;) {
+        int c = getchar();
+        if (c == EOF || c == '\r' || c == '\n')
+            break;
+
+        if (c == 0x7f || c == '\b') {
+            if (!line.empty()) {
+                line.pop_back();
+                printf("\b \b");
+            }
+        } else if (c >= 0x20) {
+            line.push_back(c);
+            putchar(c);
+        }
+        fflush(stdout);
+    }
+    printf("\r\n");
+
+    if (!line.empty())
+        mCommandHandler(line);
+}
+
+int TerminalConsole::ReadChar() {
+    std::lock_guard<std::mutex> lck(mLock);
+
+    int nc = -1;
+    if (!mInBuffer.empty()) {
+        nc = mInBuffer.front();
+        mInBuffer.pop();
+    }
+
+    return nc;
+}
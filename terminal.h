@@ -0,0 +1,55 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2014 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+
+#include "console.h"
+
+// the terminal the emulator was started on, in raw mode for as long as this
+// exists. Run() reads it on the console thread and queues the input.
+class TerminalConsole : public Console {
+public:
+    TerminalConsole();
+    virtual ~TerminalConsole() override;
+
+    int Run();
+
+    // ctrl-] reads a line and passes it here, on the console thread
+    void SetCommandHandler(std::function<void(const std::string &)> handler) { mCommandHandler = handler; }
+
+protected:
+    virtual int ReadChar() override;
+
+private:
+    void ReadCommand();
+
+    std::function<void(const std::string &)> mCommandHandler;
+
+    std::queue<char> mInBuffer;
+    std::mutex mLock;
+};
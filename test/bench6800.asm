@@ -0,0 +1,86 @@
+; vim: ts=4 sw=4 expandtab:
+    .title  6800 benchmark loops
+
+; a 256 byte prom image for the monitor slot of the altair 680, runs
+; forever, the bench tool stops it after a fixed number of instructions
+
+stacktop = 0x7fff
+
+; direct page scratch
+sum     = 0x10
+src     = 0x20
+dst     = 0x22
+
+    .area rom (ABS)
+    .org 0xff00
+
+start:
+    lds     #stacktop
+
+outer:
+; arithmetic, an 8 bit add carried into a second byte
+    ldx     #0x100
+
+arith:
+    ldaa    *sum
+    adda    #7
+    staa    *sum
+    ldab    *sum+1
+    adcb    #0
+    stab    *sum+1
+    asla
+    rolb
+    eora    #0xa5
+    dex
+    bne     arith
+
+; block copy the way the monitor does it, pointers kept in the direct page
+    ldx     #start
+    stx     *src
+    ldx     #0x200
+    stx     *dst
+    ldab    #0x40
+
+copy:
+    ldx     *src
+    ldaa    0,x
+    inx
+    stx     *src
+    ldx     *dst
+    staa    0,x
+    inx
+    stx     *dst
+    decb
+    bne     copy
+
+; branches, a call on every other pass
+    ldab    #0x80
+
+branch:
+    bitb    #1
+    beq     even
+    bsr     odd
+even:
+    cmpb    #0x40
+    bhi     high
+    nop
+high:
+    decb
+    bne     branch
+
+    bra     outer
+
+odd:
+    pshb
+    inca
+    pulb
+    rts
+
+    .area   vectab (ABS)
+    .org    0xfff8
+
+vectab:
+    .word   start   ; irq
+    .word   start   ; swi
+    .word   start   ; nmi
+    .word   start   ; reset
@@ -0,0 +1,84 @@
+; vim: ts=4 sw=4 expandtab:
+    .title  6809 benchmark loops
+
+; runs forever as the rom of the standard 6809 system, the bench tool
+; stops it after a fixed number of instructions
+
+stacktop = 0x8000
+
+; direct page scratch
+sum     = 0x10
+
+    .area rom (ABS)
+    .org 0xc000
+
+start:
+    lds     #stacktop
+
+outer:
+; arithmetic, shifts and carries on a running 16 bit sum
+    clra
+    clrb
+    std     *sum
+    ldx     #0x100
+
+arith:
+    tfr     x,d
+    aslb
+    rola
+    addd    *sum
+    std     *sum
+    eora    #0x5a
+    rolb
+    adca    #1
+    leax    -1,x
+    bne     arith
+
+; indexed, walk the rom and mix it into a buffer in ram
+    ldx     #start
+    ldy     #0x2000
+
+index:
+    ldd     ,x++
+    addd    2,y
+    std     ,y++
+    lda     b,x
+    sta     -1,y
+    cmpy    #0x2100
+    bne     index
+
+; branches, a call on every other pass
+    ldb     #0
+
+branch:
+    bitb    #1
+    beq     even
+    bsr     odd
+even:
+    tstb
+    bpl     low
+    nop
+low:
+    decb
+    bne     branch
+
+    bra     outer
+
+odd:
+    pshs    a,b,x
+    inca
+    puls    a,b,x
+    rts
+
+    .area   vectab (ABS)
+    .org    0xfff0
+
+vectab:
+    .word   start   ; reserved
+    .word   start   ; swi3
+    .word   start   ; swi2
+    .word   start   ; firq
+    .word   start   ; irq
+    .word   start   ; swi
+    .word   start   ; nmi
+    .word   start   ; reset
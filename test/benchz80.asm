@@ -0,0 +1,47 @@
+; vim: ts=4 sw=4 expandtab:
+    .title  z80 benchmark loops
+
+; a CP/M .COM for the cpm system, runs forever, the bench tool stops it
+; after a fixed number of instructions
+
+    .area code (ABS)
+    .org 0x100
+
+start:
+; block copies, the program out to ram and that copy on again
+    ld      hl,#start
+    ld      de,#0x8000
+    ld      bc,#0x400
+    ldir
+    ld      hl,#0x8000
+    ld      de,#0x9000
+    ld      bc,#0x400
+    ldir
+
+; flag heavy alu loop
+    ld      b,#0
+    ld      c,#0x5a
+    xor     a
+
+flags:
+    inc     a
+    xor     b
+    rrca
+    or      c
+    cp      b
+    rra
+    ccf
+    bit     3,a
+    jr      z,bitclr
+    inc     e
+bitclr:
+    scf
+    add     hl,bc
+    dec     d
+    cp      #0x40
+    jr      c,below
+    and     #0x3f
+below:
+    djnz    flags
+
+    jp      start
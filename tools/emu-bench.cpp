@@ -0,0 +1,259 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// fixed workloads run on each cpu for a set number of instructions, timed,
+// with results written out as json to compare engines and builds
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "cpu/cpu.h"
+#include "headless.h"
+#include "system/snapshot.h"
+#include "system/system.h"
+
+using namespace std;
+
+struct Workload {
+    const char *name;
+    const char *system;
+    const char *rom;
+    const char *input;          // fed to the console, if any
+};
+
+// the loops are built from the sources in test/ by test/doit
+static const Workload workloads[] = {
+    { "6809-loops", "6809", "test/bench6809.hex", nullptr },
+    { "6809-basic", "6809", "test/BASIC.HEX",
+      "\r10 FOR I=1 TO 30000\r20 A=A+I*3\r30 NEXT I\r40 GOTO 10\rRUN\r" },
+    { "6800-loops", "altair680", "test/bench6800.bin", nullptr },
+    { "z80-loops", "cpm", "test/benchz80.com", nullptr },
+};
+
+struct Result {
+    string status = "ok";
+    uint64_t instructions = 0;
+    double seconds = 0;
+    uint64_t checksum = 0;
+};
+
+// fnv-1a, over the whole machine as a snapshot would save it
+static uint64_t Checksum(const vector<uint8_t> &buf) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (auto b : buf) {
+        h ^= b;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static int RunWorkload(const Workload &w, uint64_t instructions, Cpu::Engine engine, Result &result) {
+    if (access(w.rom, R_OK) < 0) {
+        result.status = "skipped, no rom";
+        return 0;
+    }
+
+    HeadlessConsole con;
+    con.DiscardOutput();
+    if (w.input)
+        con.SetInputData((const uint8_t *)w.input, strlen(w.input));
+
+    unique_ptr<System> sys = System::Factory(w.system, con);
+    if (!sys)
+        return -EINVAL;
+    sys->SetRom(w.rom);
+
+    int err = sys->Init();
+    if (err < 0)
+        return err;
+
+    Cpu *cpu = sys->GetCpu();
+    cpu->SetFlightRecorderFile("");
+    cpu->SetEngine(engine);
+    cpu->SetInstructionLimit(instructions);
+
+    auto start = chrono::steady_clock::now();
+    err = cpu->Run();
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    result.instructions = cpu->GetInstructionCount();
+    if (err < 0 || !cpu->InstructionLimitReached())
+        result.status = "cpu stopped";
+
+    SnapshotWriter snap(cpu->GetName());
+    sys->SaveSnapshot(snap);
+    vector<uint8_t> image;
+    snap.Write(image);
+    result.checksum = Checksum(image);
+
+    return 0;
+}
+
+static void usage(char **argv) {
+    fprintf(stderr, "usage: %s [--instructions per workload] [--engine fast|reference]\n", argv[0]);
+    fprintf(stderr, "\t[-o/--output json file] [--verify] [workload names, default all]\n");
+    fprintf(stderr, "--verify runs the workloads again in reverse order and fails if any checksum\n");
+    fprintf(stderr, "differs, the last one back to back and the rest after different neighbours\n");
+    fprintf(stderr, "workloads:");
+    for (auto &w : workloads)
+        fprintf(stderr, " %s", w.name);
+    fprintf(stderr, "\n");
+
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    uint64_t instructions = 50000000;
+    Cpu::Engine engine = Cpu::Engine::FAST;
+    string output = "-";
+    bool verify = false;
+
+    for (;;) {
+        int c;
+        int option_index = 0;
+
+        static struct option long_options[] = {
+            {"help", 0, 0, 'h'},
+            {"instructions", 1, 0, 'n'},
+            {"engine", 1, 0, 'e'},
+            {"output", 1, 0, 'o'},
+            {"verify", 0, 0, 'v'},
+            {0, 0, 0, 0},
+        };
+
+        c = getopt_long(argc, argv, "hn:e:o:v", long_options, &option_index);
+        if (c == -1)
+            break;
+
+        switch (c) {
+            case 'n':
+                instructions = strtoull(optarg, NULL, 0);
+                break;
+            case 'e':
+                if (!strcmp(optarg, "fast")) {
+                    engine = Cpu::Engine::FAST;
+                } else if (!strcmp(optarg, "reference")) {
+                    engine = Cpu::Engine::REFERENCE;
+                } else {
+                    usage(argv);
+                }
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'v':
+                verify = true;
+                break;
+            case 'h':
+            default:
+                usage(argv);
+                break;
+        }
+    }
+
+    vector<const Workload *> run;
+    for (auto &w : workloads) {
+        bool selected = optind == argc;
+        for (int i = optind; i < argc; i++)
+            selected |= !strcmp(argv[i], w.name);
+        if (selected)
+            run.push_back(&w);
+    }
+    if (run.empty())
+        usage(argv);
+
+    // the systems chatter on cout while setting up, keep stdout for the results
+    cout.rdbuf(cerr.rdbuf());
+
+    FILE *fp = stdout;
+    if (output != "-" && !(fp = fopen(output.c_str(), "w"))) {
+        fprintf(stderr, "error opening %s\n", output.c_str());
+        return 1;
+    }
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"engine\": \"%s\",\n", engine == Cpu::Engine::FAST ? "fast" : "reference");
+    fprintf(fp, "  \"instructions\": %llu,\n", (unsigned long long)instructions);
+    fprintf(fp, "  \"workloads\": [");
+
+    int failed = 0;
+    vector<Result> results(run.size());
+    for (size_t i = 0; i < run.size(); i++) {
+        const Workload &w = *run[i];
+
+        Result &r = results[i];
+        if (RunWorkload(w, instructions, engine, r) < 0) {
+            fprintf(stderr, "error setting up workload %s\n", w.name);
+            r.status = "error";
+        }
+        if (r.status != "ok" && r.status.compare(0, 7, "skipped") != 0)
+            failed++;
+
+        double ips = r.seconds > 0 ? r.instructions / r.seconds : 0;
+        double ns = r.instructions ? r.seconds * 1e9 / r.instructions : 0;
+
+        fprintf(stderr, "%-12s %-16s %12.0f instructions/sec %8.2f ns/instruction\n",
+                w.name, r.status.c_str(), ips, ns);
+
+        fprintf(fp, "%s\n    {\n", i ? "," : "");
+        fprintf(fp, "      \"name\": \"%s\",\n", w.name);
+        fprintf(fp, "      \"system\": \"%s\",\n", w.system);
+        fprintf(fp, "      \"rom\": \"%s\",\n", w.rom);
+        fprintf(fp, "      \"status\": \"%s\",\n", r.status.c_str());
+        fprintf(fp, "      \"instructions\": %llu,\n", (unsigned long long)r.instructions);
+        fprintf(fp, "      \"seconds\": %.6f,\n", r.seconds);
+        fprintf(fp, "      \"instructions_per_sec\": %.0f,\n", ips);
+        fprintf(fp, "      \"ns_per_instruction\": %.3f,\n", ns);
+        fprintf(fp, "      \"checksum\": \"%016llx\"\n", (unsigned long long)r.checksum);
+        fprintf(fp, "    }");
+    }
+    fprintf(fp, "\n  ]\n}\n");
+
+    if (fp != stdout)
+        fclose(fp);
+
+    // a checksum that depends on what ran before it can't catch anything
+    for (size_t i = run.size(); verify && i-- > 0;) {
+        if (results[i].status != "ok")
+            continue;
+
+        Result again;
+        if (RunWorkload(*run[i], instructions, engine, again) < 0 || again.checksum != results[i].checksum) {
+            fprintf(stderr, "%-12s checksum %016llx on the second run, %016llx on the first\n", run[i]->name,
+                    (unsigned long long)again.checksum, (unsigned long long)results[i].checksum);
+            failed++;
+        } else {
+            fprintf(stderr, "%-12s checksum %016llx again\n", run[i]->name, (unsigned long long)again.checksum);
+        }
+    }
+
+    return failed ? 1 : 0;
+}
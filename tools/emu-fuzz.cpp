@@ -0,0 +1,367 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+// snapshot reset fuzzer for the cpu cores. Standalone it generates random
+// inputs or replays files given on the command line; built with
+// -DEMU_FUZZ_LIBFUZZER (make fuzz-libfuzzer) it is a libFuzzer target
+// configured through EMU_FUZZ_* environment variables instead.
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <map>
+#include <memory>
+#include <signal.h>
+#include <string>
+#include <vector>
+
+#include "cpu/cpu.h"
+#include "dev/memory.h"
+#include "headless.h"
+#include "system/snapshot.h"
+#include "system/system.h"
+
+using namespace std;
+
+struct FuzzConfig {
+    string system = "6809";
+    string cpu;
+    string rom;
+    string state;               // golden snapshot, otherwise the machine right after Init()
+    bool inputMode = false;     // feed inputs to the console instead of running them as code
+    uint64_t instructions = 10000;
+    uint64_t warmup = 1;        // run before taking the golden state, gets the cpu through reset
+};
+
+// one machine, reset to the golden state before every input
+class FuzzTarget {
+public:
+    int Init(const FuzzConfig &config);
+
+    // returns true if the input ended in a finding, the cpu bailing out of Run()
+    bool RunOne(const uint8_t *data, size_t len);
+
+    uint32_t GetPC() const { return mCpu->GetPC(); }
+
+private:
+    void Reset();
+
+    FuzzConfig mConfig;
+    HeadlessConsole mCon;
+    unique_ptr<System> mSys;
+    Cpu *mCpu = nullptr;
+    vector<uint8_t> mGolden;
+    uint32_t mEntry = 0;
+};
+
+int FuzzTarget::Init(const FuzzConfig &config) {
+    mConfig = config;
+    mCon.DiscardOutput();
+
+    mSys = System::Factory(mConfig.system, mCon);
+    if (!mSys)
+        return -EINVAL;
+    if (mConfig.cpu != "")
+        mSys->SetCpu(mConfig.cpu);
+    if (mConfig.rom != "")
+        mSys->SetRom(mConfig.rom);
+
+    int err = mSys->Init();
+    if (err < 0)
+        return err;
+    if (mConfig.state != "" && (err = mSys->LoadSnapshot(mConfig.state)) < 0)
+        return err;
+
+    mCpu = mSys->GetCpu();
+    mCpu->SetFlightRecorderFile("");
+
+    mCpu->SetInstructionLimit(mCpu->GetInstructionCount() + mConfig.warmup);
+    if (mConfig.warmup && mCpu->Run() < 0)
+        return -EINVAL;
+    mEntry = mCpu->GetPC();
+
+    // keep the golden state in memory, resets copy back whatever got dirtied
+    SnapshotWriter w(mCpu->GetName());
+    mSys->SaveSnapshot(w);
+    w.Write(mGolden);
+    for (auto &b : w.GetBanks())
+        b.mem->ClearDirty();
+
+    return 0;
+}
+
+void FuzzTarget::Reset() {
+    SnapshotReader r;
+    r.Open(mGolden.data(), mGolden.size());
+    r.SetDirtyPagesOnly(true);
+    mSys->LoadSnapshot(r);
+
+    mCon.SetInputData(nullptr, 0);
+}
+
+bool FuzzTarget::RunOne(const uint8_t *data, size_t len) {
+    Reset();
+
+    if (mConfig.inputMode) {
+        mCon.SetInputData(data, len);
+    } else {
+        for (size_t i = 0; i < len; i++)
+            mSys->MemWrite8(mEntry + i, data[i]);
+    }
+
+    mCpu->SetInstructionLimit(mCpu->GetInstructionCount() + mConfig.instructions);
+    return mCpu->Run() < 0;
+}
+
+#if EMU_FUZZ_LIBFUZZER
+
+static FuzzTarget sTarget;
+
+extern "C" int LLVMFuzzerInitialize(int *, char ***) {
+    FuzzConfig config;
+    if (const char *s = getenv("EMU_FUZZ_SYSTEM"))
+        config.system = s;
+    if (const char *s = getenv("EMU_FUZZ_CPU"))
+        config.cpu = s;
+    if (const char *s = getenv("EMU_FUZZ_ROM"))
+        config.rom = s;
+    if (const char *s = getenv("EMU_FUZZ_STATE"))
+        config.state = s;
+    if (const char *s = getenv("EMU_FUZZ_MODE"))
+        config.inputMode = strcmp(s, "input") == 0;
+    if (const char *s = getenv("EMU_FUZZ_INSTRUCTIONS"))
+        config.instructions = strtoull(s, NULL, 0);
+    if (const char *s = getenv("EMU_FUZZ_WARMUP"))
+        config.warmup = strtoull(s, NULL, 0);
+
+    if (sTarget.Init(config) < 0) {
+        fprintf(stderr, "error setting up fuzz target\n");
+        exit(1);
+    }
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t len) {
+    // let libFuzzer save the input
+    if (sTarget.RunOne(data, len))
+        abort();
+    return 0;
+}
+
+#else
+
+static void usage(char **argv) {
+    fprintf(stderr, "usage: %s [-s system] [-c cpu] [-r rom] [--state golden snapshot] [--input-mode]\n", argv[0]);
+    fprintf(stderr, "\t[--instructions per input] [--warmup instructions before the golden state]\n");
+    fprintf(stderr, "\t[--iterations count] [--max-len bytes] [--seed seed]\n");
+    fprintf(stderr, "\t[--findings dir] [input files to replay instead of generating]\n");
+    fprintf(stderr, "inputs are written at the golden pc as code, or fed to the console with --input-mode\n");
+
+    exit(1);
+}
+
+// an assert or host crash takes the whole process down, save what did it first
+static const vector<uint8_t> *sCurrentInput;
+static string sCrashFile;
+
+static void CrashSignal(int sig) {
+    signal(sig, SIG_DFL);
+
+    if (sCurrentInput) {
+        FILE *fp = fopen(sCrashFile.c_str(), "wb");
+        if (fp) {
+            fwrite(sCurrentInput->data(), 1, sCurrentInput->size(), fp);
+            fclose(fp);
+            fprintf(stderr, "crashing input written to %s\n", sCrashFile.c_str());
+        }
+    }
+
+    raise(sig);
+}
+
+static int ReadFile(const char *file, vector<uint8_t> &data) {
+    FILE *fp = fopen(file, "rb");
+    if (!fp) {
+        fprintf(stderr, "error opening %s\n", file);
+        return -errno;
+    }
+
+    uint8_t buf[4096];
+    size_t len;
+    data.clear();
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+        data.insert(data.end(), buf, buf + len);
+
+    fclose(fp);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    FuzzConfig config;
+    uint64_t iterations = 100000;
+    size_t maxLen = 64;
+    uint64_t seed = 1;
+    string findingsDir = ".";
+
+    for (;;) {
+        int c;
+        int option_index = 0;
+
+        static struct option long_options[] = {
+            {"help", 0, 0, 'h'},
+            {"system", 1, 0, 's'},
+            {"cpu", 1, 0, 'c'},
+            {"rom", 1, 0, 'r'},
+            {"state", 1, 0, 'S'},
+            {"input-mode", 0, 0, 'i'},
+            {"instructions", 1, 0, 'n'},
+            {"warmup", 1, 0, 'w'},
+            {"iterations", 1, 0, 'N'},
+            {"max-len", 1, 0, 'l'},
+            {"seed", 1, 0, 'x'},
+            {"findings", 1, 0, 'f'},
+            {0, 0, 0, 0},
+        };
+
+        c = getopt_long(argc, argv, "hs:c:r:S:in:w:N:l:x:f:", long_options, &option_index);
+        if (c == -1)
+            break;
+
+        switch (c) {
+            case 's':
+                config.system = optarg;
+                break;
+            case 'c':
+                config.cpu = optarg;
+                break;
+            case 'r':
+                config.rom = optarg;
+                break;
+            case 'S':
+                config.state = optarg;
+                break;
+            case 'i':
+                config.inputMode = true;
+                break;
+            case 'n':
+                config.instructions = strtoull(optarg, NULL, 0);
+                break;
+            case 'w':
+                config.warmup = strtoull(optarg, NULL, 0);
+                break;
+            case 'N':
+                iterations = strtoull(optarg, NULL, 0);
+                break;
+            case 'l':
+                maxLen = strtoul(optarg, NULL, 0);
+                break;
+            case 'x':
+                seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'f':
+                findingsDir = optarg;
+                break;
+            case 'h':
+            default:
+                usage(argv);
+                break;
+        }
+    }
+
+    FuzzTarget target;
+    if (target.Init(config) < 0) {
+        fprintf(stderr, "error setting up fuzz target\n");
+        return 1;
+    }
+
+    // replay mode, run each file once and say how it went
+    if (optind < argc) {
+        int findings = 0;
+        for (int i = optind; i < argc; i++) {
+            vector<uint8_t> data;
+            if (ReadFile(argv[i], data) < 0)
+                return 1;
+
+            bool found = target.RunOne(data.data(), data.size());
+            printf("%s: %s\n", argv[i], found ? "finding" : "ok");
+            findings += found;
+        }
+        return findings ? 2 : 0;
+    }
+
+    // random inputs, keeping the first input for each pc the cpu gave up at
+    uint64_t state = seed ? seed : 1;
+    auto next = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+
+    map<uint32_t, uint64_t> findings;
+    vector<uint8_t> data;
+
+    sCurrentInput = &data;
+    sCrashFile = findingsDir + "/crash.bin";
+    signal(SIGABRT, &CrashSignal);
+    signal(SIGSEGV, &CrashSignal);
+    signal(SIGBUS, &CrashSignal);
+    signal(SIGFPE, &CrashSignal);
+
+    auto start = chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; i++) {
+        data.resize(1 + next() % max<size_t>(maxLen, 1));
+        for (auto &b : data)
+            b = next();
+
+        if (!target.RunOne(data.data(), data.size()))
+            continue;
+
+        uint32_t pc = target.GetPC();
+        if (findings[pc]++ > 0)
+            continue;
+
+        char file[256];
+        snprintf(file, sizeof(file), "%s/finding-%04x.bin", findingsDir.c_str(), pc);
+        FILE *fp = fopen(file, "wb");
+        if (fp) {
+            fwrite(data.data(), 1, data.size(), fp);
+            fclose(fp);
+        }
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    uint64_t total = 0;
+    for (auto &f : findings)
+        total += f.second;
+
+    fprintf(stderr, "%llu inputs in %.2f seconds, %.0f resets/sec, %llu findings at %zu distinct pcs\n",
+            (unsigned long long)iterations, secs, iterations / secs, (unsigned long long)total, findings.size());
+
+    return 0;
+}
+
+#endif
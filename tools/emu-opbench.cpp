@@ -0,0 +1,446 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// per opcode microbenchmarks. Every opcode each core decodes, and for the
+// 6809 every indexed addressing mode, is laid out as a block of copies of
+// itself in flat ram and run in a loop, giving host ns per instruction.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <getopt.h>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "cpu/cpu.h"
+#include "cpu/cpu6800.h"
+#include "cpu/cpu6809.h"
+#include "cpu/cpuz80.h"
+#include "headless.h"
+#include "system/flatsystem.h"
+
+using namespace std;
+
+// memory layout of a loop. Everything outside the code is zero, so operands
+// of zero make addresses and pointers land in the low data area, branches
+// fall through to the next copy and jumps go off to 0 and get caught.
+static const uint32_t kCodeBase = 0x8000;
+static const size_t kCopies = 256;
+
+struct CpuInfo {
+    const char *name;
+    size_t maxBytes;
+
+    // puts the stack and index registers back and jumps to kCodeBase
+    vector<uint8_t> epilogue;
+
+    // a jump to kCodeBase, where the cpu starts after reset. Cpus that
+    // start through a vector have it pointed here.
+    bool resetVector;
+    uint32_t entryAddr;
+    vector<uint8_t> entry;
+};
+
+static const CpuInfo cpus[] = {
+    { "6809", Cpu6809::kMaxInstructionBytes,
+      { 0x10, 0xce, 0x70, 0x00,     // lds #0x7000
+        0x8e, 0x00, 0x00,           // ldx #0
+        0x10, 0x8e, 0x00, 0x00,     // ldy #0
+        0xce, 0x00, 0x00,           // ldu #0
+        0xcc, 0x00, 0x00,           // ldd #0
+        0x7e, 0x80, 0x00 },         // jmp 0x8000
+      true, 0x7ff0, { 0x7e, 0x80, 0x00 } },
+    { "6800", Cpu6800::kMaxInstructionBytes,
+      { 0x8e, 0x70, 0x00,           // lds #0x7000
+        0xce, 0x00, 0x00,           // ldx #0
+        0x4f,                       // clra
+        0x5f,                       // clrb
+        0x7e, 0x80, 0x00 },         // jmp 0x8000
+      true, 0x7ff0, { 0x7e, 0x80, 0x00 } },
+    { "z80", CpuZ80::kMaxInstructionBytes,
+      { 0x31, 0x00, 0x70,           // ld sp,0x7000
+        0x21, 0x00, 0x00,           // ld hl,0
+        0x01, 0x00, 0x00,           // ld bc,0
+        0x11, 0x00, 0x00,           // ld de,0
+        0xc3, 0x00, 0x80 },         // jp 0x8000
+      false, 0x0000, { 0xc3, 0x00, 0x80 } },
+};
+
+// the instruction bytes to try, opcode and any prefix or postbyte, the rest
+// of the operand bytes are zero
+static vector<vector<uint8_t>> Variants(const string &cpu) {
+    vector<vector<uint8_t>> v;
+
+    if (cpu == "6809") {
+        // one of each indexed mode, offsets and pointers are zero
+        static const uint8_t postbytes[] = {
+            0x00,                           // 5 bit offset
+            0x80, 0x81, 0x82, 0x83,         // ,x+ ,x++ ,-x ,--x
+            0x84, 0x85, 0x86, 0x88, 0x89,   // ,x b,x a,x 8 and 16 bit offset
+            0x8b, 0x8c, 0x8d,               // d,x 8 and 16 bit pc relative
+            0x91, 0x93, 0x94, 0x95, 0x96,   // indirect versions
+            0x98, 0x99, 0x9b, 0x9c, 0x9d,
+            0x9f,                           // [address]
+        };
+        auto indexed = [](uint8_t op) {
+            return (op >= 0x30 && op <= 0x33) || (op & 0xf0) == 0x60 ||
+                   (op & 0xf0) == 0xa0 || (op & 0xf0) == 0xe0;
+        };
+
+        // a zero postbyte pushes and pulls nothing and exchanges d with itself,
+        // so these also get every register, less pc on the pulls so they
+        // don't jump, and a pair of each size for exg/tfr
+        auto registerPostbytes = [](uint8_t op) -> vector<uint8_t> {
+            switch (op) {
+                case 0x34: case 0x36: return { 0x00, 0xff };    // pshs pshu
+                case 0x35: case 0x37: return { 0x00, 0x7f };    // puls pulu
+                case 0x1e: case 0x1f: return { 0x00, 0x12, 0x89 }; // exg tfr: d,d x,y a,b
+                default: return {};
+            }
+        };
+
+        for (int page : { 0, 0x10, 0x11 }) {
+            for (int op = 0; op < 256; op++) {
+                if (page == 0 && (op == 0x10 || op == 0x11))
+                    continue;
+
+                vector<uint8_t> base;
+                if (page)
+                    base.push_back(page);
+                base.push_back(op);
+
+                auto regs = page ? vector<uint8_t>() : registerPostbytes(op);
+                for (auto pb : regs) {
+                    v.push_back(base);
+                    v.back().push_back(pb);
+                }
+                if (!regs.empty())
+                    continue;
+
+                if (!indexed(op)) {
+                    v.push_back(base);
+                    continue;
+                }
+                for (auto pb : postbytes) {
+                    v.push_back(base);
+                    v.back().push_back(pb);
+                }
+            }
+        }
+    } else if (cpu == "6800") {
+        for (int op = 0; op < 256; op++)
+            v.push_back({ (uint8_t)op });
+    } else {
+        for (int op = 0; op < 256; op++) {
+            if (op != 0xcb && op != 0xdd && op != 0xed && op != 0xfd)
+                v.push_back({ (uint8_t)op });
+        }
+        for (int prefix : { 0xcb, 0xdd, 0xed, 0xfd }) {
+            for (int op = 0; op < 256; op++)
+                v.push_back({ (uint8_t)prefix, (uint8_t)op });
+        }
+    }
+
+    return v;
+}
+
+struct Result {
+    string cpu;
+    string bytes;
+    string disasm;
+    const char *status = "ok";
+    double ns = 0;
+};
+
+struct Options {
+    uint64_t instructions = 100000;
+    int runs = 3;
+    Cpu::Engine engine = Cpu::Engine::FAST;
+};
+
+// run the cpu exactly count more instructions
+static int Step(Cpu *cpu, uint64_t count) {
+    cpu->SetInstructionLimit(cpu->GetInstructionCount() + count);
+    int err = cpu->Run();
+    if (err < 0 || !cpu->InstructionLimitReached())
+        return -1;
+    return 0;
+}
+
+static void Measure(const CpuInfo &info, const vector<uint8_t> &insn, const Options &opt, Result &r) {
+    HeadlessConsole con;
+    con.DiscardOutput();
+    auto sys = FlatSystem::Create(info.name, con, nullptr, 0);
+    if (!sys) {
+        r.status = "no cpu";
+        return;
+    }
+    Cpu *cpu = sys->GetCpu();
+    cpu->SetFlightRecorderFile("");
+    cpu->SetEngine(opt.engine);
+
+    uint8_t *ram = sys->GetRam();
+
+    // from reset to the top of the code, with the entry put back first in case
+    // the instruction wrote over it
+    auto enter = [&]() {
+        memcpy(ram + info.entryAddr, info.entry.data(), info.entry.size());
+        if (info.resetVector) {
+            ram[0xfffe] = info.entryAddr >> 8;
+            ram[0xffff] = info.entryAddr;
+        }
+        cpu->Reset();
+        for (int i = 0; i < 8 && cpu->GetPC() != kCodeBase; i++) {
+            if (Step(cpu, 1) < 0)
+                break;
+        }
+        return cpu->GetPC() == kCodeBase;
+    };
+
+    // one copy, padded out with zero operand bytes, to find out how long it is
+    for (size_t i = 0; i < info.maxBytes; i++)
+        ram[kCodeBase + i] = i < insn.size() ? insn[i] : 0;
+
+    char dis[128];
+    cpu->DisassembleAt(kCodeBase, dis, sizeof(dis));
+    r.disasm = dis;
+
+    if (!enter()) {
+        r.status = "no entry";
+        return;
+    }
+
+    if (Step(cpu, 1) < 0) {
+        r.status = "unhandled";
+        return;
+    }
+    size_t len = cpu->GetPC() - kCodeBase;
+    if (cpu->GetPC() < kCodeBase || len == 0 || len > info.maxBytes) {
+        r.status = "control flow";
+        return;
+    }
+
+    // the block of copies and the epilogue back to the top
+    vector<uint8_t> code;
+    for (size_t i = 0; i < kCopies; i++)
+        code.insert(code.end(), ram + kCodeBase, ram + kCodeBase + len);
+    code.insert(code.end(), info.epilogue.begin(), info.epilogue.end());
+    memcpy(ram + kCodeBase, code.data(), code.size());
+
+    // once around, it has to run straight through and come back
+    if (!enter() || Step(cpu, kCopies) < 0) {
+        r.status = "unhandled";
+        return;
+    }
+    if (cpu->GetPC() != kCodeBase + kCopies * len) {
+        r.status = "control flow";
+        return;
+    }
+    for (int i = 0; i < 16 && cpu->GetPC() != kCodeBase; i++)
+        Step(cpu, 1);
+    if (cpu->GetPC() != kCodeBase) {
+        r.status = "control flow";
+        return;
+    }
+
+    // best of a few runs
+    double best = 0;
+    for (int run = 0; run < opt.runs; run++) {
+        auto start = chrono::steady_clock::now();
+        int err = Step(cpu, opt.instructions);
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (err < 0) {
+            r.status = "stopped";
+            return;
+        }
+        if (run == 0 || secs < best)
+            best = secs;
+    }
+
+    if (memcmp(ram + kCodeBase, code.data(), code.size()) != 0) {
+        r.status = "clobbered code";
+        return;
+    }
+
+    r.ns = best * 1e9 / opt.instructions;
+}
+
+static void usage(char **argv) {
+    fprintf(stderr, "usage: %s [-c/--cpu 6809|6800|z80, default all] [--instructions per run]\n", argv[0]);
+    fprintf(stderr, "\t[--runs count, the fastest is kept] [--engine fast|reference]\n");
+    fprintf(stderr, "\t[--sort ns|opcode] [--csv] [--all, list what couldn't be measured too] [-v]\n");
+    fprintf(stderr, "each loop is %zu copies of the instruction and a few instructions to reset\n", kCopies);
+    fprintf(stderr, "the stack and index registers, which are counted in the per instruction time\n");
+
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    Options opt;
+    string cpuOption;
+    bool sortByOpcode = false;
+    bool csv = false;
+    bool all = false;
+    bool verbose = false;
+
+    for (;;) {
+        int c;
+        int option_index = 0;
+
+        static struct option long_options[] = {
+            {"help", 0, 0, 'h'},
+            {"cpu", 1, 0, 'c'},
+            {"instructions", 1, 0, 'n'},
+            {"runs", 1, 0, 'R'},
+            {"engine", 1, 0, 'e'},
+            {"sort", 1, 0, 'S'},
+            {"csv", 0, 0, 'C'},
+            {"all", 0, 0, 'a'},
+            {"verbose", 0, 0, 'v'},
+            {0, 0, 0, 0},
+        };
+
+        c = getopt_long(argc, argv, "hc:n:R:e:S:Cav", long_options, &option_index);
+        if (c == -1)
+            break;
+
+        switch (c) {
+            case 'c':
+                cpuOption = optarg;
+                break;
+            case 'n':
+                opt.instructions = max<uint64_t>(strtoull(optarg, NULL, 0), 1);
+                break;
+            case 'R':
+                opt.runs = max(atoi(optarg), 1);
+                break;
+            case 'e':
+                if (!strcmp(optarg, "fast")) {
+                    opt.engine = Cpu::Engine::FAST;
+                } else if (!strcmp(optarg, "reference")) {
+                    opt.engine = Cpu::Engine::REFERENCE;
+                } else {
+                    usage(argv);
+                }
+                break;
+            case 'S':
+                if (!strcmp(optarg, "opcode")) {
+                    sortByOpcode = true;
+                } else if (strcmp(optarg, "ns")) {
+                    usage(argv);
+                }
+                break;
+            case 'C':
+                csv = true;
+                break;
+            case 'a':
+                all = true;
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            case 'h':
+            default:
+                usage(argv);
+                break;
+        }
+    }
+
+    // the cores complain on stdout and stderr about every opcode they don't
+    // implement, keep that out of the table
+    int savedOut = -1, savedErr = -1;
+    if (!verbose) {
+        fflush(stdout);
+        fflush(stderr);
+        savedOut = dup(1);
+        savedErr = dup(2);
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, 1);
+        dup2(null, 2);
+        close(null);
+    }
+
+    vector<Result> results;
+    for (auto &info : cpus) {
+        if (cpuOption != "" && cpuOption != info.name)
+            continue;
+
+        for (auto &insn : Variants(info.name)) {
+            Result r;
+            r.cpu = info.name;
+            for (auto b : insn) {
+                char hex[4];
+                snprintf(hex, sizeof(hex), "%02x", b);
+                r.bytes += hex;
+            }
+            Measure(info, insn, opt, r);
+            results.push_back(r);
+        }
+    }
+
+    if (!verbose) {
+        fflush(stdout);
+        fflush(stderr);
+        dup2(savedOut, 1);
+        dup2(savedErr, 2);
+        close(savedOut);
+        close(savedErr);
+    }
+
+    if (results.empty())
+        usage(argv);
+
+    if (!sortByOpcode) {
+        stable_sort(results.begin(), results.end(), [](const Result &a, const Result &b) {
+            return a.ns > b.ns;
+        });
+    }
+
+    size_t measured = 0;
+    if (csv)
+        printf("cpu,bytes,instruction,ns_per_instruction,status\n");
+    else
+        printf("%-5s %-10s %-40s %10s  %s\n", "cpu", "bytes", "instruction", "ns/insn", "status");
+    for (auto &r : results) {
+        bool ok = !strcmp(r.status, "ok");
+        measured += ok;
+        if (!ok && !all)
+            continue;
+
+        if (csv)
+            printf("%s,%s,\"%s\",%.3f,%s\n", r.cpu.c_str(), r.bytes.c_str(), r.disasm.c_str(), r.ns, r.status);
+        else
+            printf("%-5s %-10s %-40s %10.3f  %s\n", r.cpu.c_str(), r.bytes.c_str(), r.disasm.c_str(), r.ns, r.status);
+    }
+
+    fprintf(stderr, "%zu of %zu opcode variants measured, %llu instructions per run, best of %d\n",
+            measured, results.size(), (unsigned long long)opt.instructions, opt.runs);
+
+    return 0;
+}
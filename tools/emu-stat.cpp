@@ -0,0 +1,185 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// watches the live counters of running emulators, from the shared memory
+// they publish with --stats
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "debug/stats.h"
+
+using namespace std;
+
+struct Instance {
+    pid_t pid;
+    const StatsBlock *block;
+};
+
+static int Map(pid_t pid, Instance &inst) {
+    string name = Stats::ShmName(pid);
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return -errno;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(StatsBlock)) {
+        close(fd);
+        return -EINVAL;
+    }
+
+    void *ptr = mmap(NULL, sizeof(StatsBlock), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+        return -errno;
+
+    const StatsBlock *b = static_cast<const StatsBlock *>(ptr);
+    if (b->magic != StatsBlock::kMagic || b->version != StatsBlock::kVersion) {
+        munmap(ptr, sizeof(StatsBlock));
+        return -EINVAL;
+    }
+
+    inst.pid = pid;
+    inst.block = b;
+    return 0;
+}
+
+// every emulator publishing stats that's still around
+static void FindAll(vector<Instance> &instances) {
+    DIR *dir = opendir("/dev/shm");
+    if (!dir)
+        return;
+
+    const char prefix[] = "emu-stats.";
+    while (struct dirent *d = readdir(dir)) {
+        if (strncmp(d->d_name, prefix, sizeof(prefix) - 1) != 0)
+            continue;
+
+        pid_t pid = strtol(d->d_name + sizeof(prefix) - 1, NULL, 10);
+        if (pid <= 0 || kill(pid, 0) < 0)
+            continue;
+
+        Instance inst;
+        if (Map(pid, inst) == 0)
+            instances.push_back(inst);
+    }
+
+    closedir(dir);
+}
+
+static void usage(char **argv) {
+    fprintf(stderr, "usage: %s [-h] [-i/--interval seconds] [-1/--once] [pid]\n", argv[0]);
+    fprintf(stderr, "\twith no pid, every emu running with --stats\n");
+
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    double interval = 1;
+    bool once = false;
+
+    for (;;) {
+        int c;
+        int option_index = 0;
+
+        static struct option long_options[] = {
+            {"help", 0, 0, 'h'},
+            {"interval", 1, 0, 'i'},
+            {"once", 0, 0, '1'},
+            {0, 0, 0, 0},
+        };
+
+        c = getopt_long(argc, argv, "hi:1", long_options, &option_index);
+        if (c == -1)
+            break;
+
+        switch (c) {
+            case 'i':
+                interval = strtod(optarg, NULL);
+                break;
+            case '1':
+                once = true;
+                break;
+            case 'h':
+            default:
+                usage(argv);
+                break;
+        }
+    }
+
+    if (optind < argc - 1)
+        usage(argv);
+
+    vector<Instance> instances;
+    if (optind < argc) {
+        pid_t pid = strtol(argv[optind], NULL, 0);
+        Instance inst;
+        int err = Map(pid, inst);
+        if (err < 0) {
+            fprintf(stderr, "no stats for pid %d: %s\n", (int)pid, strerror(-err));
+            return 1;
+        }
+        instances.push_back(inst);
+    } else {
+        FindAll(instances);
+        if (instances.empty()) {
+            fprintf(stderr, "no emu running with --stats\n");
+            return 1;
+        }
+    }
+
+    bool tty = isatty(STDOUT_FILENO);
+    for (;;) {
+        // redraw in place on a terminal, otherwise just keep appending
+        if (tty && !once)
+            printf("\033[H\033[J");
+
+        size_t alive = 0;
+        for (auto &inst : instances) {
+            if (kill(inst.pid, 0) < 0)
+                continue;
+            Stats::Report(*inst.block, stdout);
+            printf("\n");
+            alive++;
+        }
+        fflush(stdout);
+
+        if (once || alive == 0)
+            break;
+        usleep(interval * 1000000);
+    }
+
+    return 0;
+}
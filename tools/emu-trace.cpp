@@ -0,0 +1,201 @@
+// vim: ts=4:sw=4:expandtab:
+/*
+ * Copyright (c) 2026 Travis Geiselbrecht
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// offline decoder for the binary traces written by emu --trace-file, and the
+// raw text logs from emu --trace-log
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <string>
+
+#include "cpu/cpu.h"
+#include "cpu/cpu6800.h"
+#include "cpu/cpu6809.h"
+#include "cpu/cpuz80.h"
+#include "debug/tracefile.h"
+#include "debug/tracelog.h"
+
+using namespace std;
+
+// the per cpu pieces needed to print a trace
+struct CpuDecoder {
+    const char *name;
+    size_t (*disassemble)(uint32_t pc, const uint8_t *bytes, char *buf, size_t buflen);
+    void (*formatRegs)(const uint16_t *regs, char *buf, size_t buflen);
+};
+
+static const CpuDecoder decoders[] = {
+    { "6809", &Cpu6809::Disassemble, &Cpu6809::FormatRegs },
+    { "6800", &Cpu6800::Disassemble, &Cpu6800::FormatRegs },
+    { "z80", &CpuZ80::Disassemble, &CpuZ80::FormatRegs },
+};
+
+// parse "lo-hi" or a single value, leaving hi alone if it's not specified
+static void ParseRange(const char *str, uint64_t &lo, uint64_t &hi) {
+    char *end;
+    lo = strtoull(str, &end, 0);
+    if (*end == '-')
+        hi = strtoull(end + 1, NULL, 0);
+}
+
+static void usage(char **argv) {
+    fprintf(stderr, "usage: %s [-h] [--pc lo-hi] [--opcode op] [--count start-end]\n", argv[0]);
+    fprintf(stderr, "\t[--regs] [--writes] [--stats] tracefile\n");
+    fprintf(stderr, "       %s --log tracelog\n", argv[0]);
+
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    TraceFilter filter;
+    bool regsOption = false;
+    bool writesOption = false;
+    bool statsOption = false;
+    bool logOption = false;
+
+    for (;;) {
+        int c;
+        int option_index = 0;
+
+        static struct option long_options[] = {
+            {"help", 0, 0, 'h'},
+            {"pc", 1, 0, 'p'},
+            {"opcode", 1, 0, 'o'},
+            {"count", 1, 0, 'n'},
+            {"regs", 0, 0, 'r'},
+            {"writes", 0, 0, 'w'},
+            {"stats", 0, 0, 's'},
+            {"log", 0, 0, 'l'},
+            {0, 0, 0, 0},
+        };
+
+        c = getopt_long(argc, argv, "hp:o:n:rwsl", long_options, &option_index);
+        if (c == -1)
+            break;
+
+        switch (c) {
+            case 'p': {
+                uint64_t lo, hi = 0xffffffff;
+                ParseRange(optarg, lo, hi);
+                filter.pcLow = lo;
+                filter.pcHigh = hi;
+                break;
+            }
+            case 'o':
+                filter.opcode = strtoul(optarg, NULL, 0) & 0xff;
+                break;
+            case 'n':
+                ParseRange(optarg, filter.countStart, filter.countEnd);
+                break;
+            case 'r':
+                regsOption = true;
+                break;
+            case 'w':
+                writesOption = true;
+                break;
+            case 's':
+                statsOption = true;
+                break;
+            case 'l':
+                logOption = true;
+                break;
+            case 'h':
+            default:
+                usage(argv);
+                break;
+        }
+    }
+
+    if (optind != argc - 1)
+        usage(argv);
+
+    if (logOption)
+        return TraceLog::Decode(argv[optind], stdout) < 0 ? 1 : 0;
+
+    TraceReader reader;
+    if (reader.Open(argv[optind]) < 0)
+        return 1;
+
+    const CpuDecoder *dec = nullptr;
+    for (auto &d : decoders) {
+        if (strcmp(d.name, reader.GetCpu()) == 0)
+            dec = &d;
+    }
+    if (!dec) {
+        fprintf(stderr, "trace is for unknown cpu '%s'\n", reader.GetCpu());
+        return 1;
+    }
+
+    uint64_t instructions = 0;
+    uint64_t writes = 0;
+    bool lastMatched = false;
+
+    TraceEvent e;
+    while (reader.Next(e)) {
+        if (e.type == TraceEvent::WRITE) {
+            writes++;
+
+            // writes belong to the instruction before them
+            if (writesOption && lastMatched && !statsOption)
+                printf("%10s       write 0x%04x <- 0x%02x\n", "", e.address, e.value);
+            continue;
+        }
+
+        instructions++;
+
+        lastMatched = filter.Match(e.address, e.value, e.count);
+        if (!lastMatched || statsOption)
+            continue;
+
+        uint8_t bytes[8];
+        for (size_t i = 0; i < sizeof(bytes); i++)
+            bytes[i] = reader.GetImage()[(e.address + i) & 0xffff];
+
+        char dis[64];
+        dec->disassemble(e.address, bytes, dis, sizeof(dis));
+
+        if (regsOption) {
+            char regs[128];
+            dec->formatRegs(e.regs, regs, sizeof(regs));
+            printf("%10llu %04x: %-32s %s\n", (unsigned long long)e.count, e.address, dis, regs);
+        } else {
+            printf("%10llu %04x: %s\n", (unsigned long long)e.count, e.address, dis);
+        }
+    }
+
+    if (reader.GetOffset() != reader.GetSize())
+        fprintf(stderr, "trace is truncated or corrupt at offset %zu\n", reader.GetOffset());
+
+    if (statsOption) {
+        printf("cpu %s\n", reader.GetCpu());
+        printf("%llu instructions, %llu memory writes\n",
+               (unsigned long long)instructions, (unsigned long long)writes);
+        printf("%zu bytes, %.2f bytes per instruction\n",
+               reader.GetSize(), instructions ? (double)reader.GetSize() / instructions : 0.0);
+    }
+
+    return 0;
+}
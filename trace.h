@@ -25,13 +25,15 @@
 
 #include <cstdio>
 
-/* trace routines */
-#define TRACE_ENTRY printf("%s: entry\n", __PRETTY_FUNCTION__)
-#define TRACE_EXIT printf("%s: exit\n", __PRETTY_FUNCTION__)
-#define TRACE_ENTRY_OBJ printf("%s: entry obj %p\n", __PRETTY_FUNCTION__, this)
-#define TRACE_EXIT_OBJ printf("%s: exit obj %p\n", __PRETTY_FUNCTION__, this)
-#define TRACE printf("%s:%d\n", __PRETTY_FUNCTION__, __LINE__)
-#define TRACEF(str, x...) do { printf("%s:%d: " str, __PRETTY_FUNCTION__, __LINE__, ## x); } while (0)
+#include "debug/tracelog.h"
+
+/* trace routines, formatted later on a background thread */
+#define TRACE_ENTRY TraceLog::Printf("%s: entry\n", __PRETTY_FUNCTION__)
+#define TRACE_EXIT TraceLog::Printf("%s: exit\n", __PRETTY_FUNCTION__)
+#define TRACE_ENTRY_OBJ TraceLog::Printf("%s: entry obj %p\n", __PRETTY_FUNCTION__, this)
+#define TRACE_EXIT_OBJ TraceLog::Printf("%s: exit obj %p\n", __PRETTY_FUNCTION__, this)
+#define TRACE TraceLog::Printf("%s:%d\n", __PRETTY_FUNCTION__, __LINE__)
+#define TRACEF(str, x...) do { TraceLog::Printf("%s:%d: " str, __PRETTY_FUNCTION__, __LINE__, ## x); } while (0)
 
 /* trace routines that work if LOCAL_TRACE is set */
 #define LTRACE_ENTRY do { if (LOCAL_TRACE) { TRACE_ENTRY; } } while (0)
@@ -39,4 +41,4 @@
 #define LTRACE do { if (LOCAL_TRACE) { TRACE; } } while (0)
 #define LTRACEF(x...) do { if (LOCAL_TRACE) { TRACEF(x); } } while (0)
 #define LTRACEF_LEVEL(level, x...) do { if (LOCAL_TRACE >= (level)) { TRACEF(x); } } while (0)
-#define LPRINTF(x...) do { if (LOCAL_TRACE) { printf(x); } } while (0)
+#define LPRINTF(x...) do { if (LOCAL_TRACE) { TraceLog::Printf(x); } } while (0)